@@ -0,0 +1,126 @@
+/* asid-forkexec.c
+ *
+ * Fork/exec microbenchmark for the ARM ASID allocator.
+ *
+ * Forks and execs short-lived children, <procs> at a time, until
+ * <loops> of them have run, and reports the time per fork+exec along
+ * with the ASID rollovers and full local TLB flushes the kernel did
+ * meanwhile, as read from the "asid" file in debugfs.  The flush count
+ * is taken in local_flush_tlb_all(), so it covers whatever allocator
+ * the kernel runs.  Each rollover of the 8-bit ASID space happens
+ * after 255 new mms.
+ *
+ * Compile with
+ *	gcc -O2 -Wall asid-forkexec.c -o asid-forkexec
+ *
+ * Run with debugfs mounted on /sys/kernel/debug:
+ *	asid-forkexec [loops [procs]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+
+#define ASID_FILE	"/sys/kernel/debug/asid"
+
+struct asid_stats {
+	unsigned long rollovers;
+	unsigned long flushes;
+};
+
+static int read_stats(struct asid_stats *st)
+{
+	char line[128];
+	FILE *f;
+
+	f = fopen(ASID_FILE, "r");
+	if (!f)
+		return -1;
+
+	memset(st, 0, sizeof(*st));
+	while (fgets(line, sizeof(line), f)) {
+		sscanf(line, "rollovers: %lu", &st->rollovers);
+		sscanf(line, "tlb flushes: %lu", &st->flushes);
+	}
+	fclose(f);
+
+	return 0;
+}
+
+static void spawn(const char *self)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid == 0) {
+		execl(self, self, "--child", (char *)NULL);
+		_exit(127);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct asid_stats before, after;
+	struct timeval start, end;
+	unsigned long loops = 10000, procs = 1, i, running = 0;
+	int have_stats, status;
+	double us;
+
+	/* the exec'd child: a fresh mm, nothing else */
+	if (argc > 1 && !strcmp(argv[1], "--child"))
+		return 0;
+
+	if (argc > 1)
+		loops = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		procs = strtoul(argv[2], NULL, 0);
+	if (!loops || !procs) {
+		fprintf(stderr, "usage: %s [loops [procs]]\n", argv[0]);
+		return 1;
+	}
+
+	have_stats = !read_stats(&before);
+	if (!have_stats)
+		fprintf(stderr, "%s: no ASID statistics, only timing\n",
+			ASID_FILE);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < loops; i++) {
+		if (running == procs) {
+			if (wait(&status) < 0) {
+				perror("wait");
+				return 1;
+			}
+			running--;
+		}
+		spawn("/proc/self/exe");
+		running++;
+	}
+	while (running--)
+		wait(&status);
+	gettimeofday(&end, NULL);
+
+	us = (end.tv_sec - start.tv_sec) * 1e6 +
+		(end.tv_usec - start.tv_usec);
+
+	printf("fork+exec: %lu loops, %lu at a time, %.1f us each\n",
+	       loops, procs, us / loops);
+
+	if (have_stats && !read_stats(&after)) {
+		printf("asid rollovers: %lu\n",
+		       after.rollovers - before.rollovers);
+		printf("tlb flushes: %lu (%.2f per 1000 fork+exec)\n",
+		       after.flushes - before.flushes,
+		       (after.flushes - before.flushes) * 1000.0 / loops);
+	}
+
+	return 0;
+}
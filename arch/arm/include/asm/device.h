@@ -12,7 +12,13 @@ struct dev_archdata {
 #endif
 };
 
+struct omap_device;
+
 struct pdev_archdata {
+#ifdef CONFIG_ARCH_OMAP
+	/* set for platform_devices embedded in a struct omap_device */
+	struct omap_device *od;
+#endif
 };
 
 #endif
@@ -15,6 +15,8 @@
 
 #include <linux/compiler.h>
 #include <linux/sched.h>
+#include <linux/percpu.h>
+#include <asm/atomic.h>
 #include <asm/cacheflush.h>
 #include <asm/cachetype.h>
 #include <asm/proc-fns.h>
@@ -42,15 +44,25 @@ void __check_kvm_seq(struct mm_struct *mm);
 #define ASID_MASK		((~0) << ASID_BITS)
 #define ASID_FIRST_VERSION	(1 << ASID_BITS)
 
-extern unsigned int cpu_last_asid;
+extern atomic_t asid_generation;
+DECLARE_PER_CPU(atomic_t, active_asids);
 
 void __init_new_context(struct task_struct *tsk, struct mm_struct *mm);
-void __new_context(struct mm_struct *mm);
+void __new_context(struct mm_struct *mm, unsigned int cpu);
 
 static inline void check_context(struct mm_struct *mm)
 {
-	if (unlikely((mm->context.id ^ cpu_last_asid) >> ASID_BITS))
-		__new_context(mm);
+	unsigned int cpu = smp_processor_id();
+	unsigned int asid = ACCESS_ONCE(mm->context.id);
+
+	/*
+	 * The ASID can be used without taking the lock if it is from
+	 * the current generation and no rollover has cleared the
+	 * active ASID of this CPU in the meantime.
+	 */
+	if (unlikely(((asid ^ atomic_read(&asid_generation)) >> ASID_BITS) ||
+		     !atomic_xchg(&per_cpu(active_asids, cpu), asid)))
+		__new_context(mm, cpu);
 
 	if (unlikely(mm->context.kvm_seq != init_mm.context.kvm_seq))
 		__check_kvm_seq(mm);
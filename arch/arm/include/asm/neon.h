@@ -0,0 +1,45 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+/* memcpy() hands copies of at least this size to the NEON code */
+#define NEON_COPY_MIN		1024
+
+#ifndef __ASSEMBLY__
+
+#include <linux/types.h>
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON code must live in its own compilation unit, built with
+ * -mfpu=neon, and only be called between kernel_neon_begin() and
+ * kernel_neon_end(); otherwise gcc is free to emit NEON instructions
+ * outside of that window.  The caller must not sleep in between, and
+ * may not use NEON from interrupt context.  The calls do not nest.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+int kernel_neon_usable(void);
+int kernel_neon_free(void);
+
+#ifdef CONFIG_ARM_NEON_COPY
+/* arch/arm/lib/neon_copy.S, only valid between the two calls above */
+extern void *__memcpy_neon(void *, const void *, size_t);
+extern void __copy_page_neon(void *, const void *);
+extern void __clear_page_neon(void *);
+
+/* the integer memcpy, arch/arm/lib/memcpy.S */
+extern void *__memcpy_arm(void *, const void *, size_t);
+#endif
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_ARM_NEON_H */
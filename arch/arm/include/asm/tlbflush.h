@@ -314,11 +314,21 @@ extern struct cpu_tlb_fns cpu_tlb;
 
 #define tlb_flag(f)	((always_tlb_flags & (f)) || (__tlb_flag & possible_tlb_flags & (f)))
 
+#ifdef CONFIG_DEBUG_FS
+/* full flushes of the local TLB, whatever asked for them (statistics) */
+DECLARE_PER_CPU(unsigned long, tlb_flush_all_count);
+#define tlb_flush_all_account()	(__raw_get_cpu_var(tlb_flush_all_count)++)
+#else
+#define tlb_flush_all_account()	do { } while (0)
+#endif
+
 static inline void local_flush_tlb_all(void)
 {
 	const int zero = 0;
 	const unsigned int __tlb_flag = __cpu_tlb_flags;
 
+	tlb_flush_all_account();
+
 	if (tlb_flag(TLB_WB))
 		dsb();
 
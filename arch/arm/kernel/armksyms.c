@@ -20,6 +20,7 @@
 #include <asm/checksum.h>
 #include <asm/system.h>
 #include <asm/ftrace.h>
+#include <asm/neon.h>
 
 /*
  * libgcc functions - functions that are used internally by the
@@ -110,6 +111,12 @@ EXPORT_SYMBOL(memcpy);
 EXPORT_SYMBOL(memmove);
 EXPORT_SYMBOL(memchr);
 EXPORT_SYMBOL(__memzero);
+#ifdef CONFIG_ARM_NEON_COPY
+EXPORT_SYMBOL(__memcpy_arm);
+EXPORT_SYMBOL(__memcpy_neon);
+EXPORT_SYMBOL(__copy_page_neon);
+EXPORT_SYMBOL(__clear_page_neon);
+#endif
 
 	/* user mem (segment) */
 EXPORT_SYMBOL(__strnlen_user);
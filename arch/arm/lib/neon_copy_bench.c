@@ -0,0 +1,230 @@
+/*
+ *  linux/arch/arm/lib/neon_copy_bench.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Compare the integer and NEON memory copy routines.  Loading the
+ * module prints the bandwidth of each for a range of sizes; it then
+ * fails with -EAGAIN so that it can simply be loaded again, like
+ * tcrypt.  The NEON memcpy figures include kernel_neon_begin() and
+ * kernel_neon_end() for every call, as memcpy() pays them too.
+ *
+ * Hot figures copy the same buffer over and over.  Cold ones walk
+ * through buffers much larger than the L2 cache, so every copy misses.
+ * The memcpy() column is what callers get: it falls back to the
+ * integer copy when user VFP state is live on the CPU, which is the
+ * case when the task loading the module has used the VFP.
+ */
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/vmalloc.h>
+
+#include <asm/page.h>
+#include <asm/neon.h>
+
+#define BENCH_MIN_SIZE		64
+#define BENCH_MAX_SIZE		(256 * 1024)
+#define BENCH_BYTES		(16 * 1024 * 1024)	/* per measurement */
+#define BENCH_ORDER		get_order(BENCH_MAX_SIZE)
+#define BENCH_PAGES		(BENCH_MAX_SIZE / PAGE_SIZE)
+#define BENCH_COLD_SIZE		(4 * 1024 * 1024)	/* >> L2 */
+
+static void *bench_src, *bench_dst;
+static void *bench_cold_src, *bench_cold_dst;
+
+/* MB/s for loops copies of size bytes starting at start */
+static unsigned long bench_rate(ktime_t start, unsigned long loops,
+				size_t size)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (ns <= 0)
+		ns = 1;
+
+	return div64_u64((u64)loops * size * 1000, ns);
+}
+
+enum { BENCH_ARM, BENCH_NEON, BENCH_MEMCPY };
+
+static void bench_memcpy_one(int how, void *dst, const void *src,
+			     size_t size)
+{
+	switch (how) {
+	case BENCH_ARM:
+		__memcpy_arm(dst, src, size);
+		break;
+	case BENCH_NEON:
+		kernel_neon_begin();
+		__memcpy_neon(dst, src, size);
+		kernel_neon_end();
+		break;
+	default:
+		memcpy(dst, src, size);
+	}
+}
+
+static unsigned long bench_memcpy(int how, size_t size, unsigned long loops)
+{
+	ktime_t start = ktime_get();
+	unsigned long i;
+
+	for (i = 0; i < loops; i++)
+		bench_memcpy_one(how, bench_dst, bench_src, size);
+
+	return bench_rate(start, loops, size);
+}
+
+/* as above, never copying the same cache line twice in a row */
+static unsigned long bench_memcpy_cold(int how, size_t size,
+				       unsigned long loops)
+{
+	ktime_t start = ktime_get();
+	unsigned long i, off = 0;
+
+	for (i = 0; i < loops; i++) {
+		bench_memcpy_one(how, bench_cold_dst + off,
+				 bench_cold_src + off, size);
+		off += size + L1_CACHE_BYTES;
+		if (off + size > BENCH_COLD_SIZE)
+			off = 0;
+	}
+
+	return bench_rate(start, loops, size);
+}
+
+static unsigned long bench_copy_page(int neon, unsigned long loops)
+{
+	ktime_t start = ktime_get();
+	unsigned long i;
+	int n;
+
+	for (i = 0; i < loops; i++) {
+		if (neon)
+			kernel_neon_begin();
+		for (n = 0; n < BENCH_PAGES; n++) {
+			void *to = bench_dst + n * PAGE_SIZE;
+			void *from = bench_src + n * PAGE_SIZE;
+
+			if (neon)
+				__copy_page_neon(to, from);
+			else
+				copy_page(to, from);
+		}
+		if (neon)
+			kernel_neon_end();
+	}
+
+	return bench_rate(start, loops, BENCH_MAX_SIZE);
+}
+
+static unsigned long bench_clear_page(int neon, unsigned long loops)
+{
+	ktime_t start = ktime_get();
+	unsigned long i;
+	int n;
+
+	for (i = 0; i < loops; i++) {
+		if (neon)
+			kernel_neon_begin();
+		for (n = 0; n < BENCH_PAGES; n++) {
+			void *to = bench_dst + n * PAGE_SIZE;
+
+			if (neon)
+				__clear_page_neon(to);
+			else
+				clear_page(to);
+		}
+		if (neon)
+			kernel_neon_end();
+	}
+
+	return bench_rate(start, loops, BENCH_MAX_SIZE);
+}
+
+static int __init neon_copy_bench_init(void)
+{
+	unsigned long loops;
+	size_t size;
+
+	if (!cpu_has_neon()) {
+		printk(KERN_ERR "neon_copy_bench: CPU has no NEON\n");
+		return -ENODEV;
+	}
+
+	bench_src = (void *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	bench_dst = (void *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	bench_cold_src = vmalloc(BENCH_COLD_SIZE);
+	bench_cold_dst = vmalloc(BENCH_COLD_SIZE);
+	if (!bench_src || !bench_dst || !bench_cold_src || !bench_cold_dst)
+		goto out;
+
+	/* touch all buffers before anything is timed */
+	memset(bench_src, 0x5a, BENCH_MAX_SIZE);
+	memset(bench_dst, 0, BENCH_MAX_SIZE);
+	memset(bench_cold_src, 0x5a, BENCH_COLD_SIZE);
+	memset(bench_cold_dst, 0, BENCH_COLD_SIZE);
+
+	printk(KERN_INFO "neon_copy_bench: memcpy, MB/s, user VFP state %s\n",
+	       kernel_neon_free() ? "not live" : "live");
+	printk(KERN_INFO "neon_copy_bench: %8s %8s %8s %8s %8s %8s\n", "size",
+	       "arm", "neon", "memcpy", "arm/cold", "neon/cold");
+	for (size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size <<= 1) {
+		unsigned long arm, neon, mc, arm_cold, neon_cold;
+
+		loops = BENCH_BYTES / size;
+		arm = bench_memcpy(BENCH_ARM, size, loops);
+		cond_resched();
+		neon = bench_memcpy(BENCH_NEON, size, loops);
+		cond_resched();
+		mc = bench_memcpy(BENCH_MEMCPY, size, loops);
+		cond_resched();
+		arm_cold = bench_memcpy_cold(BENCH_ARM, size, loops);
+		cond_resched();
+		neon_cold = bench_memcpy_cold(BENCH_NEON, size, loops);
+		cond_resched();
+
+		printk(KERN_INFO "neon_copy_bench: %8zu %8lu %8lu %8lu %8lu "
+		       "%8lu\n", size, arm, neon, mc, arm_cold, neon_cold);
+	}
+
+	loops = BENCH_BYTES / BENCH_MAX_SIZE;
+	printk(KERN_INFO "neon_copy_bench: copy_page %lu MB/s, "
+	       "__copy_page_neon %lu MB/s\n",
+	       bench_copy_page(0, loops), bench_copy_page(1, loops));
+	cond_resched();
+	printk(KERN_INFO "neon_copy_bench: clear_page %lu MB/s, "
+	       "__clear_page_neon %lu MB/s\n",
+	       bench_clear_page(0, loops), bench_clear_page(1, loops));
+
+out:
+	vfree(bench_cold_dst);
+	vfree(bench_cold_src);
+	if (bench_dst)
+		free_pages((unsigned long)bench_dst, BENCH_ORDER);
+	if (bench_src)
+		free_pages((unsigned long)bench_src, BENCH_ORDER);
+
+	return bench_src && bench_dst && bench_cold_src && bench_cold_dst ?
+		-EAGAIN : -ENOMEM;
+}
+
+/*
+ * If an init function is provided, an exit function must also be
+ * provided to allow module unload.
+ */
+static void __exit neon_copy_bench_exit(void) { }
+
+module_init(neon_copy_bench_init);
+module_exit(neon_copy_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("NEON memory copy benchmark");
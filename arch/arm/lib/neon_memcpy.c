@@ -0,0 +1,45 @@
+/*
+ *  linux/arch/arm/lib/neon_memcpy.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * memcpy() branches here for copies of NEON_COPY_MIN bytes or more.
+ * NEON is only used if no user VFP state is live on this CPU: saving
+ * it, and the trap to reload it when its task uses the VFP again, cost
+ * more than NEON saves on a copy of a few KiB, and a task using NEON
+ * would pay them for every large copy it asks of the kernel.  A NEON
+ * section keeps preemption disabled, so the copy is done in chunks to
+ * bound the latency.
+ */
+#include <linux/kernel.h>
+#include <linux/types.h>
+
+#include <asm/neon.h>
+
+#define NEON_COPY_CHUNK		(64 * 1024)
+
+void *__memcpy_large(void *dest, const void *src, size_t n)
+{
+	char *d = dest;
+	const char *s = src;
+	size_t len;
+
+	if (!cpu_has_neon() || !kernel_neon_usable() || !kernel_neon_free())
+		return __memcpy_arm(dest, src, n);
+
+	while (n) {
+		len = min_t(size_t, n, NEON_COPY_CHUNK);
+
+		kernel_neon_begin();
+		__memcpy_neon(d, s, len);
+		kernel_neon_end();
+
+		d += len;
+		s += len;
+		n -= len;
+	}
+
+	return dest;
+}
@@ -43,6 +43,7 @@
 
 #include "sdram-qimonda-hyb18m512160af-6.h"
 #include "mmc-twl4030.h"
+#include "voltage.h"
 
 #define CONFIG_DISABLE_HFCLK 1
 
@@ -513,6 +514,8 @@ static void __init omap_3430sdp_init(void)
 	board_smc91x_init();
 	enable_board_wakeup_source();
 	usb_ehci_init(&ehci_pdata);
+	/* the TWL4030 has SmartReflex enabled by the bootloader */
+	omap3_voltage_init();
 }
 
 static void __init omap_3430sdp_map_io(void)
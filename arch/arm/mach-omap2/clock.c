@@ -332,35 +332,66 @@ void omap2_clk_dflt_find_idlest(struct clk *clk, void __iomem **idlest_reg,
 }
 
 /**
- * omap2_module_wait_ready - wait for an OMAP module to leave IDLE
+ * _omap2_module_idlest - find the CM_IDLEST bit to wait on for @clk
  * @clk: struct clk * belonging to the module
+ * @idlest_reg: void __iomem ** to return the CM_IDLEST va in
+ * @idlest_mask: u32 * to return the CM_IDLEST bit mask in
  *
  * If the necessary clocks for the OMAP hardware IP block that
- * corresponds to clock @clk are enabled, then wait for the module to
- * indicate readiness (i.e., to leave IDLE).  This code does not
- * belong in the clock code and will be moved in the medium term to
- * module-dependent code.  No return value.
+ * corresponds to clock @clk are enabled, return the CM_IDLEST bit
+ * that indicates the module's readiness (i.e., that it has left
+ * IDLE).  This code does not belong in the clock code and will be
+ * moved in the medium term to module-dependent code.  Returns 0 if
+ * there is something to wait for, or -ENOENT if not.
  */
-static void omap2_module_wait_ready(struct clk *clk)
+static int _omap2_module_idlest(struct clk *clk, void __iomem **idlest_reg,
+				u32 *idlest_mask)
 {
-	void __iomem *companion_reg, *idlest_reg;
+	void __iomem *companion_reg;
 	u8 other_bit, idlest_bit;
 
+	if (!clk->ops->find_idlest)
+		return -ENOENT;
+
 	/* Not all modules have multiple clocks that their IDLEST depends on */
 	if (clk->ops->find_companion) {
 		clk->ops->find_companion(clk, &companion_reg, &other_bit);
-		if (!(__raw_readl(companion_reg) & (1 << other_bit)))
-			return;
+		if (!(prcm_shadow_read(companion_reg) & (1 << other_bit)))
+			return -ENOENT;
 	}
 
-	clk->ops->find_idlest(clk, &idlest_reg, &idlest_bit);
+	clk->ops->find_idlest(clk, idlest_reg, &idlest_bit);
+	*idlest_mask = 1 << idlest_bit;
+
+	return 0;
+}
+
+/**
+ * omap2_module_wait_ready - wait for an OMAP module to leave IDLE
+ * @clk: struct clk * belonging to the module
+ *
+ * Wait for the module @clk belongs to to indicate readiness, if its
+ * clocks are all enabled.  No return value.
+ */
+static void omap2_module_wait_ready(struct clk *clk)
+{
+	void __iomem *idlest_reg;
+	u32 idlest_mask;
 
-	omap2_cm_wait_idlest(idlest_reg, (1 << idlest_bit), clk->name);
+	if (!_omap2_module_idlest(clk, &idlest_reg, &idlest_mask))
+		omap2_cm_wait_idlest(idlest_reg, idlest_mask, clk->name);
 }
 
+/*
+ * Set by omap2_clk_enable_nowait() while it walks the clock tree, so
+ * that omap2_dflt_clk_enable() leaves the CM_IDLEST polling to
+ * omap2_clk_wait_ready().  Protected by the clock framework lock.
+ */
+static int omap2_clk_nowait;
+
 int omap2_dflt_clk_enable(struct clk *clk)
 {
-	u32 v;
+	u32 v, nv;
 
 	if (unlikely(clk->enable_reg == NULL)) {
 		pr_err("clock.c: Enable for %s without enable code\n",
@@ -368,15 +399,21 @@ int omap2_dflt_clk_enable(struct clk *clk)
 		return 0; /* REVISIT: -EINVAL */
 	}
 
+	/*
+	 * Always write, and start from the register rather than the
+	 * shadow: the secure side or context loss may have changed it
+	 * behind our back, and stale bits must not be written back.
+	 */
 	v = __raw_readl(clk->enable_reg);
 	if (clk->flags & INVERT_ENABLE)
-		v &= ~(1 << clk->enable_bit);
+		nv = v & ~(1 << clk->enable_bit);
 	else
-		v |= (1 << clk->enable_bit);
-	__raw_writel(v, clk->enable_reg);
+		nv = v | (1 << clk->enable_bit);
+
+	prcm_shadow_write(nv, clk->enable_reg);
 	v = __raw_readl(clk->enable_reg); /* OCP barrier */
 
-	if (clk->ops->find_idlest)
+	if (clk->ops->find_idlest && !omap2_clk_nowait)
 		omap2_module_wait_ready(clk);
 
 	return 0;
@@ -384,7 +421,7 @@ int omap2_dflt_clk_enable(struct clk *clk)
 
 void omap2_dflt_clk_disable(struct clk *clk)
 {
-	u32 v;
+	u32 v, nv;
 
 	if (!clk->enable_reg) {
 		/*
@@ -396,12 +433,13 @@ void omap2_dflt_clk_disable(struct clk *clk)
 		return;
 	}
 
-	v = __raw_readl(clk->enable_reg);
+	v = prcm_shadow_read(clk->enable_reg);
 	if (clk->flags & INVERT_ENABLE)
-		v |= (1 << clk->enable_bit);
+		nv = v | (1 << clk->enable_bit);
 	else
-		v &= ~(1 << clk->enable_bit);
-	__raw_writel(v, clk->enable_reg);
+		nv = v & ~(1 << clk->enable_bit);
+	if (nv != v)
+		prcm_shadow_write(nv, clk->enable_reg);
 	/* No OCP barrier needed here since it is a disable operation */
 }
 
@@ -474,6 +512,76 @@ err:
 	return ret;
 }
 
+/**
+ * omap2_clk_enable_nowait - enable a clock, leaving out CM_IDLEST polling
+ * @clk: struct clk * to enable
+ *
+ * Like omap2_clk_enable(), but returns as soon as the clock tree has
+ * been programmed, without waiting for the modules it enabled to leave
+ * IDLE.  The caller must then call omap2_clk_wait_ready(), which does
+ * not need the clock framework lock, so that the wait is done with
+ * interrupts enabled.
+ */
+int omap2_clk_enable_nowait(struct clk *clk)
+{
+	int ret;
+
+	omap2_clk_nowait = 1;
+	ret = omap2_clk_enable(clk);
+	omap2_clk_nowait = 0;
+
+	return ret;
+}
+
+/* Modules whose CM_IDLEST bits omap2_clk_wait_ready() polls in one go */
+#define MAX_IDLEST_BATCH		4
+
+/**
+ * omap2_clk_wait_ready - wait for the modules behind @clk to leave IDLE
+ * @clk: struct clk * enabled with omap2_clk_enable_nowait()
+ *
+ * Walk @clk and its parents and wait until every module whose clocks
+ * are all enabled reports readiness.  Modules sharing a CM_IDLEST
+ * register, i.e. sitting in the same CM module, are polled with a
+ * single combined mask.  clk_enable() calls this for every enable,
+ * including ones which found @clk already on.  No return value.
+ */
+void omap2_clk_wait_ready(struct clk *clk)
+{
+	struct {
+		void __iomem	*reg;
+		u32		mask;
+		const char	*name;
+	} batch[MAX_IDLEST_BATCH];
+	void __iomem *reg;
+	u32 mask;
+	int i, n = 0;
+
+	for (; clk; clk = clk->parent) {
+		if (_omap2_module_idlest(clk, &reg, &mask))
+			continue;
+
+		for (i = 0; i < n; i++)
+			if (batch[i].reg == reg)
+				break;
+
+		if (i < n) {
+			batch[i].mask |= mask;
+		} else if (n < MAX_IDLEST_BATCH) {
+			batch[n].reg = reg;
+			batch[n].mask = mask;
+			batch[n].name = clk->name;
+			n++;
+		} else {
+			omap2_cm_wait_idlest(reg, mask, clk->name);
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		omap2_cm_wait_idlest(batch[i].reg, batch[i].mask,
+				     batch[i].name);
+}
+
 /*
  * Used for clocks that are part of CLKSEL_xyz governed clocks.
  * REVISIT: Maybe change to use clk->enable() functions like on omap1?
@@ -731,7 +839,7 @@ int omap2_clksel_set_rate(struct clk *clk, unsigned long rate)
 	v = __raw_readl(clk->clksel_reg);
 	v &= ~clk->clksel_mask;
 	v |= field_val << __ffs(clk->clksel_mask);
-	__raw_writel(v, clk->clksel_reg);
+	prcm_shadow_write(v, clk->clksel_reg);
 	v = __raw_readl(clk->clksel_reg); /* OCP barrier */
 
 	clk->rate = clk->parent->rate / new_div;
@@ -795,6 +903,28 @@ static u32 _omap2_clksel_get_src_field(struct clk *src_clk, struct clk *clk,
 	return clkr->div;
 }
 
+/**
+ * omap2_clk_round_parent - rate a clock would run at from another parent
+ * @clk: OMAP struct clk to reparent
+ * @new_parent: candidate parent
+ *
+ * Returns the rate omap2_clk_set_parent() would leave @clk at, or
+ * -EINVAL if it would refuse @new_parent.
+ */
+long omap2_clk_round_parent(struct clk *clk, struct clk *new_parent)
+{
+	u32 field_val, parent_div;
+
+	if (clk->flags & CONFIG_PARTICIPANT || !clk->clksel)
+		return -EINVAL;
+
+	parent_div = _omap2_clksel_get_src_field(new_parent, clk, &field_val);
+	if (!parent_div)
+		return -EINVAL;
+
+	return new_parent->rate / parent_div;
+}
+
 int omap2_clk_set_parent(struct clk *clk, struct clk *new_parent)
 {
 	u32 field_val, v, parent_div;
@@ -813,7 +943,7 @@ int omap2_clk_set_parent(struct clk *clk, struct clk *new_parent)
 	v = __raw_readl(clk->clksel_reg);
 	v &= ~clk->clksel_mask;
 	v |= field_val << __ffs(clk->clksel_mask);
-	__raw_writel(v, clk->clksel_reg);
+	prcm_shadow_write(v, clk->clksel_reg);
 	v = __raw_readl(clk->clksel_reg);    /* OCP barrier */
 
 	_omap2xxx_clk_commit(clk);
@@ -38,10 +38,13 @@
 
 int omap2_clk_init(void);
 int omap2_clk_enable(struct clk *clk);
+int omap2_clk_enable_nowait(struct clk *clk);
+void omap2_clk_wait_ready(struct clk *clk);
 void omap2_clk_disable(struct clk *clk);
 long omap2_clk_round_rate(struct clk *clk, unsigned long rate);
 int omap2_clk_set_rate(struct clk *clk, unsigned long rate);
 int omap2_clk_set_parent(struct clk *clk, struct clk *new_parent);
+long omap2_clk_round_parent(struct clk *clk, struct clk *new_parent);
 int omap2_dpll_set_rate_tolerance(struct clk *clk, unsigned int tolerance);
 long omap2_dpll_round_rate(struct clk *clk, unsigned long target_rate);
 
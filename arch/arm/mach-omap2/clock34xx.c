@@ -26,19 +26,23 @@
 #include <linux/io.h>
 #include <linux/limits.h>
 #include <linux/bitops.h>
+#include <linux/cpufreq.h>
 
 #include <plat/cpu.h>
 #include <plat/clock.h>
+#include <plat/prcm.h>
 #include <plat/sram.h>
 #include <asm/div64.h>
 #include <asm/clkdev.h>
 
 #include <plat/sdrc.h>
+#include <plat/omap-pm.h>
 #include "clock.h"
 #include "prm.h"
 #include "prm-regbits-34xx.h"
 #include "cm.h"
 #include "cm-regbits-34xx.h"
+#include "voltage.h"
 
 static const struct clkops clkops_noncore_dpll_ops;
 
@@ -110,6 +114,7 @@ static struct omap_clk omap34xx_clks[] = {
 	CLK(NULL,	"dpll1_ck",	&dpll1_ck,	CK_343X),
 	CLK(NULL,	"dpll1_x2_ck",	&dpll1_x2_ck,	CK_343X),
 	CLK(NULL,	"dpll1_x2m2_ck", &dpll1_x2m2_ck, CK_343X),
+	CLK(NULL,	"virt_vdd1_prcm_set", &virt_vdd1_prcm_set, CK_343X),
 	CLK(NULL,	"dpll2_ck",	&dpll2_ck,	CK_343X),
 	CLK(NULL,	"dpll2_m2_ck",	&dpll2_m2_ck,	CK_343X),
 	CLK(NULL,	"dpll3_ck",	&dpll3_ck,	CK_343X),
@@ -201,6 +206,7 @@ static struct omap_clk omap34xx_clks[] = {
 	CLK(NULL,	"security_l3_ick", &security_l3_ick, CK_343X),
 	CLK(NULL,	"pka_ick",	&pka_ick,	CK_343X),
 	CLK(NULL,	"core_l4_ick",	&core_l4_ick,	CK_343X),
+	CLK(NULL,	"elm_ick",	&elm_ick,	CK_343X),
 	CLK(NULL,	"usbtll_ick",	&usbtll_ick,	CK_3430ES2),
 	CLK("mmci-omap-hs.2",	"ick",	&mmchs3_ick,	CK_3430ES2),
 	CLK(NULL,	"icr_ick",	&icr_ick,	CK_343X),
@@ -434,7 +440,7 @@ static void _omap3_dpll_write_clken(struct clk *clk, u8 clken_bits)
 	v = __raw_readl(dd->control_reg);
 	v &= ~dd->enable_mask;
 	v |= clken_bits << __ffs(dd->enable_mask);
-	__raw_writel(v, dd->control_reg);
+	prcm_shadow_write(v, dd->control_reg);
 }
 
 /* _omap3_wait_dpll_status: wait for a DPLL to enter a specific state */
@@ -700,7 +706,7 @@ static int omap3_noncore_dpll_program(struct clk *clk, u16 m, u8 n, u16 freqsel)
 	v = __raw_readl(dd->control_reg);
 	v &= ~dd->freqsel_mask;
 	v |= freqsel << __ffs(dd->freqsel_mask);
-	__raw_writel(v, dd->control_reg);
+	prcm_shadow_write(v, dd->control_reg);
 
 	/* Set DPLL multiplier, divider */
 	v = __raw_readl(dd->mult_div1_reg);
@@ -823,6 +829,37 @@ static int omap3_dpll4_set_rate(struct clk *clk, unsigned long rate)
  * is clocked from DPLL3.
  */
 
+/* DPLL1 and CORE DPLL M2 rates the bootloader left, see below */
+static unsigned long omap3_boot_mpu_rate;
+static unsigned long omap3_boot_core_m2_rate;
+
+/**
+ * omap3_find_l3_opp - find the VDD2 OPP for a new CORE DPLL M2 rate
+ * @m2_rate: target dpll3_m2_ck rate
+ *
+ * Returns the slowest L3 OPP covering the L3 rate that will result, the
+ * fastest one if none does, or NULL if there is no L3 OPP table.
+ */
+static struct omap_opp *omap3_find_l3_opp(unsigned long m2_rate)
+{
+	struct omap_opp *opp;
+	unsigned long l3_rate, l3_div;
+
+	if (!l3_opps || !l3_ick.rate)
+		return NULL;
+
+	l3_div = dpll3_m2_ck.rate / l3_ick.rate;
+	l3_rate = m2_rate / (l3_div ? l3_div : 1);
+
+	opp = opp_find_rate_ceil(l3_opps, &l3_rate);
+	if (!opp) {
+		l3_rate = ULONG_MAX;
+		opp = opp_find_rate_floor(l3_opps, &l3_rate);
+	}
+
+	return opp;
+}
+
 /**
  * omap3_core_dpll_m2_set_rate - set CORE DPLL M2 divider
  * @clk: struct clk * of DPLL to set
@@ -839,6 +876,9 @@ static int omap3_core_dpll_m2_set_rate(struct clk *clk, unsigned long rate)
 	unsigned long validrate, sdrcrate, mpurate;
 	struct omap_sdrc_params *sdrc_cs0;
 	struct omap_sdrc_params *sdrc_cs1;
+	struct omap_opp *l3_opp;
+	ktime_t start;
+	u16 old_vdd = 0;
 	int ret;
 
 	if (!clk || !rate)
@@ -851,6 +891,20 @@ static int omap3_core_dpll_m2_set_rate(struct clk *clk, unsigned long rate)
 	if (validrate != rate)
 		return -EINVAL;
 
+	if (rate > omap3_boot_core_m2_rate && !omap_voltage_ready())
+		return -EINVAL;
+
+	start = ktime_get();
+
+	/* CORE runs from VDD2: raise it before speeding up */
+	l3_opp = omap3_find_l3_opp(rate);
+	if (l3_opp && rate > clk->rate) {
+		old_vdd = omap_voltage_get(VDD2);
+		ret = omap_voltage_scale(VDD2, l3_opp->min_vdd);
+		if (ret)
+			return ret;
+	}
+
 	sdrcrate = sdrc_ick.rate;
 	if (rate > clk->rate)
 		sdrcrate <<= ((rate / clk->rate) >> 1);
@@ -858,8 +912,12 @@ static int omap3_core_dpll_m2_set_rate(struct clk *clk, unsigned long rate)
 		sdrcrate >>= ((clk->rate / rate) >> 1);
 
 	ret = omap2_sdrc_get_params(sdrcrate, &sdrc_cs0, &sdrc_cs1);
-	if (ret)
+	if (ret) {
+		/* the DPLL was left alone: drop VDD2 back where it was */
+		if (old_vdd)
+			omap_voltage_scale(VDD2, old_vdd);
 		return -EINVAL;
+	}
 
 	if (sdrcrate < MIN_SDRC_DLL_LOCK_FREQ) {
 		pr_debug("clock: will unlock SDRC DLL\n");
@@ -903,9 +961,166 @@ static int omap3_core_dpll_m2_set_rate(struct clk *clk, unsigned long rate)
 				  sdrc_cs0->actim_ctrlb, sdrc_cs0->mr,
 				  0, 0, 0, 0);
 
+	/* the SRAM code has rewritten CM_CLKSEL1_PLL directly */
+	prcm_shadow_invalidate();
+
+	/* ... and lower it only once slowed down */
+	if (l3_opp && rate < clk->rate)
+		omap_voltage_scale(VDD2, l3_opp->min_vdd);
+
+	if (l3_opp)
+		omap_dvfs_account(VDD2, start);
+
 	return 0;
 }
 
+/*
+ * OPP (DVFS) functions
+ *
+ * VDD1 is scaled through the virt_vdd1_prcm_set clock, VDD2 follows the
+ * CORE DPLL M2 rate in omap3_core_dpll_m2_set_rate() above.  In both
+ * cases the voltage is raised before and lowered after the frequency
+ * change, so the domain never runs faster than its voltage allows.
+ *
+ * Unless the board has set up the voltage controller, the boot voltages
+ * are all we have, so neither VDD may go above its boot rate.
+ */
+
+/**
+ * omap3_round_to_table_rate - round a rate to an enabled MPU OPP
+ * @clk: virt_vdd1_prcm_set struct clk
+ * @rate: desired MPU rate
+ *
+ * Returns the fastest enabled MPU OPP not above @rate, or the slowest
+ * enabled one if @rate is below all of them.
+ */
+static long omap3_round_to_table_rate(struct clk *clk, unsigned long rate)
+{
+	unsigned long r = rate;
+
+	if (clk != &virt_vdd1_prcm_set || !mpu_opps)
+		return -EINVAL;
+
+	if (r > omap3_boot_mpu_rate && !omap_voltage_ready())
+		r = omap3_boot_mpu_rate;
+
+	if (opp_find_rate_floor(mpu_opps, &r))
+		return r;
+
+	r = 0;
+	if (opp_find_rate_ceil(mpu_opps, &r))
+		return r;
+
+	return -EINVAL;
+}
+
+/*
+ * Set the rate of a DPLL that is not the clock clk_set_rate() was
+ * called on, with the same rate change notifications.
+ */
+static int omap3_dpll_set_rate(struct clk *clk, unsigned long rate)
+{
+	unsigned long old_rate = clk->rate;
+	int ret;
+
+	ret = clk_rate_change_begin(clk, rate);
+	if (ret)
+		return ret;
+
+	ret = clk->set_rate(clk, rate);
+	clk_rate_change_finish(clk, old_rate, ret);
+
+	return ret;
+}
+
+/**
+ * omap3_select_table_rate - switch VDD1 to the OPP for an MPU rate
+ * @clk: virt_vdd1_prcm_set struct clk
+ * @rate: MPU rate of an enabled MPU OPP
+ *
+ * Moves DPLL1 to @rate and DPLL2 to the DSP OPP with the same ID, then
+ * sets VDD1 to the voltage of that OPP.  DPLL2 is reprogrammed even
+ * while the IVA2 is off, so that it comes up within the VDD1 OPP.
+ * Returns -EINVAL if @rate is not an enabled OPP.
+ */
+static int omap3_select_table_rate(struct clk *clk, unsigned long rate)
+{
+	struct omap_opp *mpu_opp, *dsp_opp = NULL;
+	unsigned long cur_rate = dpll1_ck.rate;
+	ktime_t start;
+	int ret;
+
+	if (clk != &virt_vdd1_prcm_set || !mpu_opps)
+		return -EINVAL;
+
+	mpu_opp = opp_find_rate_exact(mpu_opps, rate, true);
+	if (!mpu_opp)
+		return -EINVAL;
+
+	if (rate > omap3_boot_mpu_rate && !omap_voltage_ready())
+		return -EINVAL;
+
+	if (dsp_opps)
+		dsp_opp = opp_find_id(dsp_opps, mpu_opp->opp_id);
+
+	start = ktime_get();
+
+	if (rate > cur_rate) {
+		ret = omap_voltage_scale(VDD1, mpu_opp->min_vdd);
+		if (ret)
+			return ret;
+	}
+
+	ret = omap3_dpll_set_rate(&dpll1_ck, rate);
+	if (ret) {
+		pr_err("clock: unable to set MPU rate %lu\n", rate);
+		goto out;
+	}
+
+	if (dsp_opp) {
+		if (omap3_dpll_set_rate(&dpll2_ck, dsp_opp->rate))
+			pr_err("clock: unable to set IVA2 rate %lu\n",
+			       dsp_opp->rate);
+		/* programming locks the DPLL, stop it again if unused */
+		if (!dpll2_ck.usecount)
+			omap3_noncore_dpll_disable(&dpll2_ck);
+	}
+
+	if (rate < cur_rate)
+		omap_voltage_scale(VDD1, mpu_opp->min_vdd);
+
+out:
+	/* if DPLL1 did not move, go back to the voltage it needs */
+	if (ret && rate > cur_rate) {
+		mpu_opp = opp_find_rate_exact(mpu_opps, cur_rate, true);
+		if (mpu_opp)
+			omap_voltage_scale(VDD1, mpu_opp->min_vdd);
+	}
+
+	if (!ret)
+		omap_dvfs_account(VDD1, start);
+
+	return ret;
+}
+
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Build the cpufreq table from the enabled MPU OPPs
+ */
+static void omap3_clk_init_cpufreq_table(struct cpufreq_frequency_table **table)
+{
+	struct omap_opp *opp;
+
+	/* boards have set up the voltage controller by now, or never will */
+	if (mpu_opps && !omap_voltage_ready())
+		for (opp = mpu_opps; opp->rate; opp++)
+			if (opp->rate > omap3_boot_mpu_rate)
+				opp_disable(opp);
+
+	opp_init_cpufreq_table(mpu_opps, table);
+}
+#endif
+
 
 static const struct clkops clkops_noncore_dpll_ops = {
 	.enable		= &omap3_noncore_dpll_enable,
@@ -1038,12 +1253,17 @@ static unsigned long omap3_clkoutx2_recalc(struct clk *clk)
 #if defined(CONFIG_ARCH_OMAP3)
 
 static struct clk_functions omap2_clk_functions = {
-	.clk_enable		= omap2_clk_enable,
+	.clk_enable		= omap2_clk_enable_nowait,
+	.clk_wait_ready		= omap2_clk_wait_ready,
 	.clk_disable		= omap2_clk_disable,
 	.clk_round_rate		= omap2_clk_round_rate,
 	.clk_set_rate		= omap2_clk_set_rate,
 	.clk_set_parent		= omap2_clk_set_parent,
+	.clk_round_parent	= omap2_clk_round_parent,
 	.clk_disable_unused	= omap2_clk_disable_unused,
+#ifdef CONFIG_CPU_FREQ
+	.clk_init_cpufreq_table	= omap3_clk_init_cpufreq_table,
+#endif
 };
 
 /*
@@ -1166,6 +1386,9 @@ int __init omap2_clk_init(void)
 
 	recalculate_root_clocks();
 
+	omap3_boot_mpu_rate = dpll1_ck.rate;
+	omap3_boot_core_m2_rate = dpll3_m2_ck.rate;
+
 	printk(KERN_INFO "Clocking rate (Crystal/Core/MPU): "
 	       "%ld.%01ld/%ld/%ld MHz\n",
 	       (osc_sys_ck.rate / 1000000), (osc_sys_ck.rate / 100000) % 10,
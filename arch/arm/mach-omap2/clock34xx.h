@@ -37,6 +37,8 @@ static u32 omap3_dpll_autoidle_read(struct clk *clk);
 static int omap3_noncore_dpll_set_rate(struct clk *clk, unsigned long rate);
 static int omap3_dpll4_set_rate(struct clk *clk, unsigned long rate);
 static int omap3_core_dpll_m2_set_rate(struct clk *clk, unsigned long rate);
+static long omap3_round_to_table_rate(struct clk *clk, unsigned long rate);
+static int omap3_select_table_rate(struct clk *clk, unsigned long rate);
 
 /* Maximum DPLL multiplier, divider values for OMAP3 */
 #define OMAP3_MAX_DPLL_MULT		2048
@@ -1690,6 +1692,18 @@ static struct clk core_l4_ick = {
 	.recalc		= &followparent_recalc,
 };
 
+/*
+ * The ELM has no CM enable bit of its own: it runs off the CORE L4
+ * interface clock, and using it only has to keep that domain awake.
+ */
+static struct clk elm_ick = {
+	.name		= "elm_ick",
+	.ops		= &clkops_null,
+	.parent		= &core_l4_ick,
+	.clkdm_name	= "core_l4_clkdm",
+	.recalc		= &followparent_recalc,
+};
+
 static struct clk usbtll_ick = {
 	.name		= "usbtll_ick",
 	.ops		= &clkops_omap2_dflt_wait,
@@ -2990,4 +3004,18 @@ static struct clk wdt1_fck = {
 	.recalc		= &followparent_recalc,
 };
 
+/*
+ * VDD1 OPP clock: its rate is the MPU OPP, and changing it moves the
+ * MPU and IVA2 DPLLs and the VDD1 voltage together.  Keyed on the
+ * dpll1_ck rate.
+ */
+static struct clk virt_vdd1_prcm_set = {
+	.name		= "virt_vdd1_prcm_set",
+	.ops		= &clkops_null,
+	.parent		= &dpll1_ck,
+	.recalc		= &followparent_recalc,
+	.set_rate	= &omap3_select_table_rate,
+	.round_rate	= &omap3_round_to_table_rate,
+};
+
 #endif
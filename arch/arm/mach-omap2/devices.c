@@ -15,6 +15,7 @@
 #include <linux/platform_device.h>
 #include <linux/io.h>
 #include <linux/clk.h>
+#include <linux/dma-mapping.h>
 
 #include <mach/hardware.h>
 #include <asm/mach-types.h>
@@ -134,6 +135,27 @@ static inline void omap_init_camera(void)
 }
 #endif
 
+#if defined(CONFIG_DMA_OMAP) || defined(CONFIG_DMA_OMAP_MODULE)
+
+static u64 omap_dma_engine_dmamask = DMA_BIT_MASK(32);
+
+static struct platform_device omap_dma_engine_device = {
+	.name		= "omap-dma-engine",
+	.id		= -1,
+	.dev		= {
+		.dma_mask		= &omap_dma_engine_dmamask,
+		.coherent_dma_mask	= DMA_BIT_MASK(32),
+	},
+};
+
+static inline void omap_init_dma_engine(void)
+{
+	platform_device_register(&omap_dma_engine_device);
+}
+#else
+static inline void omap_init_dma_engine(void) { }
+#endif
+
 #if defined(CONFIG_OMAP_MBOX_FWK) || defined(CONFIG_OMAP_MBOX_FWK_MODULE)
 
 #define MBOX_REG_SIZE	0x120
@@ -726,6 +748,7 @@ static int __init omap2_init_devices(void)
 	 */
 	omap_hsmmc_reset();
 	omap_init_camera();
+	omap_init_dma_engine();
 	omap_init_mbox();
 	omap_init_mcspi();
 	omap_hdq_init();
@@ -0,0 +1,186 @@
+/*
+ * OMAP3 Error Location Module
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The ELM solves the BCH error locator polynomial in hardware: given
+ * the syndrome of a codeword (as produced by the GPMC BCH engine) it
+ * returns the bit positions in error, counted from the end of the
+ * codeword, in a few microseconds.  Only syndrome channel 0 is used, in
+ * continuous mode, so one codeword is decoded at a time.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/spinlock.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/io.h>
+
+#include <mach/hardware.h>
+#include <plat/cpu.h>
+#include <plat/elm.h>
+
+#define ELM_SYSCONFIG			0x010
+#define ELM_SYSSTATUS			0x014
+#define ELM_IRQSTATUS			0x018
+#define ELM_LOCATION_CONFIG		0x020
+#define ELM_PAGE_CTRL			0x080
+#define ELM_SYNDROME_FRAGMENT(n)	(0x400 + (n) * 4)
+#define ELM_LOCATION_STATUS		0x800
+#define ELM_ERROR_LOCATION(n)		(0x880 + (n) * 4)
+
+#define ELM_SYSCONFIG_SOFTRESET		(1 << 1)
+#define ELM_SYSCONFIG_SIDLE_SMART	(2 << 3)
+#define ELM_SYSSTATUS_RESETDONE		(1 << 0)
+
+#define ELM_IRQ_LOC_VALID_0		(1 << 0)
+
+/* largest buffer the locator covers, in nibbles */
+#define ELM_ECC_SIZE			(0x7ff << 16)
+
+#define ELM_SYNDROME_VALID		(1 << 16)
+
+#define ELM_CORRECTABLE			(1 << 8)
+#define ELM_NB_ERRORS_MASK		0x1f
+#define ELM_ERROR_LOCATION_MASK		0x1fff
+
+/* in us, a codeword takes well under 10 */
+#define ELM_TIMEOUT			100
+
+static void __iomem *elm_base;
+static struct clk *elm_ick;
+static DEFINE_SPINLOCK(elm_lock);
+static int elm_users;
+
+static inline void elm_write_reg(int idx, u32 val)
+{
+	__raw_writel(val, elm_base + idx);
+}
+
+static inline u32 elm_read_reg(int idx)
+{
+	return __raw_readl(elm_base + idx);
+}
+
+/**
+ * omap_elm_request - get the ELM for decoding
+ * @bch: error correction capability of the codewords
+ *
+ * The ELM has a single user; returns -EBUSY if it is taken.  Its
+ * interface clock stays enabled until omap_elm_free().
+ */
+int omap_elm_request(enum omap_elm_bch bch)
+{
+	int timeout = ELM_TIMEOUT;
+	int err;
+
+	if (!cpu_is_omap34xx())
+		return -ENODEV;
+
+	spin_lock(&elm_lock);
+	if (elm_users) {
+		spin_unlock(&elm_lock);
+		return -EBUSY;
+	}
+	elm_users++;
+	spin_unlock(&elm_lock);
+
+	elm_ick = clk_get(NULL, "elm_ick");
+	if (IS_ERR(elm_ick)) {
+		err = PTR_ERR(elm_ick);
+		elm_ick = NULL;
+		omap_elm_free();
+		return err;
+	}
+	clk_enable(elm_ick);
+
+	elm_base = ioremap(OMAP34XX_ELM_BASE, SZ_4K);
+	if (!elm_base) {
+		omap_elm_free();
+		return -ENOMEM;
+	}
+
+	elm_write_reg(ELM_SYSCONFIG, ELM_SYSCONFIG_SOFTRESET);
+	while (!(elm_read_reg(ELM_SYSSTATUS) & ELM_SYSSTATUS_RESETDONE)) {
+		if (!--timeout) {
+			printk(KERN_ERR "elm: reset timed out\n");
+			omap_elm_free();
+			return -ETIMEDOUT;
+		}
+		udelay(1);
+	}
+	elm_write_reg(ELM_SYSCONFIG, ELM_SYSCONFIG_SIDLE_SMART);
+
+	elm_write_reg(ELM_LOCATION_CONFIG, ELM_ECC_SIZE | bch);
+	elm_write_reg(ELM_PAGE_CTRL, 0);
+	elm_write_reg(ELM_IRQSTATUS, elm_read_reg(ELM_IRQSTATUS));
+
+	return 0;
+}
+EXPORT_SYMBOL(omap_elm_request);
+
+void omap_elm_free(void)
+{
+	if (elm_base)
+		iounmap(elm_base);
+	elm_base = NULL;
+
+	if (elm_ick) {
+		clk_disable(elm_ick);
+		clk_put(elm_ick);
+	}
+	elm_ick = NULL;
+
+	spin_lock(&elm_lock);
+	elm_users--;
+	spin_unlock(&elm_lock);
+}
+EXPORT_SYMBOL(omap_elm_free);
+
+/**
+ * omap_elm_locate - find the bits in error in a codeword
+ * @syndrome: syndrome polynomial, least significant fragment first
+ * @nfrags: OMAP_ELM_BCH4_FRAGS or OMAP_ELM_BCH8_FRAGS
+ * @err_loc: filled with up to OMAP_ELM_MAX_ERRORS bit positions
+ *
+ * Returns the number of errors located, or -EBADMSG if the codeword
+ * cannot be corrected.
+ */
+int omap_elm_locate(const u32 *syndrome, int nfrags, u16 *err_loc)
+{
+	int i, nerr, timeout = ELM_TIMEOUT;
+	u32 status;
+
+	for (i = 0; i < nfrags; i++)
+		elm_write_reg(ELM_SYNDROME_FRAGMENT(i), syndrome[i]);
+
+	/* fragment 6 carries no syndrome bits below BCH16 */
+	elm_write_reg(ELM_SYNDROME_FRAGMENT(6), ELM_SYNDROME_VALID);
+
+	while (!(elm_read_reg(ELM_IRQSTATUS) & ELM_IRQ_LOC_VALID_0)) {
+		if (!--timeout) {
+			printk(KERN_ERR "elm: error location timed out\n");
+			return -ETIMEDOUT;
+		}
+		udelay(1);
+	}
+
+	status = elm_read_reg(ELM_LOCATION_STATUS);
+	elm_write_reg(ELM_IRQSTATUS, ELM_IRQ_LOC_VALID_0);
+
+	if (!(status & ELM_CORRECTABLE))
+		return -EBADMSG;
+
+	nerr = min_t(int, status & ELM_NB_ERRORS_MASK, OMAP_ELM_MAX_ERRORS);
+	for (i = 0; i < nerr; i++)
+		err_loc[i] = elm_read_reg(ELM_ERROR_LOCATION(i)) &
+			ELM_ERROR_LOCATION_MASK;
+
+	return nerr;
+}
+EXPORT_SYMBOL(omap_elm_locate);
@@ -22,9 +22,11 @@
 #include <linux/spinlock.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/interrupt.h>
 
 #include <asm/mach-types.h>
 #include <plat/gpmc.h>
+#include <mach/irqs.h>
 
 #include <plat/sdrc.h>
 
@@ -46,6 +48,7 @@
 #define GPMC_ECC_CONFIG		0x1f4
 #define GPMC_ECC_CONTROL	0x1f8
 #define GPMC_ECC_SIZE_CONFIG	0x1fc
+#define GPMC_BCH_RESULT(n)	(0x240 + (n) * 4)	/* sector 0 */
 
 #define GPMC_CS0		0x60
 #define GPMC_CS_SIZE		0x30
@@ -57,11 +60,20 @@
 #define GPMC_CHUNK_SHIFT	24		/* 16 MB */
 #define GPMC_SECTION_SHIFT	28		/* 128 MB */
 
-#define PREFETCH_FIFOTHRESHOLD	(0x40 << 8)
+#define PREFETCH_FIFOTHRESHOLD(val)	((val) << 8)
 #define CS_NUM_SHIFT		24
 #define ENABLE_PREFETCH		(0x1 << 7)
 #define DMA_MPU_MODE		2
 
+/* GPMC_ECC_CONFIG in BCH mode */
+#define ECC_CONFIG_BCH		(1 << 16)
+#define ECC_CONFIG_BCH8		(1 << 12)
+#define ECC_CONFIG_WRAPMODE(val)	((val) << 8)
+#define ECC_CONFIG_16B		(1 << 7)
+#define ECC_CONFIG_CS(cs)	((cs) << 1)
+#define ECC_CONFIG_ENABLE	(1 << 0)
+#define ECC_CONTROL_CLEAR_P1	0x101	/* clear results, pointer at 1 */
+
 static struct resource	gpmc_mem_root;
 static struct resource	gpmc_cs_mem[GPMC_CS_NUM];
 static DEFINE_SPINLOCK(gpmc_mem_lock);
@@ -71,6 +83,12 @@ static void __iomem *gpmc_base;
 
 static struct clk *gpmc_l3_clk;
 
+#define GPMC_PREFETCH_IRQ_MASK	(GPMC_IRQ_FIFOEVENT | GPMC_IRQ_COUNT_EVENT)
+
+static int gpmc_irq;
+static void (*gpmc_prefetch_handler)(u32 events, void *data);
+static void *gpmc_prefetch_data;
+
 static void gpmc_write_reg(int idx, u32 val)
 {
 	__raw_writel(val, gpmc_base + idx);
@@ -394,15 +412,20 @@ EXPORT_SYMBOL(gpmc_cs_free);
 /**
  * gpmc_prefetch_enable - configures and starts prefetch transfer
  * @cs: nand cs (chip select) number
+ * @fifo_th: fifo threshold in bytes, 1 to GPMC_PREFETCH_FIFOTHRESHOLD_MAX;
+ *	     when a dma request or GPMC_IRQ_FIFOEVENT is raised
  * @dma_mode: dma mode enable (1) or disable (0)
  * @u32_count: number of bytes to be transferred
  * @is_write: prefetch read(0) or write post(1) mode
  */
-int gpmc_prefetch_enable(int cs, int dma_mode,
+int gpmc_prefetch_enable(int cs, int fifo_th, int dma_mode,
 				unsigned int u32_count, int is_write)
 {
 	uint32_t prefetch_config1;
 
+	if (fifo_th < 1 || fifo_th > GPMC_PREFETCH_FIFOTHRESHOLD_MAX)
+		return -EINVAL;
+
 	if (!(gpmc_read_reg(GPMC_PREFETCH_CONTROL))) {
 		/* Set the amount of bytes to be prefetched */
 		gpmc_write_reg(GPMC_PREFETCH_CONFIG2, u32_count);
@@ -411,7 +434,7 @@ int gpmc_prefetch_enable(int cs, int dma_mode,
 		 * enable the engine. Set which cs is has requested for.
 		 */
 		prefetch_config1 = ((cs << CS_NUM_SHIFT) |
-					PREFETCH_FIFOTHRESHOLD |
+					PREFETCH_FIFOTHRESHOLD(fifo_th) |
 					ENABLE_PREFETCH |
 					(dma_mode << DMA_MPU_MODE) |
 					(0x1 & is_write));
@@ -448,6 +471,186 @@ int  gpmc_prefetch_status(void)
 }
 EXPORT_SYMBOL(gpmc_prefetch_status);
 
+static irqreturn_t gpmc_handle_irq(int irq, void *dev)
+{
+	u32 events;
+
+	events = gpmc_read_reg(GPMC_IRQSTATUS) &
+		gpmc_read_reg(GPMC_IRQENABLE) & GPMC_PREFETCH_IRQ_MASK;
+	if (!events)
+		return IRQ_NONE;
+
+	/* ack first, so that an event raised while handling is not lost */
+	gpmc_write_reg(GPMC_IRQSTATUS, events);
+
+	gpmc_prefetch_handler(events, gpmc_prefetch_data);
+
+	return IRQ_HANDLED;
+}
+
+/**
+ * gpmc_prefetch_irq_request - take over the prefetch engine interrupts
+ * @handler: called in hard irq context with the GPMC_IRQ_* events
+ *	     that occurred; they are acked already
+ * @data: passed to @handler
+ *
+ * The events still have to be enabled with gpmc_prefetch_irq_enable()
+ * for each transfer. Returns -ENODEV if the GPMC interrupt is not
+ * known on this chip, in which case the engine has to be polled.
+ */
+int gpmc_prefetch_irq_request(void (*handler)(u32 events, void *data),
+			      void *data)
+{
+	int ret;
+
+	if (!gpmc_irq)
+		return -ENODEV;
+
+	if (gpmc_prefetch_handler)
+		return -EBUSY;
+
+	gpmc_write_reg(GPMC_IRQENABLE, gpmc_read_reg(GPMC_IRQENABLE) &
+		       ~GPMC_PREFETCH_IRQ_MASK);
+
+	gpmc_prefetch_handler = handler;
+	gpmc_prefetch_data = data;
+
+	ret = request_irq(gpmc_irq, gpmc_handle_irq, 0, "gpmc",
+			  &gpmc_prefetch_handler);
+	if (ret)
+		gpmc_prefetch_handler = NULL;
+
+	return ret;
+}
+EXPORT_SYMBOL(gpmc_prefetch_irq_request);
+
+/**
+ * gpmc_prefetch_irq_free - release the prefetch engine interrupts
+ * @data: as given to gpmc_prefetch_irq_request()
+ */
+void gpmc_prefetch_irq_free(void *data)
+{
+	if (!gpmc_prefetch_handler || gpmc_prefetch_data != data)
+		return;
+
+	gpmc_prefetch_irq_disable(GPMC_PREFETCH_IRQ_MASK);
+	free_irq(gpmc_irq, &gpmc_prefetch_handler);
+	gpmc_prefetch_handler = NULL;
+}
+EXPORT_SYMBOL(gpmc_prefetch_irq_free);
+
+/**
+ * gpmc_prefetch_irq_enable - enable prefetch engine events
+ * @events: GPMC_IRQ_* events
+ *
+ * Stale events from an earlier transfer are cleared first.
+ */
+void gpmc_prefetch_irq_enable(u32 events)
+{
+	events &= GPMC_PREFETCH_IRQ_MASK;
+
+	gpmc_write_reg(GPMC_IRQSTATUS, events);
+	gpmc_write_reg(GPMC_IRQENABLE,
+		       gpmc_read_reg(GPMC_IRQENABLE) | events);
+}
+EXPORT_SYMBOL(gpmc_prefetch_irq_enable);
+
+/**
+ * gpmc_prefetch_irq_disable - disable prefetch engine events
+ * @events: GPMC_IRQ_* events
+ */
+void gpmc_prefetch_irq_disable(u32 events)
+{
+	gpmc_write_reg(GPMC_IRQENABLE, gpmc_read_reg(GPMC_IRQENABLE) &
+		       ~(events & GPMC_PREFETCH_IRQ_MASK));
+}
+EXPORT_SYMBOL(gpmc_prefetch_irq_disable);
+
+/**
+ * gpmc_enable_hwecc_bch - start BCH syndrome generation for a sector
+ * @cs: chip select of the NAND device
+ * @dev_width: 0 for an 8-bit, 1 for a 16-bit device
+ * @nerrors: correction capability, 4 or 8 bits per 512 bytes
+ *
+ * The engine then computes over the next 512 bytes read from or
+ * written to @cs; gpmc_calculate_ecc_bch() gets the result.
+ */
+int gpmc_enable_hwecc_bch(int cs, int dev_width, int nerrors)
+{
+	u32 val;
+
+	if (nerrors != 4 && nerrors != 8)
+		return -EINVAL;
+
+	gpmc_write_reg(GPMC_ECC_CONFIG, 0);
+
+	/* wrap mode 6: size0 = 0, the spare area is not processed */
+	gpmc_write_reg(GPMC_ECC_SIZE_CONFIG, (32 << 22) | (0 << 12));
+
+	val = ECC_CONFIG_BCH | ECC_CONFIG_WRAPMODE(6) | ECC_CONFIG_CS(cs) |
+		ECC_CONFIG_ENABLE;
+	if (nerrors == 8)
+		val |= ECC_CONFIG_BCH8;
+	if (dev_width)
+		val |= ECC_CONFIG_16B;
+	gpmc_write_reg(GPMC_ECC_CONFIG, val);
+
+	gpmc_write_reg(GPMC_ECC_CONTROL, ECC_CONTROL_CLEAR_P1);
+
+	return 0;
+}
+EXPORT_SYMBOL(gpmc_enable_hwecc_bch);
+
+/**
+ * gpmc_calculate_ecc_bch - read the BCH ecc of the last sector
+ * @nerrors: as passed to gpmc_enable_hwecc_bch()
+ * @ecc: 7 (BCH4) or 13 (BCH8) bytes, polynomial left-justified
+ *
+ * The remainder is xor'ed with the one of an all 0xff sector, so an
+ * erased page carries valid (all 0xff) ecc.  Xor'ing the ecc read
+ * back with the one calculated gives the syndrome of the errors.
+ */
+int gpmc_calculate_ecc_bch(int nerrors, u8 *ecc)
+{
+	u32 val1, val2, val3, val4;
+
+	val1 = gpmc_read_reg(GPMC_BCH_RESULT(0));
+	val2 = gpmc_read_reg(GPMC_BCH_RESULT(1));
+
+	gpmc_write_reg(GPMC_ECC_CONFIG, 0);
+
+	if (nerrors == 4) {
+		*ecc++ = 0x28 ^ ((val2 >> 12) & 0xff);
+		*ecc++ = 0x13 ^ ((val2 >> 4) & 0xff);
+		*ecc++ = 0xcc ^ (((val2 & 0xf) << 4) | ((val1 >> 28) & 0xf));
+		*ecc++ = 0x39 ^ ((val1 >> 20) & 0xff);
+		*ecc++ = 0x96 ^ ((val1 >> 12) & 0xff);
+		*ecc++ = 0xac ^ ((val1 >> 4) & 0xff);
+		*ecc++ = 0x7f ^ ((val1 & 0xf) << 4);
+		return 0;
+	}
+
+	val3 = gpmc_read_reg(GPMC_BCH_RESULT(2));
+	val4 = gpmc_read_reg(GPMC_BCH_RESULT(3));
+
+	*ecc++ = 0xef ^ (val4 & 0xff);
+	*ecc++ = 0x51 ^ ((val3 >> 24) & 0xff);
+	*ecc++ = 0x2e ^ ((val3 >> 16) & 0xff);
+	*ecc++ = 0x09 ^ ((val3 >> 8) & 0xff);
+	*ecc++ = 0xed ^ (val3 & 0xff);
+	*ecc++ = 0x93 ^ ((val2 >> 24) & 0xff);
+	*ecc++ = 0x9a ^ ((val2 >> 16) & 0xff);
+	*ecc++ = 0xc2 ^ ((val2 >> 8) & 0xff);
+	*ecc++ = 0x97 ^ (val2 & 0xff);
+	*ecc++ = 0x79 ^ ((val1 >> 24) & 0xff);
+	*ecc++ = 0xe5 ^ ((val1 >> 16) & 0xff);
+	*ecc++ = 0x24 ^ ((val1 >> 8) & 0xff);
+	*ecc++ = 0xb5 ^ (val1 & 0xff);
+
+	return 0;
+}
+EXPORT_SYMBOL(gpmc_calculate_ecc_bch);
+
 static void __init gpmc_mem_init(void)
 {
 	int cs;
@@ -486,9 +689,11 @@ void __init gpmc_init(void)
 			l = OMAP2420_GPMC_BASE;
 		else
 			l = OMAP34XX_GPMC_BASE;
+		gpmc_irq = INT_24XX_GPMC_IRQ;
 	} else if (cpu_is_omap34xx()) {
 		ck = "gpmc_fck";
 		l = OMAP34XX_GPMC_BASE;
+		gpmc_irq = INT_34XX_GPMC_IRQ;
 	} else if (cpu_is_omap44xx()) {
 		ck = "gpmc_fck";
 		l = OMAP44XX_GPMC_BASE;
@@ -43,6 +43,8 @@
 
 #include <plat/clockdomain.h>
 #include "clockdomains.h"
+
+#include "opp34xx.h"
 #endif
 #include <plat/omap_hwmod.h>
 #include "omap_hwmod_2420.h"
@@ -316,7 +318,11 @@ void __init omap2_init_common_hw(struct omap_sdrc_params *sdrc_cs0,
 	/* The OPP tables have to be registered before a clk init */
 	omap_hwmod_init(hwmods);
 	omap2_mux_init();
-	omap_pm_if_early_init(mpu_opps, dsp_opps, l3_opps);
+	if (cpu_is_omap34xx())
+		omap_pm_if_early_init(omap3_mpu_opps, omap3_dsp_opps,
+				      omap3_l3_opps);
+	else
+		omap_pm_if_early_init(mpu_opps, dsp_opps, l3_opps);
 	pwrdm_init(powerdomains_omap);
 	clkdm_init(clockdomains_omap, clkdm_pwrdm_autodeps);
 	omap2_clk_init();
@@ -23,6 +23,7 @@
 #include <plat/control.h>
 #include <plat/mmc.h>
 #include <plat/board.h>
+#include <plat/powerdomain.h>
 
 #include "mmc-twl4030.h"
 
@@ -202,8 +203,8 @@ static int twl_mmc_resume(struct device *dev, int slot)
 
 static int twl4030_mmc_get_context_loss(struct device *dev)
 {
-	/* FIXME: PM DPS not implemented yet */
-	return 0;
+	/* all the MMC/SD/SDIO controllers are in CORE */
+	return pwrdm_get_context_loss_count(pwrdm_lookup("core_pwrdm"));
 }
 
 #else
@@ -0,0 +1,59 @@
+/*
+ * OMAP3 operating performance points
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * MPU and IVA2 (DSP) share VDD1, so their tables are paired by OPP ID.
+ * L3 and the rest of CORE run from VDD2.  Voltages are the 3430
+ * data manual nominal values, in millivolts.
+ */
+
+#ifndef __ARCH_ARM_MACH_OMAP2_OPP34XX_H
+#define __ARCH_ARM_MACH_OMAP2_OPP34XX_H
+
+#include <plat/opp.h>
+
+#define VDD1_OPP1	1
+#define VDD1_OPP2	2
+#define VDD1_OPP3	3
+#define VDD1_OPP4	4
+#define VDD1_OPP5	5
+
+#define VDD2_OPP1	1
+#define VDD2_OPP2	2
+#define VDD2_OPP3	3
+
+static struct omap_opp omap3_mpu_opps[] = {
+	{ true, 125000000, VDD1_OPP1,  975 },
+	{ true, 250000000, VDD1_OPP2, 1075 },
+	{ true, 500000000, VDD1_OPP3, 1200 },
+	{ true, 550000000, VDD1_OPP4, 1270 },
+	{ true, 600000000, VDD1_OPP5, 1350 },
+	{ 0, 0, 0, 0 },
+};
+
+static struct omap_opp omap3_dsp_opps[] = {
+	{ true,  90000000, VDD1_OPP1,  975 },
+	{ true, 180000000, VDD1_OPP2, 1075 },
+	{ true, 360000000, VDD1_OPP3, 1200 },
+	{ true, 400000000, VDD1_OPP4, 1270 },
+	{ true, 430000000, VDD1_OPP5, 1350 },
+	{ 0, 0, 0, 0 },
+};
+
+/*
+ * VDD2 OPP1 needs a DPLL3 M2 divider no board has SDRC timings for,
+ * so it is left disabled.
+ */
+static struct omap_opp omap3_l3_opps[] = {
+	{ false,  41500000, VDD2_OPP1,  975 },
+	{ true,   83000000, VDD2_OPP2, 1050 },
+	{ true,  166000000, VDD2_OPP3, 1150 },
+	{ 0, 0, 0, 0 },
+};
+
+#endif
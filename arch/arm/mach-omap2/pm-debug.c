@@ -170,6 +170,7 @@ static int pm_dbg_init_done;
 enum {
 	DEBUG_FILE_COUNTERS = 0,
 	DEBUG_FILE_TIMERS,
+	DEBUG_FILE_IDLE,
 };
 
 struct pm_module_def {
@@ -333,7 +334,19 @@ static const char pwrdm_state_names[][4] = {
 	"ON"
 };
 
-void pm_dbg_update_time(struct powerdomain *pwrdm, int prev)
+static int pm_dbg_hist_bucket(s64 ns)
+{
+	int b;
+
+	if (ns < 0)
+		return 0;
+
+	b = fls64(div_u64(ns, NSEC_PER_USEC) >> 5);
+
+	return min(b, PWRDM_HIST_BUCKETS - 1);
+}
+
+void pm_dbg_update_time(struct powerdomain *pwrdm, int prev, int state)
 {
 	s64 t;
 
@@ -345,9 +358,81 @@ void pm_dbg_update_time(struct powerdomain *pwrdm, int prev)
 
 	pwrdm->state_timer[prev] += t - pwrdm->timer;
 
+	/*
+	 * Residency: if the domain went through prev since the last switch
+	 * (e.g. idle), the old state ended at that switch.
+	 */
+	if (prev != pwrdm->state) {
+		pwrdm->residency_hist[pwrdm->state][pm_dbg_hist_bucket(
+			pwrdm->timer - pwrdm->res_timer)]++;
+		pwrdm->res_timer = pwrdm->timer;
+	}
+	if (state != prev) {
+		pwrdm->residency_hist[prev][pm_dbg_hist_bucket(
+			t - pwrdm->res_timer)]++;
+		pwrdm->res_timer = t;
+	}
+
 	pwrdm->timer = t;
 }
 
+/* Latencies are much shorter than residencies: log2 buckets from 1 us */
+static int pm_dbg_lat_bucket(u64 ns)
+{
+	int b = fls64(div_u64(ns, NSEC_PER_USEC));
+
+	return min(b, PWRDM_HIST_BUCKETS - 1);
+}
+
+void pm_dbg_pwrdm_latency(struct powerdomain *pwrdm, int exit, u64 ns)
+{
+	if (!pm_dbg_init_done)
+		return;
+
+	pwrdm->latency_hist[!!exit][pm_dbg_lat_bucket(ns)]++;
+}
+
+static const char *pm_dbg_idle_step_names[PM_DBG_IDLE_NR_STEPS] = {
+	[PM_DBG_IDLE_PWRDM_PRE]		= "pwrdm_pre_transition",
+	[PM_DBG_IDLE_GPIO_PREPARE]	= "gpio_prepare",
+	[PM_DBG_IDLE_UART_PREPARE]	= "uart_prepare",
+	[PM_DBG_IDLE_SLEEP]		= "sleep",
+	[PM_DBG_IDLE_UART_RESUME]	= "uart_resume",
+	[PM_DBG_IDLE_GPIO_RESUME]	= "gpio_resume",
+	[PM_DBG_IDLE_PWRDM_POST]	= "pwrdm_post_transition",
+};
+
+static struct {
+	unsigned long	count;
+	u64		total;
+	u64		max;
+} pm_dbg_idle_steps[PM_DBG_IDLE_NR_STEPS];
+
+u64 pm_dbg_idle_start(void)
+{
+	return sched_clock();
+}
+
+/*
+ * Account the time since @start to one step of idle entry or exit, and
+ * return the current time as the start of the next step.
+ */
+u64 pm_dbg_idle_step(int step, u64 start)
+{
+	u64 t = sched_clock();
+	u64 d = t - start;
+
+	if (!pm_dbg_init_done)
+		return t;
+
+	pm_dbg_idle_steps[step].count++;
+	pm_dbg_idle_steps[step].total += d;
+	if (d > pm_dbg_idle_steps[step].max)
+		pm_dbg_idle_steps[step].max = d;
+
+	return t;
+}
+
 static int clkdm_dbg_show_counter(struct clockdomain *clkdm, void *user)
 {
 	struct seq_file *s = (struct seq_file *)user;
@@ -384,6 +469,7 @@ static int pwrdm_dbg_show_counter(struct powerdomain *pwrdm, void *user)
 	for (i = 0; i < 4; i++)
 		seq_printf(s, ",%s:%d", pwrdm_state_names[i],
 			pwrdm->state_counter[i]);
+	seq_printf(s, ",LOST:%d", pwrdm_get_context_loss_count(pwrdm));
 
 	seq_printf(s, "\n");
 
@@ -427,12 +513,83 @@ static int pm_dbg_show_timers(struct seq_file *s, void *unused)
 	return 0;
 }
 
+static int pm_dbg_show_idle(struct seq_file *s, void *unused)
+{
+	int i;
+
+	for (i = 0; i < PM_DBG_IDLE_NR_STEPS; i++)
+		seq_printf(s, "%s: %lu,total:%llu,max:%llu\n",
+			   pm_dbg_idle_step_names[i],
+			   pm_dbg_idle_steps[i].count,
+			   pm_dbg_idle_steps[i].total,
+			   pm_dbg_idle_steps[i].max);
+
+	return 0;
+}
+
+static unsigned int pm_dbg_hist_floor(int bucket)
+{
+	return bucket ? 1 << (bucket + 4) : 0;
+}
+
+static unsigned int pm_dbg_lat_floor(int bucket)
+{
+	return bucket ? 1 << (bucket - 1) : 0;
+}
+
+static int pwrdm_dbg_show_residency(struct seq_file *s, void *unused)
+{
+	struct powerdomain *pwrdm = s->private;
+	int b, i;
+
+	seq_printf(s, "%8s", "us");
+	for (i = 0; i < 4; i++)
+		seq_printf(s, " %10s", pwrdm_state_names[i]);
+	seq_printf(s, "\n");
+
+	for (b = 0; b < PWRDM_HIST_BUCKETS; b++) {
+		seq_printf(s, "%8u", pm_dbg_hist_floor(b));
+		for (i = 0; i < 4; i++)
+			seq_printf(s, " %10u", pwrdm->residency_hist[i][b]);
+		seq_printf(s, "\n");
+	}
+
+	return 0;
+}
+
+static int pwrdm_dbg_show_latency(struct seq_file *s, void *unused)
+{
+	struct powerdomain *pwrdm = s->private;
+	int b;
+
+	seq_printf(s, "%8s %10s %10s\n", "us", "entry", "exit");
+	for (b = 0; b < PWRDM_HIST_BUCKETS; b++)
+		seq_printf(s, "%8u %10u %10u\n", pm_dbg_lat_floor(b),
+			   pwrdm->latency_hist[0][b],
+			   pwrdm->latency_hist[1][b]);
+
+	return 0;
+}
+
+static int pwrdm_dbg_residency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pwrdm_dbg_show_residency, inode->i_private);
+}
+
+static int pwrdm_dbg_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pwrdm_dbg_show_latency, inode->i_private);
+}
+
 static int pm_dbg_open(struct inode *inode, struct file *file)
 {
 	switch ((int)inode->i_private) {
 	case DEBUG_FILE_COUNTERS:
 		return single_open(file, pm_dbg_show_counters,
 			&inode->i_private);
+	case DEBUG_FILE_IDLE:
+		return single_open(file, pm_dbg_show_idle,
+			&inode->i_private);
 	case DEBUG_FILE_TIMERS:
 	default:
 		return single_open(file, pm_dbg_show_timers,
@@ -459,6 +616,20 @@ static const struct file_operations debug_reg_fops = {
 	.release        = single_release,
 };
 
+static const struct file_operations pwrdm_residency_fops = {
+	.open           = pwrdm_dbg_residency_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
+static const struct file_operations pwrdm_latency_fops = {
+	.open           = pwrdm_dbg_latency_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release,
+};
+
 int pm_dbg_regset_init(int reg_set)
 {
 	char name[2];
@@ -515,6 +686,7 @@ static int __init pwrdms_setup(struct powerdomain *pwrdm, void *dir)
 		pwrdm->state_timer[i] = 0;
 
 	pwrdm->timer = t;
+	pwrdm->res_timer = t;
 
 	if (strncmp(pwrdm->name, "dpll", 4) == 0)
 		return 0;
@@ -523,6 +695,10 @@ static int __init pwrdms_setup(struct powerdomain *pwrdm, void *dir)
 
 	(void) debugfs_create_file("suspend", S_IRUGO|S_IWUSR, d,
 			(void *)pwrdm, &pwrdm_suspend_fops);
+	(void) debugfs_create_file("residency", S_IRUGO, d,
+			(void *)pwrdm, &pwrdm_residency_fops);
+	(void) debugfs_create_file("latency", S_IRUGO, d,
+			(void *)pwrdm, &pwrdm_latency_fops);
 
 	return 0;
 }
@@ -551,6 +727,8 @@ static int __init pm_dbg_init(void)
 		d, (void *)DEBUG_FILE_COUNTERS, &debug_fops);
 	(void) debugfs_create_file("time", S_IRUGO,
 		d, (void *)DEBUG_FILE_TIMERS, &debug_fops);
+	(void) debugfs_create_file("idle", S_IRUGO,
+		d, (void *)DEBUG_FILE_IDLE, &debug_fops);
 
 	pwrdm_for_each_nolock(pwrdms_setup, (void *)d);
 
@@ -576,5 +754,8 @@ static int __init pm_dbg_init(void)
 arch_initcall(pm_dbg_init);
 
 #else
-void pm_dbg_update_time(struct powerdomain *pwrdm, int prev) {}
+void pm_dbg_update_time(struct powerdomain *pwrdm, int prev, int state) {}
+void pm_dbg_pwrdm_latency(struct powerdomain *pwrdm, int exit, u64 ns) {}
+u64 pm_dbg_idle_start(void) { return 0; }
+u64 pm_dbg_idle_step(int step, u64 start) { return 0; }
 #endif
@@ -13,21 +13,70 @@
 
 #include <plat/powerdomain.h>
 
+extern void omap_sram_idle(void);
+extern int omap3_can_sleep(void);
+extern int set_pwrdm_state(struct powerdomain *pwrdm, u32 state);
 extern int omap3_pm_get_suspend_state(struct powerdomain *pwrdm);
 extern int omap3_pm_set_suspend_state(struct powerdomain *pwrdm, int state);
 
+/*
+ * Board specific C-state parameters, in microseconds. Boards that have
+ * measured their own latencies pass a table of OMAP3_MAX_CSTATES entries
+ * to omap3_pm_init_cpuidle() before the PM code initializes.
+ */
+#define OMAP3_MAX_CSTATES	7
+
+struct cpuidle_params {
+	u8  valid;
+	u32 sleep_latency;
+	u32 wake_latency;
+	u32 threshold;
+};
+
+#if defined(CONFIG_PM) && defined(CONFIG_CPU_IDLE)
+extern void omap3_pm_init_cpuidle(struct cpuidle_params *cpuidle_board_params);
+extern int omap3_idle_init(void);
+#else
+static inline
+void omap3_pm_init_cpuidle(struct cpuidle_params *cpuidle_board_params)
+{
+}
+static inline int omap3_idle_init(void)
+{
+	return 0;
+}
+#endif
+
+/* Steps of omap_sram_idle(), timed separately by pm-debug */
+enum {
+	PM_DBG_IDLE_PWRDM_PRE = 0,
+	PM_DBG_IDLE_GPIO_PREPARE,
+	PM_DBG_IDLE_UART_PREPARE,
+	PM_DBG_IDLE_SLEEP,
+	PM_DBG_IDLE_UART_RESUME,
+	PM_DBG_IDLE_GPIO_RESUME,
+	PM_DBG_IDLE_PWRDM_POST,
+	PM_DBG_IDLE_NR_STEPS,
+};
+
 #ifdef CONFIG_PM_DEBUG
 extern void omap2_pm_dump(int mode, int resume, unsigned int us);
 extern int omap2_pm_debug;
-extern void pm_dbg_update_time(struct powerdomain *pwrdm, int prev);
+extern void pm_dbg_update_time(struct powerdomain *pwrdm, int prev, int state);
+extern void pm_dbg_pwrdm_latency(struct powerdomain *pwrdm, int exit, u64 ns);
 extern int pm_dbg_regset_save(int reg_set);
 extern int pm_dbg_regset_init(int reg_set);
+extern u64 pm_dbg_idle_start(void);
+extern u64 pm_dbg_idle_step(int step, u64 start);
 #else
 #define omap2_pm_dump(mode, resume, us)		do {} while (0);
 #define omap2_pm_debug				0
-#define pm_dbg_update_time(pwrdm, prev) do {} while (0);
+#define pm_dbg_update_time(pwrdm, prev, state) do {} while (0);
+#define pm_dbg_pwrdm_latency(pwrdm, exit, ns) do {} while (0);
 #define pm_dbg_regset_save(reg_set) do {} while (0);
 #define pm_dbg_regset_init(reg_set) do {} while (0);
+static inline u64 pm_dbg_idle_start(void) { return 0; }
+static inline u64 pm_dbg_idle_step(int step, u64 start) { return 0; }
 #endif /* CONFIG_PM_DEBUG */
 
 extern void omap24xx_idle_loop_suspend(void);
@@ -22,12 +22,17 @@
 #include <linux/list.h>
 #include <linux/err.h>
 #include <linux/gpio.h>
+#include <linux/clk.h>
+
+#include <trace/events/power.h>
 
 #include <plat/sram.h>
 #include <plat/clockdomain.h>
 #include <plat/powerdomain.h>
 #include <plat/control.h>
 #include <plat/serial.h>
+#include <plat/prcm.h>
+#include <plat/dmtimer.h>
 
 #include "cm.h"
 #include "cm-regbits-34xx.h"
@@ -49,7 +54,64 @@ static LIST_HEAD(pwrst_list);
 
 static void (*_omap_sram_idle)(u32 *addr, int save_state);
 
-static struct powerdomain *mpu_pwrdm;
+static struct powerdomain *mpu_pwrdm, *core_pwrdm;
+static struct clk *arm_fck;
+
+#if defined(CONFIG_PM_DEBUG) || defined(CONFIG_TRACEPOINTS)
+/*
+ * Idle entry and exit take a few tens of microseconds, below the
+ * resolution of the 32k sync timer behind sched_clock(), so they are
+ * timed with the Cortex-A8 cycle counter.  The counter belongs to perf
+ * and oprofile: it is only read, never enabled, so latencies are only
+ * recorded while one of them keeps it running, e.g. during
+ * "perf stat -a -e cycles".
+ */
+static int omap3_idle_lat_valid;
+
+static u32 omap3_idle_lat_start(void)
+{
+	u32 pmcr, cnten, val = 0;
+
+	asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (pmcr));
+	/* PMCNTENSET: cycle counter */
+	asm volatile("mrc p15, 0, %0, c9, c12, 1" : "=r" (cnten));
+	omap3_idle_lat_valid = (pmcr & 1) && (cnten & (1 << 31));
+	if (omap3_idle_lat_valid)
+		asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (val));
+
+	return val;
+}
+
+static void omap3_idle_lat_end(struct powerdomain *pwrdm, int state,
+			       int exit, u32 start)
+{
+	unsigned long mhz;
+	u32 pmcr, cycles;
+	u64 ns;
+
+	if (!omap3_idle_lat_valid || !arm_fck)
+		return;
+
+	asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+	cycles -= start;
+
+	mhz = clk_get_rate(arm_fck) / 1000000;
+	if (!mhz)
+		return;
+
+	/* PMCR.D: counting every 64 cycles */
+	asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (pmcr));
+	ns = (u64)cycles * (pmcr & (1 << 3) ? 64 : 1) * 1000;
+	ns = div_u64(ns, mhz);
+
+	trace_power_domain_latency(pwrdm->name, state, ns);
+	pm_dbg_pwrdm_latency(pwrdm, exit, ns);
+}
+#else
+static inline u32 omap3_idle_lat_start(void) { return 0; }
+static inline void omap3_idle_lat_end(struct powerdomain *pwrdm, int state,
+				      int exit, u32 start) { }
+#endif
 
 /*
  * PRCM Interrupt Handler Helper Function
@@ -161,7 +223,7 @@ static irqreturn_t prcm_interrupt_handler (int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static void omap_sram_idle(void)
+void omap_sram_idle(void)
 {
 	/* Variable to tell what needs to be saved and restored
 	 * in omap_sram_idle*/
@@ -169,13 +231,16 @@ static void omap_sram_idle(void)
 	/* save_state = 1 => Only L1 and logic lost */
 	/* save_state = 2 => Only L2 lost */
 	/* save_state = 3 => L1, L2 and logic lost */
-	int save_state = 0, mpu_next_state;
+	int save_state = 0, mpu_next_state, core_next_state;
+	u64 t;
+	u32 lat;
 
 	if (!_omap_sram_idle)
 		return;
 
 	mpu_next_state = pwrdm_read_next_pwrst(mpu_pwrdm);
 	switch (mpu_next_state) {
+	case PWRDM_POWER_ON:
 	case PWRDM_POWER_RET:
 		/* No need to save context */
 		save_state = 0;
@@ -185,23 +250,52 @@ static void omap_sram_idle(void)
 		printk(KERN_ERR "Invalid mpu state in sram_idle\n");
 		return;
 	}
+	t = pm_dbg_idle_start();
+	lat = omap3_idle_lat_start();
 	pwrdm_pre_transition();
+	t = pm_dbg_idle_step(PM_DBG_IDLE_PWRDM_PRE, t);
+
+	/* GPIO and UART only need care if CORE is going to sleep */
+	core_next_state = pwrdm_read_next_pwrst(core_pwrdm);
+	if (core_next_state < PWRDM_POWER_ON) {
+		omap2_gpio_prepare_for_retention();
+		t = pm_dbg_idle_step(PM_DBG_IDLE_GPIO_PREPARE, t);
+		omap_uart_prepare_idle(0);
+		omap_uart_prepare_idle(1);
+		omap_uart_prepare_idle(2);
+		t = pm_dbg_idle_step(PM_DBG_IDLE_UART_PREPARE, t);
+	}
 
-	omap2_gpio_prepare_for_retention();
-	omap_uart_prepare_idle(0);
-	omap_uart_prepare_idle(1);
-	omap_uart_prepare_idle(2);
+	omap3_idle_lat_end(mpu_pwrdm, mpu_next_state, 0, lat);
+	if (core_next_state < PWRDM_POWER_ON)
+		omap3_idle_lat_end(core_pwrdm, core_next_state, 0, lat);
 
 	_omap_sram_idle(NULL, save_state);
+	lat = omap3_idle_lat_start();
 	cpu_init();
-
-	omap_uart_resume_idle(2);
-	omap_uart_resume_idle(1);
-	omap_uart_resume_idle(0);
-	omap2_gpio_resume_after_retention();
+	/* the sleep code has written CM registers behind the accessors */
+	if (core_next_state < PWRDM_POWER_ON)
+		prcm_shadow_invalidate();
+	t = pm_dbg_idle_step(PM_DBG_IDLE_SLEEP, t);
+
+	if (core_next_state < PWRDM_POWER_ON) {
+		omap_uart_resume_idle(2);
+		omap_uart_resume_idle(1);
+		omap_uart_resume_idle(0);
+		t = pm_dbg_idle_step(PM_DBG_IDLE_UART_RESUME, t);
+		omap2_gpio_resume_after_retention();
+		t = pm_dbg_idle_step(PM_DBG_IDLE_GPIO_RESUME, t);
+	}
 
 	pwrdm_post_transition();
+	pm_dbg_idle_step(PM_DBG_IDLE_PWRDM_POST, t);
 
+	omap3_idle_lat_end(mpu_pwrdm, PWRDM_POWER_ON, 1, lat);
+	if (core_next_state < PWRDM_POWER_ON)
+		omap3_idle_lat_end(core_pwrdm, PWRDM_POWER_ON, 1, lat);
+
+	/* coalesced timers now due share this wakeup */
+	omap_dm_ctimer_run_due();
 }
 
 /*
@@ -244,7 +338,7 @@ static int omap3_fclks_active(void)
 	return 0;
 }
 
-static int omap3_can_sleep(void)
+int omap3_can_sleep(void)
 {
 	if (!omap_uart_can_sleep())
 		return 0;
@@ -256,7 +350,7 @@ static int omap3_can_sleep(void)
 /* This sets pwrdm state (other than mpu & core. Currently only ON &
  * RET are supported. Function is assuming that clkdm doesn't have
  * hw_sup mode enabled. */
-static int set_pwrdm_state(struct powerdomain *pwrdm, u32 state)
+int set_pwrdm_state(struct powerdomain *pwrdm, u32 state)
 {
 	u32 cur_state;
 	int sleep_switch = 0;
@@ -483,6 +577,31 @@ static void __init omap3_d2d_idle(void)
 	prm_write_mod_reg(0, CORE_MOD, RM_RSTCTRL);
 }
 
+/*
+ * The coalesced timers run on a GPTIMER which must be able to wake up
+ * the MPU while CORE is in retention, i.e. one of GPTIMER2 to 9 in PER.
+ */
+static void __init omap3_ctimer_wakeup_setup(void)
+{
+	int irq, id;
+
+	irq = omap_dm_ctimer_get_irq();
+	if (irq < 0)
+		return;
+
+	id = irq - INT_24XX_GPTIMER1 + 1;
+	if (id < 2 || id > 9) {
+		printk(KERN_WARNING "PM: GPTIMER%d cannot wake up the system "
+		       "from retention\n", id);
+		return;
+	}
+
+	prm_set_mod_reg_bits(OMAP3430_EN_GPT2 << (id - 2),
+			     OMAP3430_PER_MOD, PM_WKEN);
+	prm_set_mod_reg_bits(OMAP3430_GRPSEL_GPT2 << (id - 2),
+			     OMAP3430_PER_MOD, OMAP3430_PM_MPUGRPSEL);
+}
+
 static void __init prcm_setup_regs(void)
 {
 	/* XXX Reset all wkdeps. This should be done when initializing
@@ -649,6 +768,7 @@ static void __init prcm_setup_regs(void)
 			  OMAP3430_GRPSEL_GPIO4 | OMAP3430_EN_GPIO5 |
 			  OMAP3430_GRPSEL_GPIO6 | OMAP3430_EN_UART3,
 			  OMAP3430_PER_MOD, OMAP3430_PM_MPUGRPSEL);
+	omap3_ctimer_wakeup_setup();
 
 	/* Don't attach IVA interrupts */
 	prm_write_mod_reg(0, WKUP_MOD, OMAP3430_PM_IVAGRPSEL);
@@ -786,6 +906,17 @@ static int __init omap3_pm_init(void)
 		goto err2;
 	}
 
+	core_pwrdm = pwrdm_lookup("core_pwrdm");
+	if (core_pwrdm == NULL) {
+		printk(KERN_ERR "Failed to get core_pwrdm\n");
+		goto err2;
+	}
+
+	/* only for the idle latency statistics */
+	arm_fck = clk_get(NULL, "arm_fck");
+	if (IS_ERR(arm_fck))
+		arm_fck = NULL;
+
 	_omap_sram_idle = omap_sram_push(omap34xx_cpu_suspend,
 					 omap34xx_cpu_suspend_sz);
 
@@ -794,6 +925,7 @@ static int __init omap3_pm_init(void)
 #endif /* CONFIG_SUSPEND */
 
 	pm_idle = omap3_pm_idle;
+	omap3_idle_init();
 
 err1:
 	return ret;
@@ -0,0 +1,99 @@
+/*
+ * Runtime PM support code for OMAP
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * These override the weak platform bus runtime PM callbacks, so that a
+ * driver of an omap_device only has to use pm_runtime_get*() and
+ * pm_runtime_put*(): the underlying hwmods are enabled before the
+ * driver's ->runtime_resume() runs and idled after its
+ * ->runtime_suspend() succeeds.  omap_device_idle() only steps as far
+ * down the device's pm_lats table as its wakeup latency limit allows,
+ * so constraints set by the OMAP PM layer are still honored.
+ *
+ * Idling is deferred by omap_device_get_idle_delay(), so a device that
+ * is used again shortly after being released is not put through an
+ * idle/enable cycle costing more than it saves.  A pm_runtime_get*()
+ * in the meantime cancels the pending suspend.
+ *
+ * platform_devices that are not omap_devices only get their driver's
+ * callbacks called.
+ */
+#undef DEBUG
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/platform_device.h>
+#include <linux/pm_runtime.h>
+
+#include <plat/omap_device.h>
+
+#ifdef CONFIG_PM_RUNTIME
+
+int platform_pm_runtime_suspend(struct device *dev)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+	struct omap_device *odev = omap_device_of(pdev);
+	int r, ret = 0;
+
+	dev_dbg(dev, "%s\n", __func__);
+
+	if (dev->driver && dev->driver->pm &&
+	    dev->driver->pm->runtime_suspend)
+		ret = dev->driver->pm->runtime_suspend(dev);
+
+	if (!ret && odev) {
+		r = omap_device_idle(pdev);
+		WARN_ON(r);
+	}
+
+	return ret;
+}
+
+int platform_pm_runtime_resume(struct device *dev)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+	struct omap_device *odev = omap_device_of(pdev);
+	int r, ret = 0;
+
+	dev_dbg(dev, "%s\n", __func__);
+
+	if (odev) {
+		r = omap_device_enable(pdev);
+		WARN_ON(r);
+	}
+
+	if (dev->driver && dev->driver->pm &&
+	    dev->driver->pm->runtime_resume)
+		ret = dev->driver->pm->runtime_resume(dev);
+
+	return ret;
+}
+
+int platform_pm_runtime_idle(struct device *dev)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+	struct omap_device *odev = omap_device_of(pdev);
+	int ret = 0;
+
+	dev_dbg(dev, "%s\n", __func__);
+
+	/* Let the driver veto idling, e.g. while a transfer is queued */
+	if (dev->driver && dev->driver->pm &&
+	    dev->driver->pm->runtime_idle)
+		ret = dev->driver->pm->runtime_idle(dev);
+	if (ret)
+		return ret;
+
+	if (odev)
+		return pm_schedule_suspend(dev,
+					   omap_device_get_idle_delay(odev));
+
+	return pm_runtime_suspend(dev);
+}
+
+#endif /* CONFIG_PM_RUNTIME */
@@ -26,6 +26,8 @@
 
 #include <asm/atomic.h>
 
+#include <trace/events/power.h>
+
 #include "cm.h"
 #include "cm-regbits-34xx.h"
 #include "prm.h"
@@ -128,6 +130,11 @@ static int _pwrdm_state_switch(struct powerdomain *pwrdm, int flag)
 		prev = pwrdm_read_prev_pwrst(pwrdm);
 		if (pwrdm->state != prev)
 			pwrdm->state_counter[prev]++;
+		/* logic lost in retention counts as a context loss too */
+		if (prev == PWRDM_POWER_RET &&
+		    (pwrdm->pwrsts_logic_ret & (1 << PWRDM_POWER_OFF)) &&
+		    pwrdm_read_prev_logic_pwrst(pwrdm) == PWRDM_POWER_OFF)
+			pwrdm->ret_logic_off_counter++;
 		break;
 	default:
 		return -EINVAL;
@@ -136,7 +143,10 @@ static int _pwrdm_state_switch(struct powerdomain *pwrdm, int flag)
 	if (state != prev)
 		pwrdm->state_counter[state]++;
 
-	pm_dbg_update_time(pwrdm, prev);
+	if (state != prev || prev != pwrdm->state)
+		trace_power_domain_state(pwrdm->name, prev, state);
+
+	pm_dbg_update_time(pwrdm, prev, state);
 
 	pwrdm->state = state;
 
@@ -162,6 +172,7 @@ static __init void _pwrdm_setup(struct powerdomain *pwrdm)
 
 	for (i = 0; i < 4; i++)
 		pwrdm->state_counter[i] = 0;
+	pwrdm->ret_logic_off_counter = 0;
 
 	pwrdm_wait_transition(pwrdm);
 	pwrdm->state = pwrdm_read_pwrst(pwrdm);
@@ -1228,3 +1239,21 @@ int pwrdm_post_transition(void)
 	return 0;
 }
 
+/**
+ * pwrdm_get_context_loss_count - number of times pwrdm lost its context
+ * @pwrdm: struct powerdomain *
+ *
+ * Counts the transitions to OFF, and to RETENTION with logic off, seen by
+ * pwrdm_post_transition().  Drivers of devices in the powerdomain save
+ * this with their context and restore only if it has changed since.
+ * Returns the count or -EINVAL if the powerdomain pointer is null.
+ */
+int pwrdm_get_context_loss_count(struct powerdomain *pwrdm)
+{
+	if (!pwrdm)
+		return -EINVAL;
+
+	return (pwrdm->state_counter[PWRDM_POWER_OFF] +
+		pwrdm->ret_logic_off_counter) & INT_MAX;
+}
+
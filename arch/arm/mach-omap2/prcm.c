@@ -18,6 +18,7 @@
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <linux/delay.h>
+#include <linux/string.h>
 
 #include <plat/common.h>
 #include <plat/prcm.h>
@@ -31,6 +32,45 @@ static void __iomem *cm_base;
 
 #define MAX_MODULE_ENABLE_WAIT		100000
 
+/*
+ * Shadow copies of PRCM registers that only software modifies, such as
+ * CM_*CLKEN.  Reading a PRCM register costs a round trip over the L4
+ * interconnect; the clock code does a read-modify-write on every clock
+ * enable and disable, so it reads through this cache instead.  Entries
+ * are only filled by prcm_shadow_read(), and every write done through
+ * the PRCM accessors in this file updates a matching entry, so
+ * registers written elsewhere stay coherent as long as those writers
+ * use the accessors.  Registers with hardware-updated bits (IDLEST,
+ * WKST, CLKSTST...) must not be read through the cache.
+ *
+ * The cache is direct-mapped and tagged by register address; a
+ * collision only costs a hardware read.  It follows the same locking
+ * rule as the read-modify-write accessors: callers must lock.
+ */
+#define PRCM_SHADOW_ENTRIES		64
+
+struct prcm_shadow {
+	void __iomem	*reg;
+	u32		val;
+};
+
+static struct prcm_shadow prcm_shadow[PRCM_SHADOW_ENTRIES];
+
+static inline struct prcm_shadow *_prcm_shadow_slot(void __iomem *reg)
+{
+	unsigned long a = (__force unsigned long)reg >> 2;
+
+	return &prcm_shadow[(a ^ (a >> 6)) % PRCM_SHADOW_ENTRIES];
+}
+
+static inline void _prcm_shadow_update(u32 val, void __iomem *reg)
+{
+	struct prcm_shadow *ps = _prcm_shadow_slot(reg);
+
+	if (ps->reg == reg)
+		ps->val = val;
+}
+
 u32 omap_prcm_get_reset_sources(void)
 {
 	/* XXX This presumably needs modification for 34XX */
@@ -65,6 +105,7 @@ static inline void __omap_prcm_write(u32 value, void __iomem *base,
 {
 	BUG_ON(!base);
 	__raw_writel(value, base + module + reg);
+	_prcm_shadow_update(value, base + module + reg);
 }
 
 /* Read a register in a PRM module */
@@ -123,6 +164,53 @@ u32 cm_rmw_mod_reg_bits(u32 mask, u32 bits, s16 module, s16 idx)
 }
 EXPORT_SYMBOL(cm_rmw_mod_reg_bits);
 
+/**
+ * prcm_shadow_read - read a software-controlled PRCM register
+ * @reg: virtual address of the register
+ *
+ * Returns the value last written to @reg, reading it from the hardware
+ * only if it is not in the shadow cache.  Only for registers whose
+ * contents the hardware never changes.
+ */
+u32 prcm_shadow_read(void __iomem *reg)
+{
+	struct prcm_shadow *ps = _prcm_shadow_slot(reg);
+
+	if (ps->reg != reg) {
+		ps->val = __raw_readl(reg);
+		ps->reg = reg;
+	}
+
+	return ps->val;
+}
+
+/**
+ * prcm_shadow_write - write a PRCM register and its shadow copy
+ * @val: value to write
+ * @reg: virtual address of the register
+ *
+ * For writes by virtual address, e.g. to clk->enable_reg.  Writes done
+ * through prm_write_mod_reg() and cm_write_mod_reg() keep the cache
+ * coherent on their own.  Posted: callers needing the write to have
+ * reached the PRCM must read the register back with __raw_readl().
+ */
+void prcm_shadow_write(u32 val, void __iomem *reg)
+{
+	__raw_writel(val, reg);
+	_prcm_shadow_update(val, reg);
+}
+
+/**
+ * prcm_shadow_invalidate - drop all shadow copies
+ *
+ * To be called after the PRCM registers have been changed behind the
+ * accessors' back, e.g. when they lost context in off-mode.
+ */
+void prcm_shadow_invalidate(void)
+{
+	memset(prcm_shadow, 0, sizeof(prcm_shadow));
+}
+
 /**
  * omap2_cm_wait_idlest - wait for IDLEST bit to indicate module readiness
  * @reg: physical address of module IDLEST register
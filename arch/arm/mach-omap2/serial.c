@@ -28,6 +28,7 @@
 #include <plat/board.h>
 #include <plat/clock.h>
 #include <plat/control.h>
+#include <plat/dmtimer.h>
 
 #include "prm.h"
 #include "pm.h"
@@ -37,10 +38,14 @@
 
 #define DEFAULT_TIMEOUT (5 * HZ)
 
+/* the inactivity timeout need not be exact: sleeping late is harmless */
+#define UART_IDLE_SLACK_MS	1000
+
 struct omap_uart_state {
 	int num;
 	int can_sleep;
-	struct timer_list timer;
+	struct timer_list timer;	/* without coalesced timers */
+	struct omap_dm_ctimer ctimer;
 	u32 timeout;
 
 	void __iomem *wk_st;
@@ -289,6 +294,25 @@ static void omap_uart_smart_idle_enable(struct omap_uart_state *uart,
 	serial_write_reg(p, UART_OMAP_SYSC, sysc);
 }
 
+/*
+ * The inactivity timer is pushed back on every UART interrupt, and
+ * rides on other wakeups when the timers can be coalesced.
+ */
+static void omap_uart_mod_idle_timer(struct omap_uart_state *uart)
+{
+	if (omap_dm_ctimer_mod(&uart->ctimer, jiffies_to_msecs(uart->timeout),
+			       UART_IDLE_SLACK_MS) >= 0)
+		del_timer(&uart->timer);
+	else
+		mod_timer(&uart->timer, jiffies + uart->timeout);
+}
+
+static void omap_uart_del_idle_timer(struct omap_uart_state *uart)
+{
+	omap_dm_ctimer_del(&uart->ctimer);
+	del_timer(&uart->timer);
+}
+
 static void omap_uart_block_sleep(struct omap_uart_state *uart)
 {
 	omap_uart_enable_clocks(uart);
@@ -296,9 +320,9 @@ static void omap_uart_block_sleep(struct omap_uart_state *uart)
 	omap_uart_smart_idle_enable(uart, 0);
 	uart->can_sleep = 0;
 	if (uart->timeout)
-		mod_timer(&uart->timer, jiffies + uart->timeout);
+		omap_uart_mod_idle_timer(uart);
 	else
-		del_timer(&uart->timer);
+		omap_uart_del_idle_timer(uart);
 }
 
 static void omap_uart_allow_sleep(struct omap_uart_state *uart)
@@ -313,7 +337,7 @@ static void omap_uart_allow_sleep(struct omap_uart_state *uart)
 
 	omap_uart_smart_idle_enable(uart, 1);
 	uart->can_sleep = 1;
-	del_timer(&uart->timer);
+	omap_uart_del_idle_timer(uart);
 }
 
 static void omap_uart_idle_timer(unsigned long data)
@@ -416,7 +440,9 @@ static void omap_uart_idle_init(struct omap_uart_state *uart)
 	uart->timeout = DEFAULT_TIMEOUT;
 	setup_timer(&uart->timer, omap_uart_idle_timer,
 		    (unsigned long) uart);
-	mod_timer(&uart->timer, jiffies + uart->timeout);
+	omap_dm_ctimer_init(&uart->ctimer, omap_uart_idle_timer,
+			    (unsigned long) uart, 0);
+	omap_uart_mod_idle_timer(uart);
 	omap_uart_smart_idle_enable(uart, 0);
 
 	if (cpu_is_omap34xx()) {
@@ -520,7 +546,7 @@ static ssize_t sleep_timeout_store(struct device *dev,
 
 	uart->timeout = value * HZ;
 	if (uart->timeout)
-		mod_timer(&uart->timer, jiffies + uart->timeout);
+		omap_uart_mod_idle_timer(uart);
 	else
 		/* A zero value means disable timeout feature */
 		omap_uart_block_sleep(uart);
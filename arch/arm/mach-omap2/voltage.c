@@ -0,0 +1,286 @@
+/*
+ * OMAP3 voltage domain scaling
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The PRM voltage controller (VC) talks to the power IC over the
+ * dedicated SmartReflex I2C lines.  Its bypass register lets software
+ * issue a single register write to the PMIC, which is all DVFS needs:
+ * program the VSEL of the SMPS feeding a VDD, then wait for the rail
+ * to slew.  This does not sleep, so it can be called from the clock
+ * code with the clock lock held.
+ *
+ * The PMIC parameters are those of the TWL4030/TPS659x0 family, which
+ * must have SmartReflex enabled (DCDC_GLOBAL_CFG) by the bootloader.
+ * Boards where that holds call omap3_voltage_init().  Until then
+ * voltage requests are ignored, the rails stay at their boot values
+ * and the clock code keeps VDD1 and VDD2 at or below their boot rates.
+ */
+#undef DEBUG
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/delay.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <plat/cpu.h>
+
+#include "prm.h"
+#include "prm-regbits-34xx.h"
+#include "voltage.h"
+
+/* TWL4030 SmartReflex slave and its per-SMPS voltage registers */
+#define PMIC_SR_SLAVE_ADDR		0x12
+#define PMIC_VDD1_SR_CONTROL		0x00
+#define PMIC_VDD2_SR_CONTROL		0x01
+
+/* VSEL = (mV - 600) / 12.5, rounded up */
+#define PMIC_VSEL_BASE_MV		600
+#define PMIC_VSEL_STEP_UV		12500
+#define PMIC_VSEL_MAX			0x78
+
+/* SMPS slew rate, mV/us */
+#define PMIC_SLEW_RATE			4
+
+/* Upper bound for the VC to shift a bypass command out, in us */
+#define VC_BYPASS_TIMEOUT		200
+
+struct omap_vdd {
+	const char	*name;
+	u8		vsel_reg;
+	u16		curr_mv;	/* 0 until first programmed */
+
+	/* voltage changes */
+	unsigned long	v_transitions;
+	u64		v_time_ns;
+
+	/* full DVFS transitions, see omap_dvfs_account() */
+	unsigned long	transitions;
+	u64		time_ns;
+	u64		max_ns;
+};
+
+static struct omap_vdd omap3_vdds[OMAP3_NR_VDD] = {
+	[VDD1] = {
+		.name		= "vdd1",
+		.vsel_reg	= PMIC_VDD1_SR_CONTROL,
+	},
+	[VDD2] = {
+		.name		= "vdd2",
+		.vsel_reg	= PMIC_VDD2_SR_CONTROL,
+	},
+};
+
+static DEFINE_SPINLOCK(vc_lock);
+static int vc_ready;
+
+static u8 omap_mv_to_vsel(u16 mv)
+{
+	u32 vsel;
+
+	vsel = DIV_ROUND_UP((mv - PMIC_VSEL_BASE_MV) * 1000,
+			    PMIC_VSEL_STEP_UV);
+
+	return min_t(u32, vsel, PMIC_VSEL_MAX);
+}
+
+/**
+ * omap_voltage_scale - program a new voltage for a VDD
+ * @vdd: VDD1 or VDD2
+ * @mv: target voltage in millivolts
+ *
+ * Returns once the rail is at the new voltage when raising it; when
+ * lowering there is nothing to wait for.  Returns 0 on success or if the
+ * voltage controller is not in use, -EINVAL for a bad argument, or
+ * -ETIMEDOUT if the command did not go out.
+ */
+int omap_voltage_scale(int vdd, u16 mv)
+{
+	struct omap_vdd *v;
+	unsigned long flags;
+	ktime_t start;
+	u32 val;
+	int timeout = VC_BYPASS_TIMEOUT;
+	int ret = 0;
+
+	if (vdd < 0 || vdd >= OMAP3_NR_VDD || mv <= PMIC_VSEL_BASE_MV)
+		return -EINVAL;
+
+	v = &omap3_vdds[vdd];
+	if (!vc_ready || v->curr_mv == mv)
+		return 0;
+
+	spin_lock_irqsave(&vc_lock, flags);
+
+	start = ktime_get();
+
+	val = (omap_mv_to_vsel(mv) << OMAP3430_DATA_SHIFT) |
+		(v->vsel_reg << OMAP3430_REGADDR_SHIFT) |
+		(PMIC_SR_SLAVE_ADDR << OMAP3430_SLAVEADDR_SHIFT);
+	prm_write_mod_reg(val, OMAP3430_GR_MOD, OMAP3_PRM_VC_BYPASS_VAL_OFFSET);
+	prm_write_mod_reg(val | OMAP3430_VALID, OMAP3430_GR_MOD,
+			  OMAP3_PRM_VC_BYPASS_VAL_OFFSET);
+
+	while (prm_read_mod_reg(OMAP3430_GR_MOD,
+				OMAP3_PRM_VC_BYPASS_VAL_OFFSET) &
+	       OMAP3430_VALID) {
+		if (!--timeout) {
+			ret = -ETIMEDOUT;
+			goto out;
+		}
+		udelay(1);
+	}
+
+	/* An unknown boot voltage is assumed to be the lowest one */
+	if (mv > v->curr_mv)
+		udelay(DIV_ROUND_UP(mv - max_t(u16, v->curr_mv,
+					       PMIC_VSEL_BASE_MV),
+				    PMIC_SLEW_RATE));
+
+	pr_debug("voltage: %s %u -> %u mV\n", v->name, v->curr_mv, mv);
+
+	v->curr_mv = mv;
+	v->v_transitions++;
+	v->v_time_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+out:
+	spin_unlock_irqrestore(&vc_lock, flags);
+
+	if (ret)
+		printk(KERN_ERR "voltage: %s: VC bypass command timed out\n",
+		       v->name);
+
+	return ret;
+}
+
+/**
+ * omap_voltage_get - last voltage programmed on a VDD
+ * @vdd: VDD1 or VDD2
+ *
+ * Returns the voltage in millivolts, or 0 if it has not been set since
+ * boot.
+ */
+u16 omap_voltage_get(int vdd)
+{
+	if (vdd < 0 || vdd >= OMAP3_NR_VDD)
+		return 0;
+
+	return omap3_vdds[vdd].curr_mv;
+}
+
+/**
+ * omap_dvfs_account - record a completed DVFS transition
+ * @vdd: VDD whose OPP changed
+ * @start: ktime_get() at the beginning of the transition
+ *
+ * Called by the clock code once both frequency and voltage are
+ * settled; the totals are exported through debugfs.
+ */
+void omap_dvfs_account(int vdd, ktime_t start)
+{
+	struct omap_vdd *v;
+	u64 ns;
+
+	if (vdd < 0 || vdd >= OMAP3_NR_VDD)
+		return;
+
+	v = &omap3_vdds[vdd];
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	v->transitions++;
+	v->time_ns += ns;
+	if (ns > v->max_ns)
+		v->max_ns = ns;
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+static int omap_vdd_dbg_show(struct seq_file *s, void *unused)
+{
+	struct omap_vdd *v = s->private;
+
+	seq_printf(s, "voltage: %u mV\n", v->curr_mv);
+	seq_printf(s, "voltage changes: %lu (%llu us)\n", v->v_transitions,
+		   div_u64(v->v_time_ns, NSEC_PER_USEC));
+	seq_printf(s, "dvfs transitions: %lu\n", v->transitions);
+	seq_printf(s, "dvfs latency: total %llu us, max %llu us\n",
+		   div_u64(v->time_ns, NSEC_PER_USEC),
+		   div_u64(v->max_ns, NSEC_PER_USEC));
+
+	return 0;
+}
+
+static int omap_vdd_dbg_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap_vdd_dbg_show, inode->i_private);
+}
+
+static const struct file_operations omap_vdd_dbg_fops = {
+	.open		= omap_vdd_dbg_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init omap_voltage_debugfs_init(void)
+{
+	struct dentry *d;
+	int i;
+
+	d = debugfs_create_dir("dvfs", NULL);
+	if (IS_ERR(d) || !d)
+		return;
+
+	for (i = 0; i < OMAP3_NR_VDD; i++)
+		(void) debugfs_create_file(omap3_vdds[i].name, S_IRUGO, d,
+					   &omap3_vdds[i], &omap_vdd_dbg_fops);
+}
+
+#else
+static inline void omap_voltage_debugfs_init(void) { }
+#endif
+
+/**
+ * omap_voltage_ready - whether voltage requests reach the power IC
+ *
+ * Returns 1 once omap3_voltage_init() has set up the voltage
+ * controller, 0 before.
+ */
+int omap_voltage_ready(void)
+{
+	return vc_ready;
+}
+
+/**
+ * omap3_voltage_init - set up the voltage controller for a TWL4030
+ *
+ * Called from the init_machine of boards with a TWL4030/TPS659x0 power
+ * IC whose SmartReflex interface the bootloader has enabled.  Only
+ * then can DVFS use OPPs above the boot ones.
+ */
+int __init omap3_voltage_init(void)
+{
+	if (!cpu_is_omap34xx())
+		return -ENODEV;
+
+	prm_write_mod_reg((PMIC_SR_SLAVE_ADDR <<
+			   OMAP3430_PRM_VC_SMPS_SA_SA1_SHIFT) |
+			  (PMIC_SR_SLAVE_ADDR <<
+			   OMAP3430_PRM_VC_SMPS_SA_SA0_SHIFT),
+			  OMAP3430_GR_MOD, OMAP3_PRM_VC_SMPS_SA_OFFSET);
+	prm_write_mod_reg((PMIC_VDD2_SR_CONTROL << OMAP3430_VOLRA1_SHIFT) |
+			  (PMIC_VDD1_SR_CONTROL << OMAP3430_VOLRA0_SHIFT),
+			  OMAP3430_GR_MOD, OMAP3_PRM_VC_SMPS_VOL_RA_OFFSET);
+
+	vc_ready = 1;
+
+	omap_voltage_debugfs_init();
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * OMAP3 voltage domain scaling
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ARCH_ARM_MACH_OMAP2_VOLTAGE_H
+#define __ARCH_ARM_MACH_OMAP2_VOLTAGE_H
+
+#include <linux/hrtimer.h>
+
+/* Voltage domains */
+#define VDD1		0	/* MPU, IVA2 */
+#define VDD2		1	/* CORE */
+#define OMAP3_NR_VDD	2
+
+extern int omap3_voltage_init(void);
+extern int omap_voltage_ready(void);
+extern int omap_voltage_scale(int vdd, u16 mv);
+extern u16 omap_voltage_get(int vdd);
+extern void omap_dvfs_account(int vdd, ktime_t start);
+
+#endif
@@ -10,55 +10,194 @@
 #include <linux/init.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/mmu_context.h>
 #include <asm/tlbflush.h>
 
+/*
+ * The context ID of an mm holds a generation number above ASID_BITS
+ * and the hardware ASID below.  An mm may run as long as its
+ * generation is the current one; switching to it then only costs the
+ * xchg in check_context().  When all ASIDs of a generation are handed
+ * out, a new generation starts: the ASIDs running on each CPU at that
+ * point are carried over as reserved, so those mms keep their ASID and
+ * their TLB entries, and each CPU flushes its own TLB the next time it
+ * allocates.  No CPU is interrupted, and cpu_asid_lock is only taken
+ * when an mm needs a new ASID.
+ *
+ * ASID 0 is never allocated, it is reserved for the TTBR changing
+ * sequence.  The generation counter wraps after 2^24 rollovers; an mm
+ * which has not run for that long could then be mistaken for a current
+ * one, which we accept.
+ */
+#define NUM_USER_ASIDS		ASID_FIRST_VERSION
+
 static DEFINE_SPINLOCK(cpu_asid_lock);
-unsigned int cpu_last_asid = ASID_FIRST_VERSION;
+static DECLARE_BITMAP(asid_map, NUM_USER_ASIDS);
+static cpumask_t tlb_flush_pending;
+
+atomic_t asid_generation = ATOMIC_INIT(ASID_FIRST_VERSION);
+DEFINE_PER_CPU(atomic_t, active_asids);
+static DEFINE_PER_CPU(unsigned int, reserved_asids);
+
+static unsigned long asid_rollovers;
 
 /*
  * We fork()ed a process, and we need a new context for the child
  * to run in.  We reserve version 0 for initial tasks so we will
- * always allocate an ASID. The ASID 0 is reserved for the TTBR
- * register changing sequence.
+ * always allocate an ASID.
  */
 void __init_new_context(struct task_struct *tsk, struct mm_struct *mm)
 {
 	mm->context.id = 0;
 }
 
-void __new_context(struct mm_struct *mm)
+static void flush_context(void)
 {
 	unsigned int asid;
+	int cpu;
 
-	spin_lock(&cpu_asid_lock);
-	asid = ++cpu_last_asid;
-	if (asid == 0)
-		asid = cpu_last_asid = ASID_FIRST_VERSION;
+	bitmap_zero(asid_map, NUM_USER_ASIDS);
 
-	/*
-	 * If we've used up all our ASIDs, we need
-	 * to start a new version and flush the TLB.
-	 */
-	if (unlikely((asid & ~ASID_MASK) == 0)) {
-		asid = ++cpu_last_asid;
-		/* set the reserved ASID before flushing the TLB */
-		asm("mcr	p15, 0, %0, c13, c0, 1	@ set reserved context ID\n"
-		    :
-		    : "r" (0));
-		isb();
-		flush_tlb_all();
+	for_each_possible_cpu(cpu) {
+		asid = atomic_xchg(&per_cpu(active_asids, cpu), 0);
+		/*
+		 * A CPU which has not switched mm since the previous
+		 * rollover is still running the mm it reserved then.
+		 */
+		if (asid == 0)
+			asid = per_cpu(reserved_asids, cpu);
+		__set_bit(asid & ~ASID_MASK, asid_map);
+		per_cpu(reserved_asids, cpu) = asid;
+	}
+
+	/* every CPU flushes its TLB before it uses the new generation */
+	cpumask_setall(&tlb_flush_pending);
+	asid_rollovers++;
+}
+
+static int check_update_reserved_asid(unsigned int asid, unsigned int newasid)
+{
+	int cpu, hit = 0;
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(reserved_asids, cpu) == asid) {
+			per_cpu(reserved_asids, cpu) = newasid;
+			hit = 1;
+		}
+	}
+
+	return hit;
+}
+
+static unsigned int new_context(struct mm_struct *mm)
+{
+	static unsigned int cur_idx = 1;
+	unsigned int asid = mm->context.id;
+	unsigned int generation = atomic_read(&asid_generation);
+
+	if (asid != 0) {
+		unsigned int newasid = generation | (asid & ~ASID_MASK);
+
+		/*
+		 * The mm was running during a rollover, or its ASID has
+		 * not been handed out again yet: keep it.
+		 */
+		if (check_update_reserved_asid(asid, newasid))
+			return newasid;
+
+		if (!__test_and_set_bit(asid & ~ASID_MASK, asid_map))
+			return newasid;
+	}
+
+	asid = find_next_zero_bit(asid_map, NUM_USER_ASIDS, cur_idx);
+	if (asid == NUM_USER_ASIDS) {
+		generation = atomic_add_return(ASID_FIRST_VERSION,
+					       &asid_generation);
+		/* generation 0 is that of mms which never had an ASID */
+		if (unlikely(generation == 0))
+			generation = atomic_add_return(ASID_FIRST_VERSION,
+						       &asid_generation);
+		flush_context();
+		asid = find_next_zero_bit(asid_map, NUM_USER_ASIDS, 1);
+	}
+
+	__set_bit(asid, asid_map);
+	cur_idx = asid;
+	cpumask_clear(mm_cpumask(mm));
+
+	return generation | asid;
+}
+
+void __new_context(struct mm_struct *mm, unsigned int cpu)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cpu_asid_lock, flags);
+
+	/* check that our ASID belongs to the current generation */
+	if ((mm->context.id ^ atomic_read(&asid_generation)) >> ASID_BITS)
+		mm->context.id = new_context(mm);
+
+	atomic_set(&per_cpu(active_asids, cpu), mm->context.id);
+	cpumask_set_cpu(cpu, mm_cpumask(mm));
+
+	if (cpumask_test_and_clear_cpu(cpu, &tlb_flush_pending)) {
+		local_flush_tlb_all();
 		if (icache_is_vivt_asid_tagged()) {
-			asm("mcr	p15, 0, %0, c7, c5, 0	@ invalidate I-cache\n"
-			    "mcr	p15, 0, %0, c7, c5, 6	@ flush BTAC/BTB\n"
-			    :
-			    : "r" (0));
+			__flush_icache_all();
 			dsb();
 		}
 	}
-	spin_unlock(&cpu_asid_lock);
 
-	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
-	mm->context.id = asid;
+	spin_unlock_irqrestore(&cpu_asid_lock, flags);
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+static int asid_dbg_show(struct seq_file *s, void *unused)
+{
+	unsigned long flushes = 0;
+	int cpu;
+
+	/*
+	 * All full flushes of the local TLBs, not only ours, so that the
+	 * figure compares with any allocator (the old one flushed every
+	 * CPU through flush_tlb_all() at each rollover).
+	 */
+	for_each_possible_cpu(cpu)
+		flushes += per_cpu(tlb_flush_all_count, cpu);
+
+	seq_printf(s, "generation: %u\n",
+		   atomic_read(&asid_generation) >> ASID_BITS);
+	seq_printf(s, "rollovers: %lu\n", asid_rollovers);
+	seq_printf(s, "tlb flushes: %lu\n", flushes);
+
+	return 0;
 }
+
+static int asid_dbg_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, asid_dbg_show, NULL);
+}
+
+static const struct file_operations asid_dbg_fops = {
+	.open		= asid_dbg_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init asid_debugfs_init(void)
+{
+	(void) debugfs_create_file("asid", S_IRUGO, NULL, NULL,
+				   &asid_dbg_fops);
+	return 0;
+}
+late_initcall(asid_debugfs_init);
+
+#endif
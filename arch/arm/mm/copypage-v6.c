@@ -17,6 +17,7 @@
 #include <asm/tlbflush.h>
 #include <asm/cacheflush.h>
 #include <asm/cachetype.h>
+#include <asm/neon.h>
 
 #include "mm.h"
 
@@ -56,6 +57,65 @@ static void v6_clear_user_highpage_nonaliasing(struct page *page, unsigned long
 	kunmap_atomic(kaddr, KM_USER0);
 }
 
+#ifdef CONFIG_ARM_NEON_COPY
+/*
+ * As above, with NEON.  The kernel mode NEON section saves any user
+ * VFP state on this CPU, which the faulting task is likely to need
+ * again, but a page is still well worth it on Cortex-A8.
+ */
+static void v6_copy_user_highpage_neon(struct page *to,
+	struct page *from, unsigned long vaddr)
+{
+	void *kto, *kfrom;
+
+	if (!kernel_neon_usable()) {
+		v6_copy_user_highpage_nonaliasing(to, from, vaddr);
+		return;
+	}
+
+	kfrom = kmap_atomic(from, KM_USER0);
+	kto = kmap_atomic(to, KM_USER1);
+	kernel_neon_begin();
+	__copy_page_neon(kto, kfrom);
+	kernel_neon_end();
+	kunmap_atomic(kto, KM_USER1);
+	kunmap_atomic(kfrom, KM_USER0);
+}
+
+static void v6_clear_user_highpage_neon(struct page *page, unsigned long vaddr)
+{
+	void *kaddr;
+
+	if (!kernel_neon_usable()) {
+		v6_clear_user_highpage_nonaliasing(page, vaddr);
+		return;
+	}
+
+	kaddr = kmap_atomic(page, KM_USER0);
+	kernel_neon_begin();
+	__clear_page_neon(kaddr);
+	kernel_neon_end();
+	kunmap_atomic(kaddr, KM_USER0);
+}
+
+/*
+ * HWCAP_NEON is only known once vfp_init() has run, at late_initcall
+ * time.
+ */
+static int __init v6_userpage_neon_init(void)
+{
+	if (!cache_is_vipt_aliasing() && cpu_has_neon() &&
+	    cpu_user.cpu_copy_user_highpage == v6_copy_user_highpage_nonaliasing) {
+		cpu_user.cpu_clear_user_highpage = v6_clear_user_highpage_neon;
+		cpu_user.cpu_copy_user_highpage = v6_copy_user_highpage_neon;
+	}
+
+	return 0;
+}
+
+late_initcall_sync(v6_userpage_neon_init);
+#endif
+
 /*
  * Discard data in the kernel mapping for the new page.
  * FIXME: needs this MCRR to be supported.
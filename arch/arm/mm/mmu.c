@@ -32,6 +32,11 @@
 
 DEFINE_PER_CPU(struct mmu_gather, mmu_gathers);
 
+#ifdef CONFIG_DEBUG_FS
+DEFINE_PER_CPU(unsigned long, tlb_flush_all_count);
+EXPORT_PER_CPU_SYMBOL(tlb_flush_all_count);
+#endif
+
 /*
  * empty_zero_page is a special page that is used for
  * zero-initialized data and COW.
@@ -23,6 +23,12 @@
 #include <linux/cpufreq.h>
 #include <linux/debugfs.h>
 #include <linux/io.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/hrtimer.h>
+#include <linux/uaccess.h>
+#include <linux/notifier.h>
+#include <linux/slab.h>
 
 #include <plat/clock.h>
 
@@ -79,6 +85,17 @@ int clk_enable(struct clk *clk)
 		ret = arch_clock->clk_enable(clk);
 	spin_unlock_irqrestore(&clockfw_lock, flags);
 
+	/*
+	 * Waiting for the modules behind the clock to become ready can
+	 * take a while and needs no lock, so do it with interrupts on
+	 * and without holding up other clock framework users.  Every
+	 * caller waits, not just the one which turned the clock on: a
+	 * second user may get here before the first one's module is
+	 * ready, and once it is the check costs one register read.
+	 */
+	if (!ret && arch_clock->clk_wait_ready)
+		arch_clock->clk_wait_ready(clk);
+
 	return ret;
 }
 EXPORT_SYMBOL(clk_enable);
@@ -106,19 +123,17 @@ out:
 }
 EXPORT_SYMBOL(clk_disable);
 
+/*
+ * clk->rate is a single word that is only ever stored whole, and a
+ * caller can't act on it atomically with a rate change anyway, so
+ * this doesn't need to contend for clockfw_lock.
+ */
 unsigned long clk_get_rate(struct clk *clk)
 {
-	unsigned long flags;
-	unsigned long ret = 0;
-
 	if (clk == NULL || IS_ERR(clk))
 		return 0;
 
-	spin_lock_irqsave(&clockfw_lock, flags);
-	ret = clk->rate;
-	spin_unlock_irqrestore(&clockfw_lock, flags);
-
-	return ret;
+	return ACCESS_ONCE(clk->rate);
 }
 EXPORT_SYMBOL(clk_get_rate);
 
@@ -145,20 +160,36 @@ EXPORT_SYMBOL(clk_round_rate);
 
 int clk_set_rate(struct clk *clk, unsigned long rate)
 {
-	unsigned long flags;
+	unsigned long flags, old_rate;
+	long new_rate = rate;
 	int ret = -EINVAL;
 
 	if (clk == NULL || IS_ERR(clk))
 		return ret;
 
 	spin_lock_irqsave(&clockfw_lock, flags);
-	if (arch_clock->clk_set_rate)
-		ret = arch_clock->clk_set_rate(clk, rate);
-	if (ret == 0) {
-		if (clk->recalc)
-			clk->rate = clk->recalc(clk);
-		propagate_rate(clk);
+	if (arch_clock->clk_set_rate) {
+		/*
+		 * Tell consumers the rate the clock will really end up at.
+		 * If that is the current one there is nothing to do.
+		 */
+		if (arch_clock->clk_round_rate)
+			new_rate = arch_clock->clk_round_rate(clk, rate);
+		if (new_rate == clk->rate) {
+			ret = 0;
+			goto out;
+		}
+		if (new_rate <= 0)
+			new_rate = rate;
+
+		old_rate = clk->rate;
+		ret = clk_rate_change_begin(clk, new_rate);
+		if (ret == 0) {
+			ret = arch_clock->clk_set_rate(clk, rate);
+			clk_rate_change_finish(clk, old_rate, ret);
+		}
 	}
+out:
 	spin_unlock_irqrestore(&clockfw_lock, flags);
 
 	return ret;
@@ -167,7 +198,8 @@ EXPORT_SYMBOL(clk_set_rate);
 
 int clk_set_parent(struct clk *clk, struct clk *parent)
 {
-	unsigned long flags;
+	unsigned long flags, old_rate;
+	long new_rate;
 	int ret = -EINVAL;
 
 	if (cpu_is_omap44xx())
@@ -178,15 +210,29 @@ int clk_set_parent(struct clk *clk, struct clk *parent)
 
 	spin_lock_irqsave(&clockfw_lock, flags);
 	if (clk->usecount == 0) {
-		if (arch_clock->clk_set_parent)
-			ret = arch_clock->clk_set_parent(clk, parent);
-		if (ret == 0) {
-			if (clk->recalc)
-				clk->rate = clk->recalc(clk);
-			propagate_rate(clk);
+		if (arch_clock->clk_set_parent) {
+			/*
+			 * Reparenting changes rates like clk_set_rate() does.
+			 * If the new rate can't be predicted, the change is
+			 * announced once it is known.
+			 */
+			new_rate = clk->rate;
+			if (arch_clock->clk_round_parent)
+				new_rate = arch_clock->clk_round_parent(clk,
+									parent);
+			if (new_rate <= 0)
+				goto out;
+
+			old_rate = clk->rate;
+			ret = clk_rate_change_begin(clk, new_rate);
+			if (ret == 0) {
+				ret = arch_clock->clk_set_parent(clk, parent);
+				clk_rate_change_finish(clk, old_rate, ret);
+			}
 		}
 	} else
 		ret = -EBUSY;
+out:
 	spin_unlock_irqrestore(&clockfw_lock, flags);
 
 	return ret;
@@ -252,6 +298,374 @@ void propagate_rate(struct clk * tclk)
 	}
 }
 
+/*
+ * Rate change transactions
+ *
+ * A rate change is done in three steps, all under the clock framework
+ * lock: clk_rate_change_begin() works out the new rate of every clock
+ * below the one being changed, stores it in their ->temp_rate, and
+ * sends CLK_PRE_RATE_CHANGE; the caller programs the hardware; and
+ * clk_rate_change_finish() either commits the precomputed rates and
+ * sends CLK_POST_RATE_CHANGE, or sends CLK_ABORT_RATE_CHANGE.  Between
+ * begin and finish ->rate still holds the old rates, and after the
+ * commit ->temp_rate holds them instead.  Only clocks told about the
+ * change with CLK_PRE_RATE_CHANGE get the ABORT.
+ */
+
+struct clk_notifier {
+	struct clk			*clk;
+	struct raw_notifier_head	notifier_head;
+	struct list_head		node;
+};
+
+static LIST_HEAD(clk_notifier_list);
+
+static struct clk_notifier *_clk_find_notifier(struct clk *clk)
+{
+	struct clk_notifier *cn;
+
+	list_for_each_entry(cn, &clk_notifier_list, node)
+		if (cn->clk == clk)
+			return cn;
+
+	return NULL;
+}
+
+/**
+ * clk_notifier_register - get told about rate changes of a clock
+ * @clk: struct clk * to watch
+ * @nb: notifier_block to call, see CLK_PRE_RATE_CHANGE and friends
+ *
+ * Returns 0, -EINVAL for a bad clock or -ENOMEM.
+ */
+int clk_notifier_register(struct clk *clk, struct notifier_block *nb)
+{
+	struct clk_notifier *cn, *new_cn;
+	unsigned long flags;
+	int ret;
+
+	if (clk == NULL || IS_ERR(clk) || !nb)
+		return -EINVAL;
+
+	new_cn = kzalloc(sizeof(*new_cn), GFP_KERNEL);
+	if (!new_cn)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&clockfw_lock, flags);
+
+	cn = _clk_find_notifier(clk);
+	if (!cn) {
+		cn = new_cn;
+		new_cn = NULL;
+		cn->clk = clk;
+		RAW_INIT_NOTIFIER_HEAD(&cn->notifier_head);
+		list_add(&cn->node, &clk_notifier_list);
+	}
+	ret = raw_notifier_chain_register(&cn->notifier_head, nb);
+
+	spin_unlock_irqrestore(&clockfw_lock, flags);
+
+	kfree(new_cn);
+
+	return ret;
+}
+EXPORT_SYMBOL(clk_notifier_register);
+
+/**
+ * clk_notifier_unregister - stop getting told about rate changes
+ * @clk: struct clk * passed to clk_notifier_register()
+ * @nb: notifier_block passed to clk_notifier_register()
+ *
+ * Returns 0, or -ENOENT if @nb was not registered for @clk.
+ */
+int clk_notifier_unregister(struct clk *clk, struct notifier_block *nb)
+{
+	struct clk_notifier *cn;
+	unsigned long flags;
+	int ret = -ENOENT;
+
+	if (clk == NULL || IS_ERR(clk) || !nb)
+		return -EINVAL;
+
+	spin_lock_irqsave(&clockfw_lock, flags);
+
+	cn = _clk_find_notifier(clk);
+	if (cn) {
+		ret = raw_notifier_chain_unregister(&cn->notifier_head, nb);
+		if (cn->notifier_head.head)
+			cn = NULL;
+		else
+			list_del(&cn->node);
+	}
+
+	spin_unlock_irqrestore(&clockfw_lock, flags);
+
+	kfree(cn);
+
+	return ret;
+}
+EXPORT_SYMBOL(clk_notifier_unregister);
+
+/*
+ * clk_rate_change_begin() may be called again by a set_rate function,
+ * e.g. when moving an OPP reprograms several DPLLs.  Such a nested
+ * transaction only takes the clocks no enclosing one owns; ->rate_txn
+ * is the nesting level of the owner, 0 for none.  Its consumers are
+ * told CLK_PRE_RATE_CHANGE before its hardware changes, but after its
+ * commit the clocks pass to the outermost transaction, which sends
+ * the CLK_POST_RATE_CHANGE for all of them at the end.
+ */
+#define CLK_RATE_MAX_NESTED	4
+
+static int clk_rate_depth;
+static struct clk *clk_rate_nested[CLK_RATE_MAX_NESTED];
+static int clk_rate_nested_cnt;
+
+/* ->rate_flags */
+#define CLK_RATE_NOTIFIED	(1 << 0)	/* got CLK_PRE_RATE_CHANGE */
+#define CLK_RATE_COMMITTED	(1 << 1)	/* ->temp_rate is the old rate */
+
+static int _clk_call_notifiers(struct clk *clk, unsigned long msg,
+			       unsigned long old_rate, unsigned long new_rate,
+			       int nr_to_call, int *nr_calls)
+{
+	struct clk_notifier_data cnd;
+	struct clk_notifier *cn;
+
+	cn = _clk_find_notifier(clk);
+	if (!cn)
+		return 0;
+
+	cnd.clk = clk;
+	cnd.old_rate = old_rate;
+	cnd.new_rate = new_rate;
+
+	return notifier_to_errno(__raw_notifier_call_chain(&cn->notifier_head,
+				msg, &cnd, nr_to_call, nr_calls));
+}
+
+/*
+ * Take the clocks below @clk that nobody owns for transaction @level and
+ * compute their ->temp_rate from @clk's.
+ */
+static void _clk_predict_rates(struct clk *clk, int level)
+{
+	unsigned long rate = clk->rate;
+	struct clk *child;
+
+	/* The children's recalc functions look at their parent's ->rate */
+	clk->rate = clk->temp_rate;
+	list_for_each_entry(child, &clk->children, sibling) {
+		if (child->rate_txn && child->rate_txn != level)
+			continue;
+		child->rate_txn = level;
+		child->temp_rate = child->recalc ? child->recalc(child) :
+			child->rate;
+		_clk_predict_rates(child, level);
+	}
+	clk->rate = rate;
+}
+
+/* Swap ->rate and ->temp_rate of the clocks of @level below @clk */
+static void _clk_commit_rates(struct clk *clk, int level)
+{
+	unsigned long rate = clk->rate;
+	struct clk *child;
+
+	if (!(clk->rate_flags & CLK_RATE_COMMITTED)) {
+		clk->rate = clk->temp_rate;
+		clk->temp_rate = rate;
+		clk->rate_flags |= CLK_RATE_COMMITTED;
+	}
+
+	list_for_each_entry(child, &clk->children, sibling)
+		if (child->rate_txn == level)
+			_clk_commit_rates(child, level);
+}
+
+/* Hand the clocks of @level below @clk over to transaction @new_level */
+static void _clk_pass_rates(struct clk *clk, int level, int new_level)
+{
+	struct clk *child;
+
+	clk->rate_txn = new_level;
+	list_for_each_entry(child, &clk->children, sibling)
+		if (child->rate_txn == level)
+			_clk_pass_rates(child, level, new_level);
+}
+
+/*
+ * Send CLK_PRE_RATE_CHANGE to the clocks of @level below @clk, parents
+ * first.  If a notifier vetoes, the notifiers of that clock called
+ * before it get CLK_ABORT_RATE_CHANGE right away and the error is
+ * passed back; the clocks already walked are left marked NOTIFIED.
+ */
+static int _clk_notify_pre(struct clk *clk, int level)
+{
+	struct clk *child;
+	int ret, nr_calls = 0;
+
+	if (clk->rate != clk->temp_rate) {
+		ret = _clk_call_notifiers(clk, CLK_PRE_RATE_CHANGE, clk->rate,
+					  clk->temp_rate, -1, &nr_calls);
+		if (ret) {
+			pr_debug("clock: %s: rate change to %lu vetoed (%d)\n",
+				 clk->name, clk->temp_rate, ret);
+			_clk_call_notifiers(clk, CLK_ABORT_RATE_CHANGE,
+					    clk->rate, clk->temp_rate,
+					    nr_calls - 1, NULL);
+			return ret;
+		}
+		clk->rate_flags |= CLK_RATE_NOTIFIED;
+	}
+
+	list_for_each_entry(child, &clk->children, sibling) {
+		if (child->rate_txn != level)
+			continue;
+		ret = _clk_notify_pre(child, level);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Close the transaction @level for the clocks below @clk.  Committed
+ * clocks get CLK_POST_RATE_CHANGE, or CLK_ABORT_RATE_CHANGE if they
+ * did not change after all; a change nobody was told about is
+ * announced late, just before its CLK_POST_RATE_CHANGE.  Uncommitted
+ * clocks get CLK_ABORT_RATE_CHANGE if they were notified.
+ */
+static void _clk_notify_end(struct clk *clk, int level)
+{
+	unsigned long old_rate, new_rate;
+	struct clk *child;
+
+	if (clk->rate_flags & CLK_RATE_COMMITTED) {
+		old_rate = clk->temp_rate;
+		new_rate = clk->rate;
+	} else {
+		old_rate = clk->rate;
+		new_rate = clk->temp_rate;
+	}
+
+	if (!(clk->rate_flags & CLK_RATE_COMMITTED) || old_rate == new_rate) {
+		if (clk->rate_flags & CLK_RATE_NOTIFIED)
+			_clk_call_notifiers(clk, CLK_ABORT_RATE_CHANGE,
+					    old_rate, new_rate, -1, NULL);
+	} else {
+		if (!(clk->rate_flags & CLK_RATE_NOTIFIED)) {
+			pr_debug("clock: %s: unannounced change to %lu\n",
+				 clk->name, new_rate);
+			_clk_call_notifiers(clk, CLK_PRE_RATE_CHANGE,
+					    old_rate, new_rate, -1, NULL);
+		}
+		_clk_call_notifiers(clk, CLK_POST_RATE_CHANGE,
+				    old_rate, new_rate, -1, NULL);
+	}
+
+	clk->rate_txn = 0;
+	clk->rate_flags = 0;
+
+	list_for_each_entry(child, &clk->children, sibling)
+		if (child->rate_txn == level)
+			_clk_notify_end(child, level);
+}
+
+/**
+ * clk_rate_change_begin - start changing the rate of a clock
+ * @clk: struct clk * about to be reprogrammed
+ * @rate: rate @clk is expected to end up at
+ *
+ * Compute the rates of the clocks below @clk and ask their consumers
+ * whether they can live with them.  Must be called with the clock
+ * framework lock held, and followed by clk_rate_change_finish() if
+ * it returns 0.  Returns the veto as a negative error code, in which
+ * case the consumers already told have been told that the change is
+ * off.  If @clk already belongs to a transaction, returns -EBUSY.
+ */
+int clk_rate_change_begin(struct clk *clk, unsigned long rate)
+{
+	int level = clk_rate_depth + 1;
+	int ret;
+
+	if (clk->rate_txn)
+		return -EBUSY;
+
+	clk->rate_txn = level;
+	clk->temp_rate = rate;
+	_clk_predict_rates(clk, level);
+
+	ret = _clk_notify_pre(clk, level);
+	if (ret) {
+		_clk_notify_end(clk, level);
+		return ret;
+	}
+
+	clk_rate_depth = level;
+
+	return 0;
+}
+
+/**
+ * clk_rate_change_finish - complete a change started with begin()
+ * @clk: struct clk * passed to clk_rate_change_begin()
+ * @old_rate: ->rate of @clk before the hardware was reprogrammed
+ * @err: result of reprogramming the hardware
+ *
+ * If @err is 0, commit the new rates of @clk and the clocks below it.
+ * The rates computed by clk_rate_change_begin() are reused unless @clk
+ * did not end up at the expected rate.  Otherwise, restore ->rate of
+ * @clk.  The outermost transaction then tells the consumers of all the
+ * clocks it and the transactions nested in it changed.  Must be called
+ * with the clock framework lock held.
+ */
+void clk_rate_change_finish(struct clk *clk, unsigned long old_rate, int err)
+{
+	int level = clk_rate_depth;
+	unsigned long rate;
+	int i;
+
+	if (err) {
+		clk->rate = old_rate;
+	} else {
+		/* Some set_rate functions update ->rate themselves */
+		rate = clk->recalc ? clk->recalc(clk) : clk->rate;
+		clk->rate = old_rate;
+
+		if (rate != clk->temp_rate) {
+			pr_debug("clock: %s: rate %lu instead of %lu, "
+				 "recomputing\n", clk->name, rate,
+				 clk->temp_rate);
+			clk->temp_rate = rate;
+			_clk_predict_rates(clk, level);
+		}
+
+		_clk_commit_rates(clk, level);
+	}
+
+	clk_rate_depth--;
+
+	if (level > 1 && !err) {
+		if (clk_rate_nested_cnt < CLK_RATE_MAX_NESTED) {
+			_clk_pass_rates(clk, level, 1);
+			clk_rate_nested[clk_rate_nested_cnt++] = clk;
+			return;
+		}
+		WARN_ONCE(1, "clock: too many nested rate changes\n");
+	}
+
+	_clk_notify_end(clk, level);
+
+	if (level > 1)
+		return;
+
+	for (i = 0; i < clk_rate_nested_cnt; i++)
+		_clk_notify_end(clk_rate_nested[i], 1);
+	clk_rate_nested_cnt = 0;
+}
+
 static LIST_HEAD(root_clks);
 
 /**
@@ -470,6 +884,153 @@ static int clk_debugfs_register(struct clk *c)
 	return 0;
 }
 
+/*
+ * clock/benchmark: writing "<clock> <loops> [<threads>]" times <loops>
+ * clk_enable()/clk_disable() pairs on <clock> in each of <threads>
+ * kernel threads running concurrently, to measure the cost of the
+ * enable path and of contention on the clock framework lock.  Reading
+ * the file shows the result of the last run.  The clock should not be
+ * in use by anyone else, so that every pair walks the clock tree.
+ */
+#define CLK_BENCH_MAX_THREADS		16
+
+struct clk_bench_thread {
+	struct clk		*clk;
+	unsigned int		loops;
+	s64			ns;
+	struct completion	*start;
+	struct completion	*done;
+	atomic_t		*running;
+};
+
+static DEFINE_MUTEX(clk_bench_mutex);
+static char clk_bench_result[160];
+
+static int clk_bench_thread(void *data)
+{
+	struct clk_bench_thread *bt = data;
+	ktime_t t;
+	unsigned int i;
+
+	wait_for_completion(bt->start);
+
+	t = ktime_get();
+	for (i = 0; i < bt->loops; i++) {
+		clk_enable(bt->clk);
+		clk_disable(bt->clk);
+	}
+	bt->ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+	if (atomic_dec_and_test(bt->running))
+		complete(bt->done);
+
+	return 0;
+}
+
+static int clk_bench_run(struct clk *clk, unsigned int loops,
+			 unsigned int threads)
+{
+	DECLARE_COMPLETION_ONSTACK(start);
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct clk_bench_thread *bt;
+	struct task_struct *tsk;
+	atomic_t running;
+	s64 total = 0, max = 0;
+	unsigned int i;
+
+	bt = kcalloc(threads, sizeof(*bt), GFP_KERNEL);
+	if (!bt)
+		return -ENOMEM;
+
+	atomic_set(&running, threads);
+	for (i = 0; i < threads; i++) {
+		bt[i].clk = clk;
+		bt[i].loops = loops;
+		bt[i].start = &start;
+		bt[i].done = &done;
+		bt[i].running = &running;
+		tsk = kthread_run(clk_bench_thread, &bt[i], "clkbench/%u", i);
+		if (IS_ERR(tsk)) {
+			/* The threads already started still have to finish */
+			if (atomic_sub_and_test(threads - i, &running))
+				complete(&done);
+			break;
+		}
+	}
+
+	complete_all(&start);
+	wait_for_completion(&done);
+
+	if (i < threads) {
+		kfree(bt);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < threads; i++) {
+		total += bt[i].ns;
+		if (bt[i].ns > max)
+			max = bt[i].ns;
+	}
+	kfree(bt);
+
+	snprintf(clk_bench_result, sizeof(clk_bench_result),
+		 "%s: %u threads x %u enable/disable pairs: "
+		 "avg %llu ns/pair, slowest thread %llu ns/pair\n",
+		 clk->name, threads, loops,
+		 div_u64(total, threads * loops), div_u64(max, loops));
+
+	return 0;
+}
+
+static ssize_t clk_bench_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	char buf[64], name[32];
+	unsigned int loops, threads = 1;
+	struct clk *clk;
+	int ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%31s %u %u", name, &loops, &threads) < 2 ||
+	    !loops || !threads || threads > CLK_BENCH_MAX_THREADS)
+		return -EINVAL;
+
+	clk = clk_get(NULL, name);
+	if (IS_ERR(clk))
+		return PTR_ERR(clk);
+
+	mutex_lock(&clk_bench_mutex);
+	ret = clk_bench_run(clk, loops, threads);
+	mutex_unlock(&clk_bench_mutex);
+
+	clk_put(clk);
+
+	return ret ? ret : count;
+}
+
+static ssize_t clk_bench_read(struct file *file, char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+
+	mutex_lock(&clk_bench_mutex);
+	ret = simple_read_from_buffer(ubuf, count, ppos, clk_bench_result,
+				      strlen(clk_bench_result));
+	mutex_unlock(&clk_bench_mutex);
+
+	return ret;
+}
+
+static const struct file_operations clk_bench_fops = {
+	.read		= clk_bench_read,
+	.write		= clk_bench_write,
+};
+
 static int __init clk_debugfs_init(void)
 {
 	struct clk *c;
@@ -481,6 +1042,13 @@ static int __init clk_debugfs_init(void)
 		return -ENOMEM;
 	clk_debugfs_root = d;
 
+	d = debugfs_create_file("benchmark", S_IRUGO | S_IWUSR,
+				clk_debugfs_root, NULL, &clk_bench_fops);
+	if (!d) {
+		err = -ENOMEM;
+		goto err_out;
+	}
+
 	list_for_each_entry(c, &clocks, node) {
 		err = clk_debugfs_register(c);
 		if (err)
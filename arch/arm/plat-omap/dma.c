@@ -451,6 +451,34 @@ void omap_set_dma_params(int lch, struct omap_dma_channel_params *params)
 }
 EXPORT_SYMBOL(omap_set_dma_params);
 
+/*
+ * Reprogram only the per-transfer registers of a channel: source and
+ * destination start address plus element and frame counts. The static
+ * channel configuration (data type, addressing modes, synchronization,
+ * burst) must already have been set up with omap_set_dma_params(). This
+ * lets clients streaming equally shaped blocks through one channel skip
+ * the read-modify-write cycles of the full setup path.
+ */
+void omap_set_dma_xfer(int lch, unsigned long src_start,
+		       unsigned long dst_start, int elem_count, int frame_count)
+{
+	if (cpu_class_is_omap1()) {
+		dma_write(src_start >> 16, CSSA_U(lch));
+		dma_write((u16)src_start, CSSA_L(lch));
+		dma_write(dst_start >> 16, CDSA_U(lch));
+		dma_write((u16)dst_start, CDSA_L(lch));
+	}
+
+	if (cpu_class_is_omap2()) {
+		dma_write(src_start, CSSA(lch));
+		dma_write(dst_start, CDSA(lch));
+	}
+
+	dma_write(elem_count, CEN(lch));
+	dma_write(frame_count, CFN(lch));
+}
+EXPORT_SYMBOL(omap_set_dma_xfer);
+
 void omap_set_dma_src_index(int lch, int eidx, int fidx)
 {
 	if (cpu_class_is_omap2())
@@ -1183,6 +1211,63 @@ void omap_dma_unlink_lch(int lch_head, int lch_queue)
 }
 EXPORT_SYMBOL(omap_dma_unlink_lch);
 
+#ifndef CONFIG_ARCH_OMAP1
+/*
+ * Arm the hardware link of an already running lch_head so that lch_queue,
+ * which must be fully programmed, is started by the controller as soon as
+ * lch_head completes its block. Unlike omap_dma_link_lch() this does not
+ * touch the software link map walked by omap_start_dma()/omap_stop_dma().
+ *
+ * Returns -EBUSY if lch_head had already finished before the link could be
+ * armed, in which case the caller has to start lch_queue itself. Must be
+ * called with interrupts disabled so that the completion interrupt of
+ * lch_queue cannot clear its status behind our back.
+ */
+int omap_dma_hw_link_lch(int lch_head, int lch_queue)
+{
+	u32 l;
+
+	if (!cpu_class_is_omap2())
+		return -EINVAL;
+
+	omap_enable_channel_irq(lch_queue);
+
+	l = dma_read(CLNK_CTRL(lch_head));
+	l &= ~0x1f;
+	l |= lch_queue | (1 << 15);
+	dma_write(l, CLNK_CTRL(lch_head));
+
+	if (dma_read(CCR(lch_head)) & OMAP_DMA_CCR_EN)
+		return 0;
+	if (dma_read(CCR(lch_queue)) & OMAP_DMA_CCR_EN)
+		return 0;
+	if (dma_read(CSR(lch_queue)) & OMAP_DMA_BLOCK_IRQ)
+		return 0;
+
+	/* lch_head was already done, the link will never fire */
+	omap_dma_hw_unlink_lch(lch_head);
+
+	return -EBUSY;
+}
+EXPORT_SYMBOL(omap_dma_hw_link_lch);
+
+/*
+ * Disarm a link set up by omap_dma_hw_link_lch().
+ */
+void omap_dma_hw_unlink_lch(int lch)
+{
+	u32 l;
+
+	if (!cpu_class_is_omap2())
+		return;
+
+	l = dma_read(CLNK_CTRL(lch));
+	l &= ~(1 << 15);
+	dma_write(l, CLNK_CTRL(lch));
+}
+EXPORT_SYMBOL(omap_dma_hw_unlink_lch);
+#endif
+
 /*----------------------------------------------------------------------------*/
 
 #ifndef CONFIG_ARCH_OMAP1
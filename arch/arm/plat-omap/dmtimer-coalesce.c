@@ -0,0 +1,395 @@
+/*
+ * OMAP dual-mode timer based wakeup coalescing
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Drivers polling slow hardware (battery gauges, sensors, link state)
+ * rarely need their callback at an exact time.  Each timer here has an
+ * earliest time it may run and a slack it can tolerate after that.  All
+ * of them share one dual-mode timer clocked from the 32 KiHz clock,
+ * which is programmed for the tightest of the deadlines; when it fires
+ * every timer already due is run, so timers whose windows overlap cost
+ * a single wakeup.  Deferrable timers run with the first wakeup after
+ * they are due, be it for another timer here or any other interrupt
+ * taking the system out of idle; only when CTIMER_DEFER_SLACK has
+ * passed on top of their own slack do they wake up the system.
+ *
+ * Callbacks are run in hard interrupt context.  Each of them shows up in
+ * /proc/timer_stats, along with a "<coalesced>" entry counting the
+ * wakeups that were saved.
+ */
+#undef DEBUG
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/spinlock.h>
+#include <linux/sched.h>
+#include <linux/clk.h>
+#include <linux/timer.h>
+#include <linux/hrtimer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <plat/dmtimer.h>
+
+/* Timer internal resynch latency */
+#define CTIMER_MIN_CYCLES	3
+
+/* Longest single programming, the counter wraps in about 36 hours */
+#define CTIMER_MAX_NS		(12ULL * 3600 * NSEC_PER_SEC)
+
+/* How late a deferrable timer may get before it wakes up the system */
+#define CTIMER_DEFER_SLACK_NS	(10ULL * NSEC_PER_SEC)
+
+static struct omap_dm_timer *ctimer_gpt;
+static unsigned long ctimer_rate;
+
+/* pending timers, sorted by expiry */
+static LIST_HEAD(ctimer_list);
+static DEFINE_SPINLOCK(ctimer_lock);
+
+/* wakeup the hardware is armed for, KTIME_MAX when stopped */
+static ktime_t ctimer_next = { .tv64 = KTIME_MAX };
+
+static unsigned long ctimer_wakeups;
+static unsigned long ctimer_runs;
+static unsigned long ctimer_coalesced;
+
+static irqreturn_t omap_dm_ctimer_interrupt(int irq, void *dev_id);
+
+static void omap_dm_ctimer_program(void)
+{
+	struct omap_dm_ctimer *t;
+	ktime_t next = { .tv64 = KTIME_MAX };
+	s64 delta;
+	u32 cycles;
+
+	list_for_each_entry(t, &ctimer_list, entry)
+		if (t->latest.tv64 < next.tv64)
+			next = t->latest;
+
+	if (next.tv64 == ctimer_next.tv64)
+		return;
+
+	/*
+	 * Armed for earlier than needed: leave it, the interrupt will
+	 * program the next wakeup.  Timers pushed back over and over,
+	 * like inactivity timeouts, then don't touch the hardware each
+	 * time.
+	 */
+	if (ctimer_next.tv64 && next.tv64 != KTIME_MAX &&
+	    next.tv64 > ctimer_next.tv64)
+		return;
+
+	if (next.tv64 == KTIME_MAX) {
+		omap_dm_timer_stop(ctimer_gpt);
+		omap_dm_timer_disable(ctimer_gpt);
+		ctimer_next = next;
+		return;
+	}
+
+	delta = ktime_to_ns(ktime_sub(next, ktime_get()));
+	if (delta < 0)
+		delta = 0;
+	else if (delta > CTIMER_MAX_NS)
+		delta = CTIMER_MAX_NS;
+	cycles = div_u64((u64)delta * ctimer_rate, NSEC_PER_SEC);
+	if (cycles < CTIMER_MIN_CYCLES)
+		cycles = CTIMER_MIN_CYCLES;
+
+	pr_debug("dmtimer coalesce: next wakeup in %u cycles\n", cycles);
+
+	omap_dm_timer_enable(ctimer_gpt);
+	omap_dm_timer_set_load_start(ctimer_gpt, 0, 0xffffffff - cycles);
+	ctimer_next = next;
+}
+
+static void omap_dm_ctimer_enqueue(struct omap_dm_ctimer *t)
+{
+	struct omap_dm_ctimer *pos;
+
+	list_for_each_entry(pos, &ctimer_list, entry)
+		if (pos->expires.tv64 > t->expires.tv64)
+			break;
+	list_add_tail(&t->entry, &pos->entry);
+}
+
+static inline void omap_dm_ctimer_account(struct omap_dm_ctimer *t, int n)
+{
+#ifdef CONFIG_TIMER_STATS
+	static char coalesced[] = "<coalesced>";
+
+	/* armed while timer_stats was off */
+	if (!t->start_site)
+		return;
+
+	timer_stats_update_stats(t, t->start_pid, t->start_site, t->function,
+				 t->start_comm,
+				 t->flags & OMAP_DM_CTIMER_DEFERRABLE ?
+				 TIMER_STATS_FLAG_DEFERRABLE : 0);
+
+	/* every timer after the first one rode on a shared wakeup */
+	if (n)
+		timer_stats_update_stats(&ctimer_list, 0, t->start_site,
+					 omap_dm_ctimer_interrupt, coalesced, 0);
+#endif
+}
+
+/*
+ * Run the timers due, with ctimer_lock held.  @n is the number of
+ * timers which already ran on this wakeup, 1 if it was not ours.
+ */
+static void omap_dm_ctimer_run(int n)
+{
+	struct omap_dm_ctimer *t;
+	ktime_t now;
+
+	now = ktime_get();
+	while (!list_empty(&ctimer_list)) {
+		t = list_first_entry(&ctimer_list, struct omap_dm_ctimer,
+				     entry);
+		if (t->expires.tv64 > now.tv64)
+			break;
+
+		list_del_init(&t->entry);
+		ctimer_runs++;
+		if (n)
+			ctimer_coalesced++;
+		spin_unlock(&ctimer_lock);
+
+		omap_dm_ctimer_account(t, n++);
+		t->function(t->data);
+
+		spin_lock(&ctimer_lock);
+	}
+}
+
+static irqreturn_t omap_dm_ctimer_interrupt(int irq, void *dev_id)
+{
+	spin_lock(&ctimer_lock);
+
+	omap_dm_timer_write_status(ctimer_gpt, OMAP_TIMER_INT_OVERFLOW);
+
+	/* one-shot: the counter has stopped, but is still clocked */
+	ctimer_next.tv64 = 0;
+	ctimer_wakeups++;
+
+	omap_dm_ctimer_run(0);
+	omap_dm_ctimer_program();
+
+	spin_unlock(&ctimer_lock);
+
+	return IRQ_HANDLED;
+}
+
+/**
+ * omap_dm_ctimer_run_due - run the timers due on a system wakeup
+ *
+ * Called with interrupts disabled by the idle code once the system is
+ * back up, so that the timers due, deferrable ones in particular, ride
+ * on whatever woke it up.
+ */
+void omap_dm_ctimer_run_due(void)
+{
+	struct omap_dm_ctimer *t;
+
+	if (!ctimer_gpt)
+		return;
+
+	spin_lock(&ctimer_lock);
+
+	if (!list_empty(&ctimer_list)) {
+		t = list_first_entry(&ctimer_list, struct omap_dm_ctimer,
+				     entry);
+		if (t->expires.tv64 <= ktime_get().tv64) {
+			omap_dm_ctimer_run(1);
+			omap_dm_ctimer_program();
+		}
+	}
+
+	spin_unlock(&ctimer_lock);
+}
+
+/**
+ * omap_dm_ctimer_get_irq - interrupt of the dual-mode timer in use
+ *
+ * For the PM code, which has to let it wake up the system.  Returns
+ * -ENODEV if there is none.
+ */
+int omap_dm_ctimer_get_irq(void)
+{
+	return ctimer_gpt ? omap_dm_timer_get_irq(ctimer_gpt) : -ENODEV;
+}
+
+/**
+ * omap_dm_ctimer_init - initialize a coalesced timer
+ * @t: timer
+ * @function: callback, run in hard interrupt context
+ * @data: callback argument
+ * @flags: OMAP_DM_CTIMER_DEFERRABLE for a timer that should not wake
+ *	   up the system by itself
+ */
+void omap_dm_ctimer_init(struct omap_dm_ctimer *t,
+			 void (*function)(unsigned long), unsigned long data,
+			 unsigned int flags)
+{
+	memset(t, 0, sizeof(*t));
+	INIT_LIST_HEAD(&t->entry);
+	t->function = function;
+	t->data = data;
+	t->flags = flags;
+}
+EXPORT_SYMBOL_GPL(omap_dm_ctimer_init);
+
+/**
+ * omap_dm_ctimer_mod - (re)arm a coalesced timer
+ * @t: timer
+ * @delay_ms: earliest the callback may run, from now
+ * @slack_ms: how much later than that is still acceptable
+ *
+ * Returns 1 if the timer was pending, 0 if it was not, or -ENODEV if
+ * there is no timer to run it on.
+ */
+int omap_dm_ctimer_mod(struct omap_dm_ctimer *t, unsigned int delay_ms,
+		       unsigned int slack_ms)
+{
+	unsigned long flags;
+	int pending;
+
+	if (!ctimer_gpt)
+		return -ENODEV;
+
+	spin_lock_irqsave(&ctimer_lock, flags);
+
+	pending = !list_empty(&t->entry);
+	if (pending)
+		list_del(&t->entry);
+
+	t->expires = ktime_add_ns(ktime_get(), (u64)delay_ms * NSEC_PER_MSEC);
+	t->latest = ktime_add_ns(t->expires, (u64)slack_ms * NSEC_PER_MSEC);
+	if (t->flags & OMAP_DM_CTIMER_DEFERRABLE)
+		t->latest = ktime_add_ns(t->latest, CTIMER_DEFER_SLACK_NS);
+#ifdef CONFIG_TIMER_STATS
+	if (timer_stats_active && !t->start_site) {
+		t->start_site = __builtin_return_address(0);
+		memcpy(t->start_comm, current->comm, TASK_COMM_LEN);
+		t->start_pid = current->pid;
+	}
+#endif
+	omap_dm_ctimer_enqueue(t);
+	omap_dm_ctimer_program();
+
+	spin_unlock_irqrestore(&ctimer_lock, flags);
+
+	return pending;
+}
+EXPORT_SYMBOL_GPL(omap_dm_ctimer_mod);
+
+/**
+ * omap_dm_ctimer_del - deactivate a coalesced timer
+ * @t: timer
+ *
+ * Returns 1 if the timer was pending.  Does not wait for a running
+ * callback to complete.
+ */
+int omap_dm_ctimer_del(struct omap_dm_ctimer *t)
+{
+	unsigned long flags;
+	int pending;
+
+	spin_lock_irqsave(&ctimer_lock, flags);
+
+	pending = !list_empty(&t->entry);
+	if (pending) {
+		list_del_init(&t->entry);
+		omap_dm_ctimer_program();
+	}
+
+	spin_unlock_irqrestore(&ctimer_lock, flags);
+
+	return pending;
+}
+EXPORT_SYMBOL_GPL(omap_dm_ctimer_del);
+
+#ifdef CONFIG_DEBUG_FS
+
+static int omap_dm_ctimer_dbg_show(struct seq_file *s, void *unused)
+{
+	unsigned long wakeups, runs, coalesced, secs;
+	struct timespec uptime;
+
+	wakeups = ctimer_wakeups;
+	runs = ctimer_runs;
+	coalesced = ctimer_coalesced;
+
+	do_posix_clock_monotonic_gettime(&uptime);
+	secs = uptime.tv_sec ? uptime.tv_sec : 1;
+
+	seq_printf(s, "timers run: %lu\n", runs);
+	seq_printf(s, "wakeups: %lu (%lu.%02lu/s)\n", wakeups,
+		   wakeups / secs, (wakeups % secs) * 100 / secs);
+	seq_printf(s, "coalesced: %lu (%lu.%02lu/s)\n", coalesced,
+		   coalesced / secs, (coalesced % secs) * 100 / secs);
+
+	return 0;
+}
+
+static int omap_dm_ctimer_dbg_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omap_dm_ctimer_dbg_show, NULL);
+}
+
+static const struct file_operations omap_dm_ctimer_dbg_fops = {
+	.open		= omap_dm_ctimer_dbg_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init omap_dm_ctimer_debugfs_init(void)
+{
+	(void) debugfs_create_file("dmtimer_coalesce", S_IRUGO, NULL, NULL,
+				   &omap_dm_ctimer_dbg_fops);
+}
+
+#else
+static inline void omap_dm_ctimer_debugfs_init(void) { }
+#endif
+
+static int __init omap_dm_ctimer_setup(void)
+{
+	struct omap_dm_timer *gpt;
+	int ret;
+
+	gpt = omap_dm_timer_request();
+	if (!gpt) {
+		printk(KERN_ERR "dmtimer coalesce: no timer available\n");
+		return -ENODEV;
+	}
+
+	omap_dm_timer_set_source(gpt, OMAP_TIMER_SRC_32_KHZ);
+	ctimer_rate = clk_get_rate(omap_dm_timer_get_fclk(gpt));
+	omap_dm_timer_set_int_enable(gpt, OMAP_TIMER_INT_OVERFLOW);
+
+	ret = request_irq(omap_dm_timer_get_irq(gpt), omap_dm_ctimer_interrupt,
+			  IRQF_DISABLED, "dmtimer coalesce", NULL);
+	if (ret) {
+		omap_dm_timer_free(gpt);
+		return ret;
+	}
+
+	/* clocks stay off until a timer is armed */
+	omap_dm_timer_disable(gpt);
+	ctimer_gpt = gpt;
+
+	omap_dm_ctimer_debugfs_init();
+
+	return 0;
+}
+arch_initcall(omap_dm_ctimer_setup);
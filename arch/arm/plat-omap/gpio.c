@@ -192,6 +192,7 @@ struct gpio_bank {
 	u32 saved_risingdetect;
 #endif
 	u32 level_mask;
+	u32 demux_acked;	/* edge irqs cleared by gpio_irq_handler() */
 	spinlock_t lock;
 	struct gpio_chip chip;
 	struct clk *dbck;
@@ -1235,13 +1236,17 @@ static void gpio_irq_handler(unsigned int irq, struct irq_desc *desc)
 		if (!isr)
 			break;
 
-		gpio_irq = bank->virtual_irq_start;
-		for (; isr != 0; isr >>= 1, gpio_irq++) {
-			if (!(isr & 1))
-				continue;
+		/* the flow handlers' ack need not clear these again */
+		bank->demux_acked = isr_saved & ~level_mask;
+
+		while (isr) {
+			int bit = __ffs(isr);
 
+			isr &= ~(1 << bit);
+			gpio_irq = bank->virtual_irq_start + bit;
 			generic_handle_irq(gpio_irq);
 		}
+		bank->demux_acked = 0;
 	}
 	/* if bank has any level sensitive GPIO pin interrupt
 	configured, we must unmask the bank interrupt only after
@@ -1264,6 +1269,13 @@ static void gpio_ack_irq(unsigned int irq)
 {
 	unsigned int gpio = irq - IH_GPIO_BASE;
 	struct gpio_bank *bank = get_irq_chip_data(irq);
+	u32 mask = 1 << get_gpio_index(gpio);
+
+	/* already cleared when the bank interrupt was demuxed */
+	if (bank->demux_acked & mask) {
+		bank->demux_acked &= ~mask;
+		return;
+	}
 
 	_clear_gpio_irqstatus(bank, gpio);
 }
@@ -1521,6 +1533,164 @@ static int gpio_2irq(struct gpio_chip *chip, unsigned offset)
 	return bank->virtual_irq_start + offset;
 }
 
+/*
+ * Bulk access to the lines of a bank, for bit-banged buses that move
+ * several lines at once.  Bit n of the mask and value stands for line n
+ * of the bank holding @gpio.
+ */
+
+/**
+ * omap_gpio_bank_get - read several lines of a GPIO bank at once
+ * @gpio: any GPIO of the bank
+ * @mask: lines to read
+ * @value: where to store their levels
+ *
+ * Inputs read the pin level, outputs the level being driven, as
+ * gpio_get_value() does.
+ */
+int omap_gpio_bank_get(int gpio, u32 mask, u32 *value)
+{
+	struct gpio_bank *bank;
+	void __iomem *in, *out;
+	u32 dir, l = 0;
+
+	if (check_gpio(gpio) < 0)
+		return -EINVAL;
+	bank = get_gpio_bank(gpio);
+
+	switch (bank->method) {
+#ifdef CONFIG_ARCH_OMAP1
+	case METHOD_MPUIO:
+		in = bank->base + OMAP_MPUIO_INPUT_LATCH;
+		out = bank->base + OMAP_MPUIO_OUTPUT;
+		break;
+#endif
+#ifdef CONFIG_ARCH_OMAP15XX
+	case METHOD_GPIO_1510:
+		in = bank->base + OMAP1510_GPIO_DATA_INPUT;
+		out = bank->base + OMAP1510_GPIO_DATA_OUTPUT;
+		break;
+#endif
+#ifdef CONFIG_ARCH_OMAP16XX
+	case METHOD_GPIO_1610:
+		in = bank->base + OMAP1610_GPIO_DATAIN;
+		out = bank->base + OMAP1610_GPIO_DATAOUT;
+		break;
+#endif
+#if defined(CONFIG_ARCH_OMAP730) || defined(CONFIG_ARCH_OMAP850)
+	case METHOD_GPIO_7XX:
+		in = bank->base + OMAP7XX_GPIO_DATA_INPUT;
+		out = bank->base + OMAP7XX_GPIO_DATA_OUTPUT;
+		break;
+#endif
+#if defined(CONFIG_ARCH_OMAP24XX) || defined(CONFIG_ARCH_OMAP34XX)
+	case METHOD_GPIO_24XX:
+		in = bank->base + OMAP24XX_GPIO_DATAIN;
+		out = bank->base + OMAP24XX_GPIO_DATAOUT;
+		break;
+#endif
+#ifdef CONFIG_ARCH_OMAP4
+	case METHOD_GPIO_24XX:
+		in = bank->base + OMAP4_GPIO_DATAIN;
+		out = bank->base + OMAP4_GPIO_DATAOUT;
+		break;
+#endif
+	default:
+		return -EINVAL;
+	}
+
+	dir = gpio_is_input(bank, mask);
+	if (dir)
+		l |= __raw_readl(in) & dir;
+	if (dir != mask)
+		l |= __raw_readl(out) & mask & ~dir;
+
+	*value = l;
+	return 0;
+}
+EXPORT_SYMBOL(omap_gpio_bank_get);
+
+/**
+ * omap_gpio_bank_set - drive several output lines of a GPIO bank at once
+ * @gpio: any GPIO of the bank
+ * @mask: lines to drive
+ * @value: levels for them
+ *
+ * Banks with set/clear data registers are updated without a
+ * read-modify-write, so lines driven from elsewhere are not disturbed.
+ */
+int omap_gpio_bank_set(int gpio, u32 mask, u32 value)
+{
+	struct gpio_bank *bank;
+	void __iomem *reg;
+	unsigned long flags;
+	u32 l;
+
+	if (check_gpio(gpio) < 0)
+		return -EINVAL;
+	bank = get_gpio_bank(gpio);
+	reg = bank->base;
+
+	switch (bank->method) {
+#ifdef CONFIG_ARCH_OMAP16XX
+	case METHOD_GPIO_1610:
+		if (value & mask)
+			__raw_writel(value & mask,
+				     reg + OMAP1610_GPIO_SET_DATAOUT);
+		if (~value & mask)
+			__raw_writel(~value & mask,
+				     reg + OMAP1610_GPIO_CLEAR_DATAOUT);
+		return 0;
+#endif
+#if defined(CONFIG_ARCH_OMAP24XX) || defined(CONFIG_ARCH_OMAP34XX)
+	case METHOD_GPIO_24XX:
+		if (value & mask)
+			__raw_writel(value & mask,
+				     reg + OMAP24XX_GPIO_SETDATAOUT);
+		if (~value & mask)
+			__raw_writel(~value & mask,
+				     reg + OMAP24XX_GPIO_CLEARDATAOUT);
+		return 0;
+#endif
+#ifdef CONFIG_ARCH_OMAP4
+	case METHOD_GPIO_24XX:
+		if (value & mask)
+			__raw_writel(value & mask,
+				     reg + OMAP4_GPIO_SETDATAOUT);
+		if (~value & mask)
+			__raw_writel(~value & mask,
+				     reg + OMAP4_GPIO_CLEARDATAOUT);
+		return 0;
+#endif
+#ifdef CONFIG_ARCH_OMAP1
+	case METHOD_MPUIO:
+		reg += OMAP_MPUIO_OUTPUT;
+		break;
+#endif
+#ifdef CONFIG_ARCH_OMAP15XX
+	case METHOD_GPIO_1510:
+		reg += OMAP1510_GPIO_DATA_OUTPUT;
+		break;
+#endif
+#if defined(CONFIG_ARCH_OMAP730) || defined(CONFIG_ARCH_OMAP850)
+	case METHOD_GPIO_7XX:
+		reg += OMAP7XX_GPIO_DATA_OUTPUT;
+		break;
+#endif
+	default:
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&bank->lock, flags);
+	l = __raw_readl(reg);
+	l = (l & ~mask) | (value & mask);
+	__raw_writel(l, reg);
+	spin_unlock_irqrestore(&bank->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(omap_gpio_bank_set);
+
 /*---------------------------------------------------------------------*/
 
 static int initialized;
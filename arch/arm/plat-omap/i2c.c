@@ -28,6 +28,7 @@
 #include <linux/i2c.h>
 #include <mach/irqs.h>
 #include <plat/mux.h>
+#include <plat/dma.h>
 
 #define OMAP_I2C_SIZE		0x3f
 #define OMAP1_I2C_BASE		0xfffb3800
@@ -37,7 +38,8 @@
 
 static const char name[] = "i2c_omap";
 
-#define I2C_RESOURCE_BUILDER(base, irq)			\
+/* DMA requests are rx then tx; 0 (OMAP_DMA_NO_DEVICE) if there are none */
+#define I2C_RESOURCE_BUILDER(base, irq, dma_rx, dma_tx)	\
 	{						\
 		.start	= (base),			\
 		.end	= (base) + OMAP_I2C_SIZE,	\
@@ -46,15 +48,25 @@ static const char name[] = "i2c_omap";
 	{						\
 		.start	= (irq),			\
 		.flags	= IORESOURCE_IRQ,		\
+	},						\
+	{						\
+		.start	= (dma_rx),			\
+		.flags	= IORESOURCE_DMA,		\
+	},						\
+	{						\
+		.start	= (dma_tx),			\
+		.flags	= IORESOURCE_DMA,		\
 	},
 
-static struct resource i2c_resources[][2] = {
-	{ I2C_RESOURCE_BUILDER(0, 0) },
+static struct resource i2c_resources[][4] = {
+	{ I2C_RESOURCE_BUILDER(0, 0, 0, 0) },
 #if	defined(CONFIG_ARCH_OMAP24XX) || defined(CONFIG_ARCH_OMAP34XX)
-	{ I2C_RESOURCE_BUILDER(OMAP2_I2C_BASE2, INT_24XX_I2C2_IRQ) },
+	{ I2C_RESOURCE_BUILDER(OMAP2_I2C_BASE2, INT_24XX_I2C2_IRQ,
+			       OMAP24XX_DMA_I2C2_RX, OMAP24XX_DMA_I2C2_TX) },
 #endif
 #if	defined(CONFIG_ARCH_OMAP34XX)
-	{ I2C_RESOURCE_BUILDER(OMAP2_I2C_BASE3, INT_34XX_I2C3_IRQ) },
+	{ I2C_RESOURCE_BUILDER(OMAP2_I2C_BASE3, INT_34XX_I2C3_IRQ,
+			       OMAP34XX_DMA_I2C3_RX, OMAP34XX_DMA_I2C3_TX) },
 #endif
 };
 
@@ -150,6 +162,8 @@ static int __init omap_i2c_add_bus(int bus_id)
 		} else {
 			base = OMAP2_I2C_BASE1;
 			irq = INT_24XX_I2C1_IRQ;
+			res[2].start = OMAP24XX_DMA_I2C1_RX;
+			res[3].start = OMAP24XX_DMA_I2C1_TX;
 		}
 		res[0].start = base;
 		res[0].end = base + OMAP_I2C_SIZE;
@@ -78,6 +78,7 @@ struct clk {
 	struct list_head	children;
 	struct list_head	sibling;	/* node for children */
 	unsigned long		rate;
+	unsigned long		temp_rate;	/* see clk_rate_change_begin() */
 	__u32			flags;
 	void __iomem		*enable_reg;
 	unsigned long		(*recalc)(struct clk *);
@@ -86,6 +87,8 @@ struct clk {
 	void			(*init)(struct clk *);
 	__u8			enable_bit;
 	__s8			usecount;
+	u8			rate_txn;	/* see clk_rate_change_begin() */
+	u8			rate_flags;
 #if defined(CONFIG_ARCH_OMAP2) || defined(CONFIG_ARCH_OMAP3) || \
 		defined(CONFIG_ARCH_OMAP4)
 	u8			fixed_div;
@@ -108,10 +111,12 @@ struct cpufreq_frequency_table;
 
 struct clk_functions {
 	int		(*clk_enable)(struct clk *clk);
+	void		(*clk_wait_ready)(struct clk *clk);
 	void		(*clk_disable)(struct clk *clk);
 	long		(*clk_round_rate)(struct clk *clk, unsigned long rate);
 	int		(*clk_set_rate)(struct clk *clk, unsigned long rate);
 	int		(*clk_set_parent)(struct clk *clk, struct clk *parent);
+	long		(*clk_round_parent)(struct clk *clk, struct clk *parent);
 	void		(*clk_allow_idle)(struct clk *clk);
 	void		(*clk_deny_idle)(struct clk *clk);
 	void		(*clk_disable_unused)(struct clk *clk);
@@ -131,12 +136,55 @@ extern void propagate_rate(struct clk *clk);
 extern void recalculate_root_clocks(void);
 extern unsigned long followparent_recalc(struct clk *clk);
 extern void clk_enable_init_clocks(void);
+extern int clk_rate_change_begin(struct clk *clk, unsigned long rate);
+extern void clk_rate_change_finish(struct clk *clk, unsigned long old_rate,
+				   int err);
 #ifdef CONFIG_CPU_FREQ
 extern void clk_init_cpufreq_table(struct cpufreq_frequency_table **table);
 #endif
 
 extern const struct clkops clkops_null;
 
+/*
+ * Rate change notifications, sent with a struct clk_notifier_data to
+ * the notifiers registered with clk_notifier_register():
+ *
+ * CLK_PRE_RATE_CHANGE: the rate of the clock is about to change.  The
+ * notifier can adjust the hardware it drives to the new rate (e.g.
+ * pick a divider that is safe for both rates), or veto the change by
+ * returning NOTIFY_BAD or notifier_from_errno().
+ *
+ * CLK_ABORT_RATE_CHANGE: a change announced with CLK_PRE_RATE_CHANGE
+ * was vetoed or failed; the clock stays at old_rate.
+ *
+ * CLK_POST_RATE_CHANGE: the clock now runs at new_rate.
+ *
+ * Notifiers are called with the clock framework lock held and
+ * interrupts disabled, so they must not sleep or call the clk_*()
+ * functions.  Only clocks whose rate actually changes are notified.
+ */
+#define CLK_PRE_RATE_CHANGE		1
+#define CLK_ABORT_RATE_CHANGE		2
+#define CLK_POST_RATE_CHANGE		3
+
+/**
+ * struct clk_notifier_data - rate change notification
+ * @clk: struct clk * whose rate changes
+ * @old_rate: rate before the change
+ * @new_rate: rate after the change
+ */
+struct clk_notifier_data {
+	struct clk		*clk;
+	unsigned long		old_rate;
+	unsigned long		new_rate;
+};
+
+struct notifier_block;
+
+extern int clk_notifier_register(struct clk *clk, struct notifier_block *nb);
+extern int clk_notifier_unregister(struct clk *clk,
+				   struct notifier_block *nb);
+
 /* Clock flags */
 /* bit 0 is free */
 #define RATE_FIXED		(1 << 1)	/* Fixed clock rate */
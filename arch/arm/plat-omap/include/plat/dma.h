@@ -613,6 +613,9 @@ extern void omap_set_dma_dest_burst_mode(int lch,
 
 extern void omap_set_dma_params(int lch,
 				struct omap_dma_channel_params *params);
+extern void omap_set_dma_xfer(int lch, unsigned long src_start,
+			      unsigned long dst_start, int elem_count,
+			      int frame_count);
 
 extern void omap_dma_link_lch(int lch_head, int lch_queue);
 extern void omap_dma_unlink_lch(int lch_head, int lch_queue);
@@ -635,6 +638,9 @@ extern int omap_get_dma_index(int lch, int *ei, int *fi);
 
 /* Chaining APIs */
 #ifndef CONFIG_ARCH_OMAP1
+extern int omap_dma_hw_link_lch(int lch_head, int lch_queue);
+extern void omap_dma_hw_unlink_lch(int lch);
+
 extern int omap_request_dma_chain(int dev_id, const char *dev_name,
 				  void (*callback) (int lch, u16 ch_status,
 						    void *data),
@@ -672,4 +678,21 @@ extern void omap_set_lcd_dma_b1_vxres(unsigned long vxres);
 extern void omap_set_lcd_dma_b1_mirror(int mirror);
 extern void omap_set_lcd_dma_b1_scale(unsigned int xscale, unsigned int yscale);
 
+/*
+ * dmaengine slave description for drivers/dma/omap-dma.c. Pass a pointer
+ * to one of these as filter parameter to dma_request_channel() together
+ * with omap_dma_filter_fn().
+ */
+struct omap_dma_slave {
+	unsigned long	dev_addr;	/* physical address of the device FIFO */
+	int		dma_req;	/* sDMA request line, 0 for none */
+	int		data_type;	/* OMAP_DMA_DATA_TYPE_S8/S16/S32 */
+	int		sync_mode;	/* OMAP_DMA_SYNC_ELEMENT or _FRAME */
+	unsigned int	frame_len;	/* elements per frame if frame synced */
+	enum omap_dma_burst_mode burst_mode;
+};
+
+struct dma_chan;
+extern bool omap_dma_filter_fn(struct dma_chan *chan, void *param);
+
 #endif /* __ASM_ARCH_DMA_H */
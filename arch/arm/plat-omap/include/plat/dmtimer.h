@@ -29,6 +29,10 @@
 #ifndef __ASM_ARCH_DMTIMER_H
 #define __ASM_ARCH_DMTIMER_H
 
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/ktime.h>
+
 /* clock sources */
 #define OMAP_TIMER_SRC_SYS_CLK			0x00
 #define OMAP_TIMER_SRC_32_KHZ			0x01
@@ -80,5 +84,48 @@ void omap_dm_timer_write_counter(struct omap_dm_timer *timer, unsigned int value
 
 int omap_dm_timers_active(void);
 
+/*
+ * Coalesced timers: callbacks with some tolerance on when they run,
+ * batched onto the wakeups of a single dual-mode timer.
+ */
+#define OMAP_DM_CTIMER_DEFERRABLE		(1 << 0)
+
+struct omap_dm_ctimer {
+	struct list_head	entry;
+	ktime_t			expires;	/* earliest time to run */
+	ktime_t			latest;		/* latest time to run */
+	unsigned int		flags;
+	void			(*function)(unsigned long);
+	unsigned long		data;
+#ifdef CONFIG_TIMER_STATS
+	void			*start_site;
+	char			start_comm[16];
+	int			start_pid;
+#endif
+};
+
+#ifdef CONFIG_OMAP_DM_TIMER_COALESCE
+void omap_dm_ctimer_init(struct omap_dm_ctimer *t,
+			 void (*function)(unsigned long), unsigned long data,
+			 unsigned int flags);
+int omap_dm_ctimer_mod(struct omap_dm_ctimer *t, unsigned int delay_ms,
+		       unsigned int slack_ms);
+int omap_dm_ctimer_del(struct omap_dm_ctimer *t);
+void omap_dm_ctimer_run_due(void);
+int omap_dm_ctimer_get_irq(void);
+#else
+static inline void omap_dm_ctimer_init(struct omap_dm_ctimer *t,
+			void (*function)(unsigned long), unsigned long data,
+			unsigned int flags) { }
+static inline int omap_dm_ctimer_mod(struct omap_dm_ctimer *t,
+			unsigned int delay_ms, unsigned int slack_ms)
+{
+	return -ENODEV;
+}
+static inline int omap_dm_ctimer_del(struct omap_dm_ctimer *t) { return 0; }
+static inline void omap_dm_ctimer_run_due(void) { }
+static inline int omap_dm_ctimer_get_irq(void) { return -ENODEV; }
+#endif
+
 
 #endif /* __ASM_ARCH_DMTIMER_H */
@@ -0,0 +1,28 @@
+/*
+ * OMAP3 Error Location Module
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_ARCH_OMAP_ELM_H
+#define __ASM_ARM_ARCH_OMAP_ELM_H
+
+enum omap_elm_bch {
+	OMAP_ELM_BCH4 = 0,
+	OMAP_ELM_BCH8,
+};
+
+/* syndrome polynomial size in 32-bit fragments */
+#define OMAP_ELM_BCH4_FRAGS	2	/* 52 bits */
+#define OMAP_ELM_BCH8_FRAGS	4	/* 104 bits */
+
+#define OMAP_ELM_MAX_ERRORS	8
+
+extern int omap_elm_request(enum omap_elm_bch bch);
+extern void omap_elm_free(void);
+extern int omap_elm_locate(const u32 *syndrome, int nfrags, u16 *err_loc);
+
+#endif
@@ -76,6 +76,8 @@ extern void omap2_gpio_prepare_for_retention(void);
 extern void omap2_gpio_resume_after_retention(void);
 extern void omap_set_gpio_debounce(int gpio, int enable);
 extern void omap_set_gpio_debounce_time(int gpio, int enable);
+extern int omap_gpio_bank_get(int gpio, u32 mask, u32 *value);
+extern int omap_gpio_bank_set(int gpio, u32 mask, u32 value);
 
 /*-------------------------------------------------------------------------*/
 
@@ -28,6 +28,15 @@
 #define GPMC_CONFIG		0x50
 #define GPMC_STATUS		0x54
 
+/* prefetch/write-posting engine */
+#define GPMC_PREFETCH_FIFOTHRESHOLD_MAX	0x40	/* bytes, the fifo depth */
+#define GPMC_PREFETCH_STATUS_FIFO_CNT(val)	(((val) >> 24) & 0x7f)
+#define GPMC_PREFETCH_STATUS_COUNT(val)		((val) & 0x3fff)
+
+/* GPMC_IRQSTATUS/IRQENABLE events of the engine */
+#define GPMC_IRQ_FIFOEVENT	(1 << 0)	/* fifo crossed threshold */
+#define GPMC_IRQ_COUNT_EVENT	(1 << 1)	/* all bytes transferred */
+
 #define GPMC_CONFIG1_WRAPBURST_SUPP     (1 << 31)
 #define GPMC_CONFIG1_READMULTIPLE_SUPP  (1 << 30)
 #define GPMC_CONFIG1_READTYPE_ASYNC     (0 << 29)
@@ -103,10 +112,17 @@ extern int gpmc_cs_request(int cs, unsigned long size, unsigned long *base);
 extern void gpmc_cs_free(int cs);
 extern int gpmc_cs_set_reserved(int cs, int reserved);
 extern int gpmc_cs_reserved(int cs);
-extern int gpmc_prefetch_enable(int cs, int dma_mode,
+extern int gpmc_prefetch_enable(int cs, int fifo_th, int dma_mode,
 					unsigned int u32_count, int is_write);
 extern void gpmc_prefetch_reset(void);
 extern int gpmc_prefetch_status(void);
+extern int gpmc_prefetch_irq_request(void (*handler)(u32 events, void *data),
+				     void *data);
+extern void gpmc_prefetch_irq_free(void *data);
+extern void gpmc_prefetch_irq_enable(u32 events);
+extern void gpmc_prefetch_irq_disable(u32 events);
+extern int gpmc_enable_hwecc_bch(int cs, int dev_width, int nerrors);
+extern int gpmc_calculate_ecc_bch(int nerrors, u8 *ecc);
 extern void __init gpmc_init(void);
 
 #endif
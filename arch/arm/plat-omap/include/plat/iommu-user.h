@@ -0,0 +1,41 @@
+/*
+ * omap iommu: user buffer mapping interface
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __IOMMU_USER_H
+#define __IOMMU_USER_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* values of 'iommu_umap_req.dir', same as enum dma_data_direction */
+#define IOMMU_UMAP_BIDIRECTIONAL	0
+#define IOMMU_UMAP_TO_DEVICE		1
+#define IOMMU_UMAP_FROM_DEVICE		2
+
+struct iommu_umap_req {
+	__u32	uaddr;	/* page aligned user buffer */
+	__u32	size;
+	__u32	dir;	/* IOMMU_UMAP_* */
+	__u32	flags;	/* IOVMF_* h/w attributes, see plat/iovmm.h */
+	__u32	da;	/* in: fixed device address or 0, out: mapped at */
+};
+
+struct iommu_usync_req {
+	__u32	da;
+	__u32	for_device;	/* 1: cpu -> device, 0: device -> cpu */
+};
+
+#define IOMMU_IOC_MAGIC		0xCC
+
+#define IOMMU_IOC_UMAP		_IOWR(IOMMU_IOC_MAGIC, 0, struct iommu_umap_req)
+#define IOMMU_IOC_UUNMAP	_IOW(IOMMU_IOC_MAGIC, 1, __u32)
+#define IOMMU_IOC_USYNC		_IOW(IOMMU_IOC_MAGIC, 2, struct iommu_usync_req)
+
+#endif /* __IOMMU_USER_H */
@@ -150,6 +150,11 @@ extern void flush_iotlb_all(struct iommu *obj);
 extern int iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e);
 extern size_t iopgtable_clear_entry(struct iommu *obj, u32 iova);
 
+extern int __iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e);
+extern size_t __iopgtable_clear_entry(struct iommu *obj, u32 iova);
+extern void iopgtable_commit_store(struct iommu *obj, u32 start, u32 end);
+extern void iopgtable_commit_clear(struct iommu *obj, u32 start, u32 end);
+
 extern struct iommu *iommu_get(const char *name);
 extern void iommu_put(struct iommu *obj);
 
@@ -13,6 +13,8 @@
 #ifndef __IOMMU_MMAP_H
 #define __IOMMU_MMAP_H
 
+#include <linux/dma-mapping.h>
+
 struct iovm_struct {
 	struct iommu		*iommu;	/* iommu object which this belongs to */
 	u32			da_start; /* area definition */
@@ -21,6 +23,10 @@ struct iovm_struct {
 	struct list_head	list; /* linked in ascending order */
 	const struct sg_table	*sgt; /* keep 'page' <-> 'da' mapping */
 	void			*va; /* mpu side mapped address */
+	enum dma_data_direction	dma_dir; /* IOVMF_USER: for cache sync */
+
+	/* iommu pages mapping this area, indexed by MMU_CAM_PGSZ_* */
+	unsigned int		nr_pages[MMU_CAM_PGSZ_MASK + 1];
 };
 
 /*
@@ -74,6 +80,9 @@ struct iovm_struct {
 #define IOVMF_DA_ANON		(2 << (4 + IOVMF_SW_SHIFT))
 #define IOVMF_DA_MASK		(3 << (4 + IOVMF_SW_SHIFT))
 
+/* pinned pages of a user buffer, see iommu_umap() */
+#define IOVMF_USER		(1 << (6 + IOVMF_SW_SHIFT))
+
 
 extern struct iovm_struct *find_iovm_area(struct iommu *obj, u32 da);
 extern u32 iommu_vmap(struct iommu *obj, u32 da,
@@ -88,6 +97,10 @@ extern void iommu_kunmap(struct iommu *obj, u32 da);
 extern u32 iommu_kmalloc(struct iommu *obj, u32 da, size_t bytes,
 			   u32 flags);
 extern void iommu_kfree(struct iommu *obj, u32 da);
+extern u32 iommu_umap(struct iommu *obj, u32 da, unsigned long uaddr,
+		      size_t bytes, enum dma_data_direction dir, u32 flags);
+extern void iommu_uunmap(struct iommu *obj, u32 da);
+extern int iommu_usync(struct iommu *obj, u32 da, int for_device);
 
 extern void *da_to_va(struct iommu *obj, u32 da);
 
@@ -5,7 +5,9 @@
 
 #include <linux/wait.h>
 #include <linux/workqueue.h>
-#include <linux/blkdev.h>
+#include <linux/interrupt.h>
+#include <linux/kfifo.h>
+#include <linux/device.h>
 
 typedef u32 mbox_msg_t;
 typedef void (mbox_receiver_t)(mbox_msg_t msg);
@@ -38,12 +40,30 @@ struct omap_mbox_ops {
 	void		(*restore_ctx)(struct omap_mbox *mbox);
 };
 
+struct omap_msg_tx_data {
+	mbox_msg_t	msg;
+	void		*arg;
+};
+
+/*
+ * The rx callback is called from a tasklet, once per message; the tx
+ * callback, if any, before a message with an 'arg' goes out. Neither
+ * may sleep.
+ */
 struct omap_mbox_queue {
 	spinlock_t		lock;
-	struct request_queue	*queue;
+	struct kfifo		*fifo;
+	struct tasklet_struct	tasklet;
 	struct work_struct	work;
 	int	(*callback)(void *);
 	struct omap_mbox	*mbox;
+
+	/* tx: message taken off the fifo, but not sent yet */
+	struct omap_msg_tx_data	tx_data;
+	int			tx_pending;
+
+	/* rx: irq disabled until the fifo has room again */
+	int			rx_stalled;
 };
 
 struct omap_mbox {
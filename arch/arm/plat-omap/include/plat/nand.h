@@ -10,6 +10,12 @@
 
 #include <linux/mtd/partitions.h>
 
+enum omap_ecc {
+	OMAP_ECC_HAMMING_CODE_DEFAULT = 0,	/* 1-bit, or software ecc */
+	OMAP_ECC_BCH4_CODE_HW,			/* 4-bit BCH, ELM corrected */
+	OMAP_ECC_BCH8_CODE_HW,			/* 8-bit BCH, ELM corrected */
+};
+
 struct omap_nand_platform_data {
 	unsigned int		options;
 	int			cs;
@@ -21,4 +27,5 @@ struct omap_nand_platform_data {
 	int			dma_channel;
 	void __iomem		*gpmc_cs_baseaddr;
 	void __iomem		*gpmc_baseaddr;
+	enum omap_ecc		ecc_opt;
 };
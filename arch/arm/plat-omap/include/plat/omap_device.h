@@ -42,6 +42,13 @@
 #define OMAP_DEVICE_STATE_IDLE		2
 #define OMAP_DEVICE_STATE_SHUTDOWN	3
 
+/*
+ * Runtime PM only idles a device once it has been unused for this many
+ * times the cost of idling and re-enabling it (see
+ * omap_device_get_idle_delay())
+ */
+#define OMAP_DEVICE_IDLE_BREAKEVEN	10
+
 /**
  * struct omap_device - omap_device wrapper for platform_devices
  * @pdev: platform_device
@@ -73,6 +80,17 @@ struct omap_device {
 	u8				_state;
 };
 
+#define to_omap_device(x) container_of((x), struct omap_device, pdev)
+
+/*
+ * The omap_device of a registered platform_device, or NULL if it is a
+ * plain platform_device; unlike to_omap_device() this is safe on both.
+ */
+static inline struct omap_device *omap_device_of(struct platform_device *pdev)
+{
+	return pdev->archdata.od;
+}
+
 /* Device driver interface (call via platform_data fn ptrs) */
 
 int omap_device_enable(struct platform_device *pdev);
@@ -102,6 +120,7 @@ int omap_device_register(struct omap_device *od);
 int omap_device_align_pm_lat(struct platform_device *pdev,
 			     u32 new_wakeup_lat_limit);
 struct powerdomain *omap_device_get_pwrdm(struct omap_device *od);
+unsigned int omap_device_get_idle_delay(struct omap_device *od);
 
 /* Other */
 
@@ -0,0 +1,52 @@
+/*
+ * OMAP operating performance point (OPP) tables
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_ARCH_OMAP_OPP_H
+#define __ASM_ARM_ARCH_OMAP_OPP_H
+
+#include <linux/types.h>
+
+struct cpufreq_frequency_table;
+
+/**
+ * struct omap_opp - clock frequency-to-OPP ID table for DSP, MPU, L3
+ * @enabled: OPP may be selected; see opp_enable() and opp_disable()
+ * @rate: target clock rate
+ * @opp_id: OPP ID
+ * @min_vdd: minimum voltage (in millivolts) of the voltage domain
+ *	     feeding the clock (VDD1 for MPU and DSP, VDD2 for L3)
+ *
+ * Operating performance point data.  Can vary by OMAP chip and board.
+ * Tables are sorted by ascending rate; the final item in the array
+ * should have .rate = .opp_id = 0.
+ */
+struct omap_opp {
+	bool enabled;
+	unsigned long rate;
+	u8 opp_id;
+	u16 min_vdd;
+};
+
+extern int opp_get_opp_count(const struct omap_opp *oppl);
+
+extern struct omap_opp *opp_find_rate_exact(struct omap_opp *oppl,
+					    unsigned long rate, bool enabled);
+extern struct omap_opp *opp_find_rate_floor(struct omap_opp *oppl,
+					    unsigned long *rate);
+extern struct omap_opp *opp_find_rate_ceil(struct omap_opp *oppl,
+					   unsigned long *rate);
+extern struct omap_opp *opp_find_id(struct omap_opp *oppl, u8 opp_id);
+
+extern int opp_enable(struct omap_opp *opp);
+extern int opp_disable(struct omap_opp *opp);
+
+extern void opp_init_cpufreq_table(struct omap_opp *oppl,
+				   struct cpufreq_frequency_table **table);
+
+#endif
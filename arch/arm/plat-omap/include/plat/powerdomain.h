@@ -57,6 +57,13 @@
 /* XXX A completely arbitrary number. What is reasonable here? */
 #define PWRDM_TRANSITION_BAILOUT 100000
 
+/*
+ * PM debug histogram buckets: the first one counts samples below 32 us
+ * (one tick of the 32 KiHz sync timer), bucket n those in
+ * [2^(n+4), 2^(n+5)) us, the last one everything longer.
+ */
+#define PWRDM_HIST_BUCKETS	20
+
 struct clockdomain;
 struct powerdomain;
 
@@ -119,10 +126,14 @@ struct powerdomain {
 
 	int state;
 	unsigned state_counter[4];
+	unsigned ret_logic_off_counter;
 
 #ifdef CONFIG_PM_DEBUG
 	s64 timer;
 	s64 state_timer[4];
+	s64 res_timer;
+	u32 residency_hist[4][PWRDM_HIST_BUCKETS];
+	u32 latency_hist[2][PWRDM_HIST_BUCKETS];	/* entry, exit */
 #endif
 };
 
@@ -178,5 +189,6 @@ int pwrdm_state_switch(struct powerdomain *pwrdm);
 int pwrdm_clkdm_state_switch(struct clockdomain *clkdm);
 int pwrdm_pre_transition(void);
 int pwrdm_post_transition(void);
+int pwrdm_get_context_loss_count(struct powerdomain *pwrdm);
 
 #endif
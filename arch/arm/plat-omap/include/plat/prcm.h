@@ -26,6 +26,9 @@
 u32 omap_prcm_get_reset_sources(void);
 void omap_prcm_arch_reset(char mode);
 int omap2_cm_wait_idlest(void __iomem *reg, u32 mask, const char *name);
+u32 prcm_shadow_read(void __iomem *reg);
+void prcm_shadow_write(u32 val, void __iomem *reg);
+void prcm_shadow_invalidate(void);
 
 #endif
 
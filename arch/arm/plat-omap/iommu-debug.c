@@ -249,6 +249,88 @@ static ssize_t debug_read_mmap(struct file *file, char __user *userbuf,
 	return bytes;
 }
 
+/*
+ * The MMU walks the page table on a TLB miss without telling anybody,
+ * so misses can't be counted. What is shown is the steady state of a
+ * device sweeping each area over and over: once an area needs more
+ * TLB entries than the MMU has, every entry is refetched per sweep,
+ * given as table walks per 1000 4KB pages accessed. The last line is
+ * the same for all areas being accessed together.
+ */
+static int tlb_walk_rate(struct iommu *obj, size_t bytes,
+			 unsigned int nr_entries)
+{
+	if (!bytes || nr_entries <= obj->nr_tlb_entries)
+		return 0;
+
+	return DIV_ROUND_UP(nr_entries * 1000, bytes >> PAGE_SHIFT);
+}
+
+static ssize_t debug_read_pgsize(struct file *file, char __user *userbuf,
+				 size_t count, loff_t *ppos)
+{
+	struct iommu *obj = file->private_data;
+	char *p, *buf;
+	struct iovm_struct *tmp;
+	unsigned int total[MMU_CAM_PGSZ_MASK + 1] = { 0, };
+	size_t total_bytes = 0;
+	unsigned int total_nr = 0;
+	int i = 0;
+	ssize_t bytes;
+	const char *str = "%3d %08x %8x %5u %5u %5u %5u %5u %7d\n";
+	const int maxcol = 61;
+
+	buf = (char *)__get_free_page(GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	p = buf;
+
+	p += sprintf(p, "%-3s %-8s %8s %5s %5s %5s %5s %5s %7s\n",
+		     "No", "start", "size", "16M", "1M", "64K", "4K",
+		     "tlb", "walk/1k");
+	p += sprintf(p, "------------------------------------"
+		     "-------------------------\n");
+
+	mutex_lock(&iommu_debug_lock);
+	mutex_lock(&obj->mmap_lock);
+
+	list_for_each_entry(tmp, &obj->mmap, list) {
+		size_t len = tmp->da_end - tmp->da_start;
+		unsigned int *n = tmp->nr_pages;
+		unsigned int nr = n[MMU_CAM_PGSZ_16M] + n[MMU_CAM_PGSZ_1M] +
+			n[MMU_CAM_PGSZ_64K] + n[MMU_CAM_PGSZ_4K];
+		int j;
+
+		if (PAGE_SIZE - (p - buf) < 2 * maxcol)
+			break;
+
+		p += snprintf(p, maxcol, str, i++, tmp->da_start, len,
+			      n[MMU_CAM_PGSZ_16M], n[MMU_CAM_PGSZ_1M],
+			      n[MMU_CAM_PGSZ_64K], n[MMU_CAM_PGSZ_4K],
+			      nr, tlb_walk_rate(obj, len, nr));
+
+		for (j = 0; j < ARRAY_SIZE(total); j++)
+			total[j] += n[j];
+		total_nr += nr;
+		total_bytes += len;
+	}
+
+	mutex_unlock(&obj->mmap_lock);
+
+	p += snprintf(p, maxcol, "%-3s %8s %8x %5u %5u %5u %5u %5u %7d\n",
+		      "all", "", total_bytes,
+		      total[MMU_CAM_PGSZ_16M], total[MMU_CAM_PGSZ_1M],
+		      total[MMU_CAM_PGSZ_64K], total[MMU_CAM_PGSZ_4K],
+		      total_nr, tlb_walk_rate(obj, total_bytes, total_nr));
+
+	bytes = simple_read_from_buffer(userbuf, count, ppos, buf, p - buf);
+
+	mutex_unlock(&iommu_debug_lock);
+	free_page((unsigned long)buf);
+
+	return bytes;
+}
+
 static ssize_t debug_read_mem(struct file *file, char __user *userbuf,
 			      size_t count, loff_t *ppos)
 {
@@ -340,6 +422,7 @@ DEBUG_FOPS_RO(regs);
 DEBUG_FOPS_RO(tlb);
 DEBUG_FOPS(pagetable);
 DEBUG_FOPS_RO(mmap);
+DEBUG_FOPS_RO(pgsize);
 DEBUG_FOPS(mem);
 
 #define __DEBUG_ADD_FILE(attr, mode)					\
@@ -378,6 +461,7 @@ static int iommu_debug_register(struct device *dev, void *data)
 	DEBUG_ADD_FILE_RO(tlb);
 	DEBUG_ADD_FILE(pagetable);
 	DEBUG_ADD_FILE_RO(mmap);
+	DEBUG_ADD_FILE_RO(pgsize);
 	DEBUG_ADD_FILE(mem);
 
 	return 0;
@@ -0,0 +1,272 @@
+/*
+ * omap iommu: user buffer mapping interface
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Every iommu gets a misc device, /dev/iommu-<name>. Opening it powers
+ * the iommu up; IOMMU_IOC_UMAP then maps a buffer of the calling
+ * process into the device address space in place with 'iommu_umap()',
+ * so that e.g. a camera or DSP pipeline can hand frames between user
+ * space and the device without copying them. Mappings still around
+ * when the file is closed are released.
+ */
+
+#include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/uaccess.h>
+#include <linux/platform_device.h>
+
+#include <plat/iommu.h>
+#include <plat/iovmm.h>
+#include <plat/iommu-user.h>
+
+struct iommu_user {
+	struct miscdevice	misc;
+	char			name[32];
+	const char		*iommu_name;
+	struct list_head	list;
+};
+
+/* per open file */
+struct iommu_user_ctx {
+	struct iommu		*obj;
+	struct mutex		lock; /* protect maps */
+	struct list_head	maps;
+};
+
+struct iommu_user_map {
+	struct list_head	list;
+	u32			da;
+};
+
+static LIST_HEAD(iommu_user_list);
+
+static struct iommu_user *iommu_user_find(int minor)
+{
+	struct iommu_user *iu;
+
+	list_for_each_entry(iu, &iommu_user_list, list)
+		if (iu->misc.minor == minor)
+			return iu;
+
+	return NULL;
+}
+
+static struct iommu_user_map *iommu_user_find_map(struct iommu_user_ctx *ctx,
+						  u32 da)
+{
+	struct iommu_user_map *map;
+
+	list_for_each_entry(map, &ctx->maps, list)
+		if (map->da == da)
+			return map;
+
+	return NULL;
+}
+
+static int iommu_user_umap(struct iommu_user_ctx *ctx, void __user *arg)
+{
+	struct iommu_umap_req req;
+	struct iommu_user_map *map;
+	u32 da;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	map = kmalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	da = iommu_umap(ctx->obj, req.da, req.uaddr, req.size, req.dir,
+			req.flags);
+	if (IS_ERR_VALUE(da)) {
+		kfree(map);
+		return (int)da;
+	}
+
+	req.da = da;
+	if (copy_to_user(arg, &req, sizeof(req))) {
+		iommu_uunmap(ctx->obj, da);
+		kfree(map);
+		return -EFAULT;
+	}
+
+	map->da = da;
+	mutex_lock(&ctx->lock);
+	list_add_tail(&map->list, &ctx->maps);
+	mutex_unlock(&ctx->lock);
+
+	return 0;
+}
+
+static int iommu_user_uunmap(struct iommu_user_ctx *ctx, u32 da)
+{
+	struct iommu_user_map *map;
+
+	mutex_lock(&ctx->lock);
+	map = iommu_user_find_map(ctx, da);
+	if (map)
+		list_del(&map->list);
+	mutex_unlock(&ctx->lock);
+
+	if (!map)
+		return -EINVAL;
+
+	iommu_uunmap(ctx->obj, da);
+	kfree(map);
+
+	return 0;
+}
+
+static int iommu_user_usync(struct iommu_user_ctx *ctx, void __user *arg)
+{
+	struct iommu_usync_req req;
+	int err = -EINVAL;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	mutex_lock(&ctx->lock);
+	if (iommu_user_find_map(ctx, req.da))
+		err = iommu_usync(ctx->obj, req.da, req.for_device);
+	mutex_unlock(&ctx->lock);
+
+	return err;
+}
+
+static long iommu_user_ioctl(struct file *file, unsigned int cmd,
+			     unsigned long arg)
+{
+	struct iommu_user_ctx *ctx = file->private_data;
+
+	switch (cmd) {
+	case IOMMU_IOC_UMAP:
+		return iommu_user_umap(ctx, (void __user *)arg);
+	case IOMMU_IOC_UUNMAP:
+		return iommu_user_uunmap(ctx, (u32)arg);
+	case IOMMU_IOC_USYNC:
+		return iommu_user_usync(ctx, (void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static int iommu_user_open(struct inode *inode, struct file *file)
+{
+	struct iommu_user *iu;
+	struct iommu_user_ctx *ctx;
+	struct iommu *obj;
+
+	iu = iommu_user_find(iminor(inode));
+	if (!iu)
+		return -ENODEV;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	obj = iommu_get(iu->iommu_name);
+	if (IS_ERR(obj)) {
+		kfree(ctx);
+		return PTR_ERR(obj);
+	}
+
+	ctx->obj = obj;
+	mutex_init(&ctx->lock);
+	INIT_LIST_HEAD(&ctx->maps);
+	file->private_data = ctx;
+
+	return 0;
+}
+
+static int iommu_user_release(struct inode *inode, struct file *file)
+{
+	struct iommu_user_ctx *ctx = file->private_data;
+	struct iommu_user_map *map, *tmp;
+
+	list_for_each_entry_safe(map, tmp, &ctx->maps, list) {
+		list_del(&map->list);
+		iommu_uunmap(ctx->obj, map->da);
+		kfree(map);
+	}
+
+	iommu_put(ctx->obj);
+	kfree(ctx);
+
+	return 0;
+}
+
+static const struct file_operations iommu_user_fops = {
+	.owner		= THIS_MODULE,
+	.open		= iommu_user_open,
+	.release	= iommu_user_release,
+	.unlocked_ioctl	= iommu_user_ioctl,
+};
+
+static int iommu_user_register(struct device *dev, void *data)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+	struct iommu *obj = platform_get_drvdata(pdev);
+	struct iommu_user *iu;
+	int err;
+
+	if (!obj || !obj->dev)
+		return -EINVAL;
+
+	iu = kzalloc(sizeof(*iu), GFP_KERNEL);
+	if (!iu)
+		return -ENOMEM;
+
+	snprintf(iu->name, sizeof(iu->name), "iommu-%s", obj->name);
+	iu->iommu_name = obj->name;
+	iu->misc.minor = MISC_DYNAMIC_MINOR;
+	iu->misc.name = iu->name;
+	iu->misc.fops = &iommu_user_fops;
+
+	err = misc_register(&iu->misc);
+	if (err) {
+		kfree(iu);
+		return err;
+	}
+	list_add_tail(&iu->list, &iommu_user_list);
+
+	return 0;
+}
+
+static void iommu_user_unregister_all(void)
+{
+	struct iommu_user *iu, *tmp;
+
+	list_for_each_entry_safe(iu, tmp, &iommu_user_list, list) {
+		list_del(&iu->list);
+		misc_deregister(&iu->misc);
+		kfree(iu);
+	}
+}
+
+static int __init iommu_user_init(void)
+{
+	int err;
+
+	err = foreach_iommu_device(NULL, iommu_user_register);
+	if (err)
+		iommu_user_unregister_all();
+
+	return err;
+}
+module_init(iommu_user_init)
+
+static void __exit iommu_user_exit(void)
+{
+	iommu_user_unregister_all();
+}
+module_exit(iommu_user_exit)
+
+MODULE_DESCRIPTION("omap iommu: user buffer mapping interface");
+MODULE_LICENSE("GPL v2");
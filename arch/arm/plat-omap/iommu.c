@@ -266,23 +266,16 @@ out:
 }
 EXPORT_SYMBOL_GPL(load_iotlb_entry);
 
-/**
- * flush_iotlb_page - Clear an iommu tlb entry
- * @obj:	target iommu
- * @da:		iommu device virtual address
- *
- * Clear an iommu tlb entry which includes 'da' address.
- **/
-void flush_iotlb_page(struct iommu *obj, u32 da)
+static void __flush_iotlb_range(struct iommu *obj, u32 start, u32 end)
 {
 	struct iotlb_lock l;
-	int i;
+	int i, n = 0;
 
 	clk_enable(obj->clk);
 
 	for (i = 0; i < obj->nr_tlb_entries; i++) {
 		struct cr_regs cr;
-		u32 start;
+		u32 da;
 		size_t bytes;
 
 		iotlb_lock_get(obj, &l);
@@ -292,20 +285,34 @@ void flush_iotlb_page(struct iommu *obj, u32 da)
 		if (!iotlb_cr_valid(&cr))
 			continue;
 
-		start = iotlb_cr_to_virt(&cr);
+		da = iotlb_cr_to_virt(&cr);
 		bytes = iopgsz_to_bytes(cr.cam & 3);
 
-		if ((start <= da) && (da < start + bytes)) {
-			dev_dbg(obj->dev, "%s: %08x<=%08x(%x)\n",
-				__func__, start, da, bytes);
+		if ((da < end) && (start < da + bytes)) {
+			dev_dbg(obj->dev, "%s: %08x-%08x(%x) in %08x-%08x\n",
+				__func__, da, da + bytes, bytes, start, end);
 			iotlb_load_cr(obj, &cr);
 			iommu_write_reg(obj, 1, MMU_FLUSH_ENTRY);
+			n++;
 		}
 	}
 	clk_disable(obj->clk);
 
-	if (i == obj->nr_tlb_entries)
-		dev_dbg(obj->dev, "%s: no page for %08x\n", __func__, da);
+	if (!n)
+		dev_dbg(obj->dev, "%s: no page in %08x-%08x\n", __func__,
+			start, end);
+}
+
+/**
+ * flush_iotlb_page - Clear an iommu tlb entry
+ * @obj:	target iommu
+ * @da:		iommu device virtual address
+ *
+ * Clear an iommu tlb entry which includes 'da' address.
+ **/
+void flush_iotlb_page(struct iommu *obj, u32 da)
+{
+	__flush_iotlb_range(obj, da, da + 1);
 }
 EXPORT_SYMBOL_GPL(flush_iotlb_page);
 
@@ -315,17 +322,12 @@ EXPORT_SYMBOL_GPL(flush_iotlb_page);
  * @start:	iommu device virtual address(start)
  * @end:	iommu device virtual address(end)
  *
- * Clear an iommu tlb entry which includes 'da' address.
+ * Clear all iommu tlb entries overlapping 'start' to 'end', with a
+ * single pass over the tlb whatever the size of the range.
  **/
 void flush_iotlb_range(struct iommu *obj, u32 start, u32 end)
 {
-	u32 da = start;
-
-	while (da < end) {
-		flush_iotlb_page(obj, da);
-		/* FIXME: Optimize for multiple page size */
-		da += IOPTE_SIZE;
-	}
+	__flush_iotlb_range(obj, start, end);
 }
 EXPORT_SYMBOL_GPL(flush_iotlb_range);
 
@@ -422,6 +424,9 @@ size_t dump_tlb_entries(struct iommu *obj, char *buf, ssize_t bytes)
 }
 EXPORT_SYMBOL_GPL(dump_tlb_entries);
 
+#endif /* CONFIG_OMAP_IOMMU_DEBUG_MODULE */
+
+/* Used by the debugfs and user space interfaces to find the iommus */
 int foreach_iommu_device(void *data, int (*fn)(struct device *, void *))
 {
 	return driver_for_each_device(&omap_iommu_driver.driver,
@@ -429,13 +434,13 @@ int foreach_iommu_device(void *data, int (*fn)(struct device *, void *))
 }
 EXPORT_SYMBOL_GPL(foreach_iommu_device);
 
-#endif /* CONFIG_OMAP_IOMMU_DEBUG_MODULE */
-
 /*
  *	H/W pagetable operations
  */
 static void flush_iopgd_range(u32 *first, u32 *last)
 {
+	first = (u32 *)((u32)first & ~(L1_CACHE_BYTES - 1));
+
 	/* FIXME: L2 cache should be taken care of if it exists */
 	do {
 		asm("mcr	p15, 0, %0, c7, c10, 1 @ flush_pgd"
@@ -446,6 +451,8 @@ static void flush_iopgd_range(u32 *first, u32 *last)
 
 static void flush_iopte_range(u32 *first, u32 *last)
 {
+	first = (u32 *)((u32)first & ~(L1_CACHE_BYTES - 1));
+
 	/* FIXME: L2 cache should be taken care of if it exists */
 	do {
 		asm("mcr	p15, 0, %0, c7, c10, 1 @ flush_pte"
@@ -480,7 +487,6 @@ static u32 *iopte_alloc(struct iommu *obj, u32 *iopgd, u32 da)
 			return ERR_PTR(-ENOMEM);
 
 		*iopgd = virt_to_phys(iopte) | IOPGD_TABLE;
-		flush_iopgd_range(iopgd, iopgd);
 
 		dev_vdbg(obj->dev, "%s: a new pte:%p\n", __func__, iopte);
 	} else {
@@ -503,7 +509,6 @@ static int iopgd_alloc_section(struct iommu *obj, u32 da, u32 pa, u32 prot)
 	u32 *iopgd = iopgd_offset(obj, da);
 
 	*iopgd = (pa & IOSECTION_MASK) | prot | IOPGD_SECTION;
-	flush_iopgd_range(iopgd, iopgd);
 	return 0;
 }
 
@@ -514,7 +519,6 @@ static int iopgd_alloc_super(struct iommu *obj, u32 da, u32 pa, u32 prot)
 
 	for (i = 0; i < 16; i++)
 		*(iopgd + i) = (pa & IOSUPER_MASK) | prot | IOPGD_SUPER;
-	flush_iopgd_range(iopgd, iopgd + 15);
 	return 0;
 }
 
@@ -527,7 +531,6 @@ static int iopte_alloc_page(struct iommu *obj, u32 da, u32 pa, u32 prot)
 		return PTR_ERR(iopte);
 
 	*iopte = (pa & IOPAGE_MASK) | prot | IOPTE_SMALL;
-	flush_iopte_range(iopte, iopte);
 
 	dev_vdbg(obj->dev, "%s: da:%08x pa:%08x pte:%p *pte:%08x\n",
 		 __func__, da, pa, iopte, *iopte);
@@ -546,11 +549,19 @@ static int iopte_alloc_large(struct iommu *obj, u32 da, u32 pa, u32 prot)
 
 	for (i = 0; i < 16; i++)
 		*(iopte + i) = (pa & IOLARGE_MASK) | prot | IOPTE_LARGE;
-	flush_iopte_range(iopte, iopte + 15);
 	return 0;
 }
 
-static int iopgtable_store_entry_core(struct iommu *obj, struct iotlb_entry *e)
+/**
+ * __iopgtable_store_entry - Make an iommu pte entry, without syncing
+ * @obj:	target iommu
+ * @e:		an iommu tlb entry info
+ *
+ * Only write the pte entry.  Once all the entries of a range have
+ * been stored, iopgtable_commit_store() must be called on it before
+ * the device uses the range.
+ **/
+int __iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e)
 {
 	int (*fn)(struct iommu *, u32, u32, u32);
 	u32 prot;
@@ -586,6 +597,7 @@ static int iopgtable_store_entry_core(struct iommu *obj, struct iotlb_entry *e)
 
 	return err;
 }
+EXPORT_SYMBOL_GPL(__iopgtable_store_entry);
 
 /**
  * iopgtable_store_entry - Make an iommu pte entry
@@ -596,13 +608,15 @@ int iopgtable_store_entry(struct iommu *obj, struct iotlb_entry *e)
 {
 	int err;
 
-	flush_iotlb_page(obj, e->da);
-	err = iopgtable_store_entry_core(obj, e);
+	err = __iopgtable_store_entry(obj, e);
+	if (err)
+		return err;
+
+	iopgtable_commit_store(obj, e->da, e->da + iopgsz_to_bytes(e->pgsz));
 #ifdef PREFETCH_IOTLB
-	if (!err)
-		load_iotlb_entry(obj, e);
+	load_iotlb_entry(obj, e);
 #endif
-	return err;
+	return 0;
 }
 EXPORT_SYMBOL_GPL(iopgtable_store_entry);
 
@@ -629,17 +643,28 @@ out:
 }
 EXPORT_SYMBOL_GPL(iopgtable_lookup_entry);
 
-static size_t iopgtable_clear_entry_core(struct iommu *obj, u32 da)
+/**
+ * __iopgtable_clear_entry - Remove an iommu pte entry, without syncing
+ * @obj:	target iommu
+ * @da:		iommu device virtual address
+ *
+ * Only clear the pte entry and return its size.  Once all the entries
+ * of a range have been cleared, iopgtable_commit_clear() must be
+ * called on it, which also frees the second level tables left empty.
+ **/
+size_t __iopgtable_clear_entry(struct iommu *obj, u32 da)
 {
-	size_t bytes;
-	u32 *iopgd = iopgd_offset(obj, da);
+	size_t bytes = 0;
+	u32 *iopgd;
 	int nent = 1;
 
+	spin_lock(&obj->page_table_lock);
+
+	iopgd = iopgd_offset(obj, da);
 	if (!*iopgd)
-		return 0;
+		goto out;
 
 	if (*iopgd & IOPGD_TABLE) {
-		int i;
 		u32 *iopte = iopte_offset(iopgd, da);
 
 		bytes = IOPTE_SIZE;
@@ -650,18 +675,6 @@ static size_t iopgtable_clear_entry_core(struct iommu *obj, u32 da)
 		}
 		bytes *= nent;
 		memset(iopte, 0, nent * sizeof(*iopte));
-		flush_iopte_range(iopte, iopte + (nent - 1) * sizeof(*iopte));
-
-		/*
-		 * do table walk to check if this table is necessary or not
-		 */
-		iopte = iopte_offset(iopgd, 0);
-		for (i = 0; i < PTRS_PER_IOPTE; i++)
-			if (iopte[i])
-				goto out;
-
-		iopte_free(iopte);
-		nent = 1; /* for the next L1 entry */
 	} else {
 		bytes = IOPGD_SIZE;
 		if ((*iopgd & IOPGD_SUPER) == IOPGD_SUPER) {
@@ -670,28 +683,118 @@ static size_t iopgtable_clear_entry_core(struct iommu *obj, u32 da)
 			iopgd = (u32 *)((u32)iopgd & IOSUPER_MASK);
 		}
 		bytes *= nent;
+		memset(iopgd, 0, nent * sizeof(*iopgd));
 	}
-	memset(iopgd, 0, nent * sizeof(*iopgd));
-	flush_iopgd_range(iopgd, iopgd + (nent - 1) * sizeof(*iopgd));
 out:
+	spin_unlock(&obj->page_table_lock);
+
 	return bytes;
 }
+EXPORT_SYMBOL_GPL(__iopgtable_clear_entry);
+
+/* Write back the pgd and pte entries covering 'start' to 'end' */
+static void iopgtable_clean_range(struct iommu *obj, u32 start, u32 end)
+{
+	u32 da = start & IOPGD_MASK;
+
+	flush_iopgd_range(iopgd_offset(obj, start), iopgd_offset(obj, end - 1));
+
+	do {
+		u32 *iopgd = iopgd_offset(obj, da);
+
+		if (*iopgd & IOPGD_TABLE)
+			flush_iopte_range(iopte_offset(iopgd, max(da, start)),
+					  iopte_offset(iopgd,
+					     min(da + IOPGD_SIZE, end) - 1));
+		da += IOPGD_SIZE;
+	} while (da && da < end);
+}
+
+/* Free the second level tables between 'start' and 'end' left empty */
+static void iopgtable_free_empty(struct iommu *obj, u32 start, u32 end)
+{
+	u32 da = start & IOPGD_MASK;
+
+	do {
+		u32 *iopgd = iopgd_offset(obj, da);
+		u32 *iopte;
+		int i;
+
+		da += IOPGD_SIZE;
+
+		if (!(*iopgd & IOPGD_TABLE))
+			continue;
+
+		iopte = iopte_offset(iopgd, 0);
+		for (i = 0; i < PTRS_PER_IOPTE; i++)
+			if (iopte[i])
+				break;
+		if (i < PTRS_PER_IOPTE)
+			continue;
+
+		*iopgd = 0;
+		flush_iopgd_range(iopgd, iopgd);
+		iopte_free(iopte);
+	} while (da && da < end);
+}
 
 /**
- * iopgtable_clear_entry - Remove an iommu pte entry
+ * iopgtable_commit_store - Make stored pte entries visible to the iommu
  * @obj:	target iommu
- * @da:		iommu device virtual address
+ * @start:	iommu device virtual address(start)
+ * @end:	iommu device virtual address(end)
+ *
+ * Write back the page table entries of 'start' to 'end' in one go.
  **/
-size_t iopgtable_clear_entry(struct iommu *obj, u32 da)
+void iopgtable_commit_store(struct iommu *obj, u32 start, u32 end)
 {
-	size_t bytes;
+	spin_lock(&obj->page_table_lock);
+
+	iopgtable_clean_range(obj, start, end);
 
+	spin_unlock(&obj->page_table_lock);
+}
+EXPORT_SYMBOL_GPL(iopgtable_commit_store);
+
+/**
+ * iopgtable_commit_clear - Make cleared pte entries visible to the iommu
+ * @obj:	target iommu
+ * @start:	iommu device virtual address(start)
+ * @end:	iommu device virtual address(end)
+ *
+ * Write back the page table entries of 'start' to 'end' in one go,
+ * invalidate the tlb entries overlapping them with a single pass over
+ * the tlb, and free the second level tables left empty.  On return the
+ * memory that was mapped there may be freed or reused.
+ **/
+void iopgtable_commit_clear(struct iommu *obj, u32 start, u32 end)
+{
 	spin_lock(&obj->page_table_lock);
 
-	bytes = iopgtable_clear_entry_core(obj, da);
-	flush_iotlb_page(obj, da);
+	iopgtable_clean_range(obj, start, end);
+	__flush_iotlb_range(obj, start, end);
+
+	/* the tables can't be reached from the page table any more */
+	iopgtable_free_empty(obj, start, end);
 
 	spin_unlock(&obj->page_table_lock);
+}
+EXPORT_SYMBOL_GPL(iopgtable_commit_clear);
+
+/**
+ * iopgtable_clear_entry - Remove an iommu pte entry
+ * @obj:	target iommu
+ * @da:		iommu device virtual address
+ **/
+size_t iopgtable_clear_entry(struct iommu *obj, u32 da)
+{
+	size_t bytes;
+
+	bytes = __iopgtable_clear_entry(obj, da);
+	if (bytes) {
+		da &= ~(bytes - 1);
+		iopgtable_commit_clear(obj, da, da + bytes);
+	}
 
 	return bytes;
 }
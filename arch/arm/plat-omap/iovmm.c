@@ -11,9 +11,14 @@
  */
 
 #include <linux/err.h>
+#include <linux/mm.h>
 #include <linux/vmalloc.h>
 #include <linux/device.h>
 #include <linux/scatterlist.h>
+#include <linux/sched.h>
+#include <linux/pagemap.h>
+#include <linux/uaccess.h>
+#include <linux/dma-mapping.h>
 
 #include <asm/cacheflush.h>
 #include <asm/mach/map.h>
@@ -30,7 +35,7 @@
  * - physical address
  * - mpu virtual address
  *
- * There are 4 possible patterns for them:
+ * There are 5 possible patterns for them:
  *
  *    |iova/			  mapping		iommu_		page
  *    | da	pa	va	(d)-(p)-(v)		function	type
@@ -38,7 +43,8 @@
  *  1 | c	c	c	 1 - 1 - 1	  _kmap() / _kunmap()	s
  *  2 | c	c,a	c	 1 - 1 - 1	_kmalloc()/ _kfree()	s
  *  3 | c	d	c	 1 - n - 1	  _vmap() / _vunmap()	s
- *  4 | c	d,a	c	 1 - n - 1	_vmalloc()/ _vfree()	n*
+ *  4 | c	d,a	c	 1 - n - 1	_vmalloc()/ _vfree()	s
+ *  5 | c	d	u	 1 - n - 1	  _umap() / _uunmap()	n
  *
  *
  *	'iova':	device iommu virtual address
@@ -49,16 +55,39 @@
  *	'c':	contiguous memory area
  *	'd':	discontiguous memory area
  *	'a':	anonymous memory allocation
+ *	'u':	user buffer, not mapped on the kernel side
  *	'()':	optional feature
  *
  *	'n':	a normal page(4KB) size is used.
  *	's':	multiple iommu superpage(16MB, 1MB, 64KB, 4KB) size is used.
  *
- *	'*':	not yet, but feasible.
+ * '_vmalloc()' builds its buffer out of physically contiguous chunks of
+ * the largest iommu page size the page allocator can provide, so that
+ * big buffers need as few TLB entries as possible.
  */
 
 static struct kmem_cache *iovm_area_cachep;
 
+static const size_t iopgsz_table[] = { SZ_16M, SZ_1M, SZ_64K, SZ_4K, };
+
+/*
+ * largest iommu page size which fits in @bytes and at which both @da
+ * and @pa are aligned
+ */
+static size_t iopgsz_fit(size_t bytes, u32 da, u32 pa)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(iopgsz_table); i++) {
+		size_t pgsz = iopgsz_table[i];
+
+		if ((bytes >= pgsz) && IS_ALIGNED(da | pa, pgsz))
+			return pgsz;
+	}
+
+	return 0;
+}
+
 /* return total bytes of sg buffers */
 static size_t sgtable_len(const struct sg_table *sgt)
 {
@@ -88,13 +117,12 @@ static size_t sgtable_len(const struct sg_table *sgt)
 
 /*
  * calculate the optimal number sg elements from total bytes based on
- * iommu superpages
+ * iommu superpages, for a linear area at @da/@pa. An anonymous @da is
+ * passed as 0 since the area is aligned to 'iopgsz_max()' later.
  */
-static unsigned int sgtable_nents(size_t bytes)
+static unsigned int sgtable_nents(size_t bytes, u32 da, u32 pa)
 {
-	int i;
 	unsigned int nr_entries;
-	const unsigned long pagesize[] = { SZ_16M, SZ_1M, SZ_64K, SZ_4K, };
 
 	if (!IS_ALIGNED(bytes, PAGE_SIZE)) {
 		pr_err("%s: wrong size %08x\n", __func__, bytes);
@@ -102,19 +130,24 @@ static unsigned int sgtable_nents(size_t bytes)
 	}
 
 	nr_entries = 0;
-	for (i = 0; i < ARRAY_SIZE(pagesize); i++) {
-		if (bytes >= pagesize[i]) {
-			nr_entries += (bytes / pagesize[i]);
-			bytes %= pagesize[i];
-		}
+	while (bytes) {
+		size_t pgsz;
+
+		pgsz = iopgsz_fit(bytes, da, pa);
+		BUG_ON(!pgsz);
+
+		nr_entries++;
+		bytes -= pgsz;
+		da += pgsz;
+		pa += pgsz;
 	}
-	BUG_ON(bytes);
 
 	return nr_entries;
 }
 
 /* allocate and initialize sg_table header(a kind of 'superblock') */
-static struct sg_table *sgtable_alloc(const size_t bytes, u32 flags)
+static struct sg_table *sgtable_alloc(const size_t bytes, u32 flags,
+				      u32 da, u32 pa)
 {
 	unsigned int nr_entries;
 	int err;
@@ -126,9 +159,8 @@ static struct sg_table *sgtable_alloc(const size_t bytes, u32 flags)
 	if (!IS_ALIGNED(bytes, PAGE_SIZE))
 		return ERR_PTR(-EINVAL);
 
-	/* FIXME: IOVMF_DA_FIXED should support 'superpages' */
-	if ((flags & IOVMF_LINEAR) && (flags & IOVMF_DA_ANON)) {
-		nr_entries = sgtable_nents(bytes);
+	if (flags & IOVMF_LINEAR) {
+		nr_entries = sgtable_nents(bytes, da, pa);
 		if (!nr_entries)
 			return ERR_PTR(-EINVAL);
 	} else
@@ -214,6 +246,125 @@ static inline void vunmap_sg(const void *va)
 	vunmap(va);
 }
 
+/*
+ * Allocate @bytes as physically contiguous chunks, each as large an
+ * iommu page as fits in what is left and matches the alignment of the
+ * device address it ends up at. An anonymous @da is passed as 0; the
+ * area is aligned to its first (largest) chunk when it is reserved.
+ * Chunk sizes the page allocator failed to provide once are not tried
+ * again, so a fragmented system degrades to 4KB pages quickly.
+ */
+static struct sg_table *sgtable_alloc_chunks(size_t bytes, u32 da)
+{
+	int i, err = -ENOMEM;
+	unsigned int nr_entries = 0;
+	unsigned long exhausted = 0;
+	size_t done = 0;
+	struct page *page, *tmp;
+	struct scatterlist *sg;
+	struct sg_table *sgt;
+	LIST_HEAD(chunks);
+
+	for (i = 0; i < ARRAY_SIZE(iopgsz_table); i++)
+		if (get_order(iopgsz_table[i]) >= MAX_ORDER)
+			exhausted |= 1 << i;
+
+	while (done < bytes) {
+		page = NULL;
+
+		for (i = 0; i < ARRAY_SIZE(iopgsz_table); i++) {
+			size_t pgsz = iopgsz_table[i];
+			unsigned int order = get_order(pgsz);
+			gfp_t gfp = GFP_KERNEL;
+
+			if ((exhausted & (1 << i)) || (bytes - done < pgsz) ||
+			    !IS_ALIGNED(da + done, pgsz))
+				continue;
+
+			if (order)
+				gfp |= __GFP_NOWARN | __GFP_NORETRY;
+
+			page = alloc_pages(gfp, order);
+			if (page) {
+				set_page_private(page, order);
+				done += pgsz;
+				break;
+			}
+			exhausted |= 1 << i;
+		}
+		if (!page)
+			goto err_alloc;
+
+		list_add_tail(&page->lru, &chunks);
+		nr_entries++;
+	}
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		goto err_alloc;
+
+	err = sg_alloc_table(sgt, nr_entries, GFP_KERNEL);
+	if (err) {
+		kfree(sgt);
+		goto err_alloc;
+	}
+
+	sg = sgt->sgl;
+	list_for_each_entry_safe(page, tmp, &chunks, lru) {
+		list_del(&page->lru);
+		sg_set_page(sg, page, PAGE_SIZE << page_private(page), 0);
+		set_page_private(page, 0);
+		sg = sg_next(sg);
+	}
+
+	pr_debug("%s: sgt:%p(%d entries)\n", __func__, sgt, nr_entries);
+
+	return sgt;
+
+err_alloc:
+	list_for_each_entry_safe(page, tmp, &chunks, lru) {
+		list_del(&page->lru);
+		__free_pages(page, page_private(page));
+	}
+	return ERR_PTR(err);
+}
+
+static void sgtable_free_chunks(struct sg_table *sgt)
+{
+	unsigned int i;
+	struct scatterlist *sg;
+
+	if (!sgt)
+		return;
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+		__free_pages(sg_page(sg), get_order(sg_dma_len(sg)));
+
+	sgtable_free(sgt);
+}
+
+/* map the chunks of 'sgt' to a contiguous mpu virtual area */
+static void *vmap_chunks(const struct sg_table *sgt, size_t bytes)
+{
+	unsigned int i, j, nr_pages = 0;
+	struct scatterlist *sg;
+	struct page **pages;
+	void *va;
+
+	pages = vmalloc(sizeof(*pages) * (bytes >> PAGE_SHIFT));
+	if (!pages)
+		return NULL;
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+		for (j = 0; j < (sg_dma_len(sg) >> PAGE_SHIFT); j++)
+			pages[nr_pages++] = nth_page(sg_page(sg), j);
+
+	va = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	vfree(pages);
+
+	return va;
+}
+
 static struct iovm_struct *__find_iovm_area(struct iommu *obj, const u32 da)
 {
 	struct iovm_struct *tmp;
@@ -258,6 +409,7 @@ EXPORT_SYMBOL_GPL(find_iovm_area);
  * in iovmas mmap, and returns the new allocated iovma.
  */
 static struct iovm_struct *alloc_iovm_area(struct iommu *obj, u32 da,
+					   const struct sg_table *sgt,
 					   size_t bytes, u32 flags)
 {
 	struct iovm_struct *new, *tmp;
@@ -276,6 +428,9 @@ static struct iovm_struct *alloc_iovm_area(struct iommu *obj, u32 da,
 		start = PAGE_SIZE;
 		if (flags & IOVMF_LINEAR)
 			alignement = iopgsz_max(bytes);
+		else
+			alignement = max_t(u32, alignement,
+					   sg_dma_len(sgt->sgl));
 		start = roundup(start, alignement);
 	}
 
@@ -370,51 +525,16 @@ out:
 }
 EXPORT_SYMBOL_GPL(da_to_va);
 
-static void sgtable_fill_vmalloc(struct sg_table *sgt, void *_va)
+static void sgtable_fill_kmalloc(struct sg_table *sgt, u32 da, u32 pa,
+				 size_t len)
 {
 	unsigned int i;
 	struct scatterlist *sg;
-	void *va = _va;
-	void *va_end;
-
-	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
-		struct page *pg;
-		const size_t bytes = PAGE_SIZE;
-
-		/*
-		 * iommu 'superpage' isn't supported with 'iommu_vmalloc()'
-		 */
-		pg = vmalloc_to_page(va);
-		BUG_ON(!pg);
-		sg_set_page(sg, pg, bytes, 0);
-
-		va += bytes;
-	}
-
-	va_end = _va + PAGE_SIZE * i;
-}
-
-static inline void sgtable_drain_vmalloc(struct sg_table *sgt)
-{
-	/*
-	 * Actually this is not necessary at all, just exists for
-	 * consistency of the code readability.
-	 */
-	BUG_ON(!sgt);
-}
-
-static void sgtable_fill_kmalloc(struct sg_table *sgt, u32 pa, size_t len)
-{
-	unsigned int i;
-	struct scatterlist *sg;
-	void *va;
-
-	va = phys_to_virt(pa);
 
 	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
 		size_t bytes;
 
-		bytes = iopgsz_max(len);
+		bytes = iopgsz_fit(len, da, pa);
 
 		BUG_ON(!iopgsz_ok(bytes));
 
@@ -422,6 +542,7 @@ static void sgtable_fill_kmalloc(struct sg_table *sgt, u32 pa, size_t len)
 		/*
 		 * 'pa' is cotinuous(linear).
 		 */
+		da += bytes;
 		pa += bytes;
 		len -= bytes;
 	}
@@ -437,11 +558,17 @@ static inline void sgtable_drain_kmalloc(struct sg_table *sgt)
 	BUG_ON(!sgt);
 }
 
-/* create 'da' <-> 'pa' mapping from 'sgt' */
+/*
+ * create 'da' <-> 'pa' mapping from 'sgt'
+ *
+ * All the pte entries are written first and then synced with the
+ * iommu at once, rather than cleaning their cache lines and scanning
+ * the iotlb for each of them.
+ */
 static int map_iovm_area(struct iommu *obj, struct iovm_struct *new,
 			 const struct sg_table *sgt, u32 flags)
 {
-	int err;
+	int err = -EINVAL;
 	unsigned int i, j;
 	struct scatterlist *sg;
 	u32 da = new->da_start;
@@ -465,17 +592,20 @@ static int map_iovm_area(struct iommu *obj, struct iovm_struct *new,
 		if (pgsz < 0)
 			goto err_out;
 		flags |= pgsz;
+		new->nr_pages[pgsz]++;
 
 		pr_debug("%s: [%d] %08x %08x(%x)\n", __func__,
 			 i, da, pa, bytes);
 
 		iotlb_init_entry(&e, da, pa, flags);
-		err = iopgtable_store_entry(obj, &e);
+		err = __iopgtable_store_entry(obj, &e);
 		if (err)
 			goto err_out;
 
 		da += bytes;
 	}
+
+	iopgtable_commit_store(obj, new->da_start, da);
 	return 0;
 
 err_out:
@@ -484,12 +614,14 @@ err_out:
 	for_each_sg(sgt->sgl, sg, i, j) {
 		size_t bytes;
 
-		bytes = iopgtable_clear_entry(obj, da);
+		bytes = __iopgtable_clear_entry(obj, da);
 
 		BUG_ON(!iopgsz_ok(bytes));
 
 		da += bytes;
 	}
+	if (da != new->da_start)
+		iopgtable_commit_clear(obj, new->da_start, da);
 	return err;
 }
 
@@ -505,7 +637,7 @@ static void unmap_iovm_area(struct iommu *obj, struct iovm_struct *area)
 	while (total > 0) {
 		size_t bytes;
 
-		bytes = iopgtable_clear_entry(obj, start);
+		bytes = __iopgtable_clear_entry(obj, start);
 		if (bytes == 0)
 			bytes = PAGE_SIZE;
 		else
@@ -518,6 +650,8 @@ static void unmap_iovm_area(struct iommu *obj, struct iovm_struct *area)
 		start += bytes;
 	}
 	BUG_ON(total);
+
+	iopgtable_commit_clear(obj, area->da_start, area->da_end);
 }
 
 /* template function for all unmapping */
@@ -540,7 +674,9 @@ static struct sg_table *unmap_vm_area(struct iommu *obj, const u32 da,
 		goto out;
 	}
 
-	if ((area->flags & flags) != flags) {
+	/* pinned user pages are only released by iommu_uunmap() */
+	if ((area->flags & flags) != flags ||
+	    (area->flags & IOVMF_USER) != (flags & IOVMF_USER)) {
 		dev_err(obj->dev, "%s: wrong flags(%08x)\n", __func__,
 			area->flags);
 		goto out;
@@ -563,20 +699,22 @@ out:
 }
 
 static u32 map_iommu_region(struct iommu *obj, u32 da,
-	      const struct sg_table *sgt, void *va, size_t bytes, u32 flags)
+	      const struct sg_table *sgt, void *va, size_t bytes, u32 flags,
+	      enum dma_data_direction dir)
 {
 	int err = -ENOMEM;
 	struct iovm_struct *new;
 
 	mutex_lock(&obj->mmap_lock);
 
-	new = alloc_iovm_area(obj, da, bytes, flags);
+	new = alloc_iovm_area(obj, da, sgt, bytes, flags);
 	if (IS_ERR(new)) {
 		err = PTR_ERR(new);
 		goto err_alloc_iovma;
 	}
 	new->va = va;
 	new->sgt = sgt;
+	new->dma_dir = dir;
 
 	if (map_iovm_area(obj, new, sgt, new->flags))
 		goto err_map;
@@ -598,7 +736,7 @@ err_alloc_iovma:
 static inline u32 __iommu_vmap(struct iommu *obj, u32 da,
 		 const struct sg_table *sgt, void *va, size_t bytes, u32 flags)
 {
-	return map_iommu_region(obj, da, sgt, va, bytes, flags);
+	return map_iommu_region(obj, da, sgt, va, bytes, flags, DMA_NONE);
 }
 
 /**
@@ -685,16 +823,15 @@ u32 iommu_vmalloc(struct iommu *obj, u32 da, size_t bytes, u32 flags)
 
 	bytes = PAGE_ALIGN(bytes);
 
-	va = vmalloc(bytes);
-	if (!va)
-		return -ENOMEM;
+	sgt = sgtable_alloc_chunks(bytes, da);
+	if (IS_ERR(sgt))
+		return PTR_ERR(sgt);
 
-	sgt = sgtable_alloc(bytes, flags);
-	if (IS_ERR(sgt)) {
-		da = PTR_ERR(sgt);
-		goto err_sgt_alloc;
+	va = vmap_chunks(sgt, bytes);
+	if (!va) {
+		da = -ENOMEM;
+		goto err_vmap;
 	}
-	sgtable_fill_vmalloc(sgt, va);
 
 	flags &= IOVMF_HW_MASK;
 	flags |= IOVMF_DISCONT;
@@ -708,10 +845,9 @@ u32 iommu_vmalloc(struct iommu *obj, u32 da, size_t bytes, u32 flags)
 	return da;
 
 err_iommu_vmap:
-	sgtable_drain_vmalloc(sgt);
-	sgtable_free(sgt);
-err_sgt_alloc:
-	vfree(va);
+	vunmap(va);
+err_vmap:
+	sgtable_free_chunks(sgt);
 	return da;
 }
 EXPORT_SYMBOL_GPL(iommu_vmalloc);
@@ -728,10 +864,10 @@ void iommu_vfree(struct iommu *obj, const u32 da)
 {
 	struct sg_table *sgt;
 
-	sgt = unmap_vm_area(obj, da, vfree, IOVMF_DISCONT | IOVMF_ALLOC);
+	sgt = unmap_vm_area(obj, da, vunmap_sg, IOVMF_DISCONT | IOVMF_ALLOC);
 	if (!sgt)
 		dev_dbg(obj->dev, "%s: No sgt\n", __func__);
-	sgtable_free(sgt);
+	sgtable_free_chunks(sgt);
 }
 EXPORT_SYMBOL_GPL(iommu_vfree);
 
@@ -740,13 +876,13 @@ static u32 __iommu_kmap(struct iommu *obj, u32 da, u32 pa, void *va,
 {
 	struct sg_table *sgt;
 
-	sgt = sgtable_alloc(bytes, flags);
+	sgt = sgtable_alloc(bytes, flags, da, pa);
 	if (IS_ERR(sgt))
 		return PTR_ERR(sgt);
 
-	sgtable_fill_kmalloc(sgt, pa, bytes);
+	sgtable_fill_kmalloc(sgt, da, pa, bytes);
 
-	da = map_iommu_region(obj, da, sgt, va, bytes, flags);
+	da = map_iommu_region(obj, da, sgt, va, bytes, flags, DMA_NONE);
 	if (IS_ERR_VALUE(da)) {
 		sgtable_drain_kmalloc(sgt);
 		sgtable_free(sgt);
@@ -870,6 +1006,202 @@ void iommu_kfree(struct iommu *obj, u32 da)
 }
 EXPORT_SYMBOL_GPL(iommu_kfree);
 
+static void sgtable_release_user(struct sg_table *sgt, unsigned int nents,
+				 int dirty)
+{
+	unsigned int i;
+	struct scatterlist *sg;
+
+	for_each_sg(sgt->sgl, sg, nents, i) {
+		struct page *page = sg_page(sg);
+
+		if (dirty && !PageReserved(page))
+			set_page_dirty_lock(page);
+		page_cache_release(page);
+	}
+}
+
+/* pin the user pages at @uaddr and describe them with a new sg_table */
+static struct sg_table *sgtable_pin_user(unsigned long uaddr, size_t bytes,
+					 int write)
+{
+	int i, err, nr_pages = bytes >> PAGE_SHIFT;
+	struct page **pages;
+	struct scatterlist *sg;
+	struct sg_table *sgt;
+
+	pages = vmalloc(sizeof(*pages) * nr_pages);
+	if (!pages)
+		return ERR_PTR(-ENOMEM);
+
+	down_read(&current->mm->mmap_sem);
+	err = get_user_pages(current, current->mm, uaddr, nr_pages, write, 0,
+			     pages, NULL);
+	up_read(&current->mm->mmap_sem);
+
+	if (err < 0)
+		goto err_pin;
+
+	if (err < nr_pages) {
+		nr_pages = err;
+		err = -EFAULT;
+		goto err_sgt;
+	}
+
+	sgt = sgtable_alloc(bytes, IOVMF_DISCONT, 0, 0);
+	if (IS_ERR(sgt)) {
+		err = PTR_ERR(sgt);
+		goto err_sgt;
+	}
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+		sg_set_page(sg, pages[i], PAGE_SIZE, 0);
+
+	vfree(pages);
+	return sgt;
+
+err_sgt:
+	for (i = 0; i < nr_pages; i++)
+		page_cache_release(pages[i]);
+err_pin:
+	vfree(pages);
+	return ERR_PTR(err);
+}
+
+/**
+ * iommu_umap  -  (d)-(p)-(v) address mapper for user buffers
+ * @obj:	objective iommu
+ * @da:		contiguous iommu virtual memory
+ * @uaddr:	page aligned user buffer in the current process
+ * @bytes:	bytes of the buffer
+ * @dir:	dma direction of the device accesses
+ * @flags:	iovma and page property
+ *
+ * Pins the user pages backing @uaddr and creates 1-n-1 mapping with
+ * them, so that the device can work on the buffer in place. Caches
+ * are cleaned/invalidated for @dir once here; a mapping reused for
+ * several transfers needs 'iommu_usync()' in between. Returns @da,
+ * which might be adjusted if 'IOVMF_DA_ANON' is set.
+ */
+u32 iommu_umap(struct iommu *obj, u32 da, unsigned long uaddr, size_t bytes,
+	       enum dma_data_direction dir, u32 flags)
+{
+	struct sg_table *sgt;
+	int write = (dir != DMA_TO_DEVICE);
+
+	if (!obj || !obj->dev || !bytes || !valid_dma_direction(dir))
+		return -EINVAL;
+
+	if (!IS_ALIGNED(uaddr, PAGE_SIZE))
+		return -EINVAL;
+
+	bytes = PAGE_ALIGN(bytes);
+
+	if (!access_ok(write ? VERIFY_WRITE : VERIFY_READ,
+		       (void __user *)uaddr, bytes))
+		return -EFAULT;
+
+	sgt = sgtable_pin_user(uaddr, bytes, write);
+	if (IS_ERR(sgt))
+		return PTR_ERR(sgt);
+
+	dma_map_sg(obj->dev, sgt->sgl, sgt->nents, dir);
+
+	flags &= IOVMF_HW_MASK;
+	flags |= IOVMF_DISCONT;
+	flags |= IOVMF_USER;
+	flags |= (da ? IOVMF_DA_FIXED : IOVMF_DA_ANON);
+
+	da = map_iommu_region(obj, da, sgt, NULL, bytes, flags, dir);
+	if (IS_ERR_VALUE(da))
+		goto err_iommu_vmap;
+
+	return da;
+
+err_iommu_vmap:
+	dma_unmap_sg(obj->dev, sgt->sgl, sgt->nents, dir);
+	sgtable_release_user(sgt, sgt->nents, 0);
+	sgtable_free(sgt);
+	return da;
+}
+EXPORT_SYMBOL_GPL(iommu_umap);
+
+static void umap_nop(const void *va)
+{
+}
+
+/**
+ * iommu_uunmap  -  release virtual mapping obtained by 'iommu_umap()'
+ * @obj:	objective iommu
+ * @da:		iommu device virtual address
+ *
+ * Unmaps the user buffer mapped at @da and unpins its pages, marking
+ * them dirty if the device may have written to them.
+ */
+void iommu_uunmap(struct iommu *obj, u32 da)
+{
+	struct sg_table *sgt;
+	struct iovm_struct *area;
+	enum dma_data_direction dir;
+
+	area = find_iovm_area(obj, da);
+	if (!area || !(area->flags & IOVMF_USER)) {
+		dev_dbg(obj->dev, "%s: no user area(%08x)\n", __func__, da);
+		return;
+	}
+	dir = area->dma_dir;
+
+	/* the iotlb is flushed by then, the pages can be unpinned */
+	sgt = unmap_vm_area(obj, da, umap_nop, IOVMF_DISCONT | IOVMF_USER);
+	if (!sgt) {
+		dev_dbg(obj->dev, "%s: No sgt\n", __func__);
+		return;
+	}
+
+	dma_unmap_sg(obj->dev, sgt->sgl, sgt->nents, dir);
+	sgtable_release_user(sgt, sgt->nents, dir != DMA_TO_DEVICE);
+	sgtable_free(sgt);
+}
+EXPORT_SYMBOL_GPL(iommu_uunmap);
+
+/**
+ * iommu_usync  -  hand a mapped user buffer over to the device or the cpu
+ * @obj:	objective iommu
+ * @da:		iommu device virtual address
+ * @for_device:	non-zero before the device accesses the buffer again,
+ *		zero before the cpu does
+ *
+ * Does the cache maintenance for the whole area in one go, using the
+ * direction given to 'iommu_umap()'.
+ */
+int iommu_usync(struct iommu *obj, u32 da, int for_device)
+{
+	struct iovm_struct *area;
+	struct scatterlist *sgl;
+	int nents, err = 0;
+
+	mutex_lock(&obj->mmap_lock);
+
+	area = __find_iovm_area(obj, da);
+	if (!area || !(area->flags & IOVMF_USER)) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	sgl = area->sgt->sgl;
+	nents = area->sgt->nents;
+
+	if (for_device)
+		dma_sync_sg_for_device(obj->dev, sgl, nents, area->dma_dir);
+	else
+		dma_sync_sg_for_cpu(obj->dev, sgl, nents, area->dma_dir);
+out:
+	mutex_unlock(&obj->mmap_lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(iommu_usync);
+
 
 static int __init iovmm_init(void)
 {
@@ -19,12 +19,21 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
  * 02110-1301 USA
  *
+ * Messages are queued in a kfifo per direction. Received messages are
+ * put there by the interrupt handler, which drains the whole h/w fifo
+ * at once, and taken out by a tasklet that hands them to the receiver
+ * callback, without either side taking a lock. Messages that can't go
+ * out right away are queued under the tx queue lock, which senders
+ * share, and pushed out by a tasklet when the h/w fifo has room again.
  */
 
 #include <linux/module.h>
+#include <linux/err.h>
+#include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/device.h>
 #include <linux/delay.h>
+#include <linux/kfifo.h>
 
 #include <plat/mailbox.h>
 
@@ -32,6 +41,10 @@ static int enable_seq_bit;
 module_param(enable_seq_bit, bool, 0);
 MODULE_PARM_DESC(enable_seq_bit, "Enable sequence bit checking.");
 
+static unsigned int mbox_kfifo_size = 256;
+module_param(mbox_kfifo_size, uint, S_IRUGO);
+MODULE_PARM_DESC(mbox_kfifo_size, "Messages queued per direction.");
+
 static struct omap_mbox *mboxes;
 static DEFINE_RWLOCK(mboxes_lock);
 
@@ -147,140 +160,132 @@ static int __mbox_msg_send(struct omap_mbox *mbox, mbox_msg_t msg, void *arg)
 	return ret;
 }
 
-struct omap_msg_tx_data {
-	mbox_msg_t	msg;
-	void		*arg;
-};
-
-static void omap_msg_tx_end_io(struct request *rq, int error)
-{
-	kfree(rq->special);
-	__blk_put_request(rq->q, rq);
-}
-
+/*
+ * Returns -EBUSY when the message can't be sent right away and the tx
+ * queue is full as well.
+ */
 int omap_mbox_msg_send(struct omap_mbox *mbox, mbox_msg_t msg, void* arg)
 {
-	struct omap_msg_tx_data *tx_data;
-	struct request *rq;
-	struct request_queue *q = mbox->txq->queue;
+	struct omap_msg_tx_data tx_data = { .msg = msg, .arg = arg, };
+	struct omap_mbox_queue *mq = mbox->txq;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&mq->lock, flags);
 
-	tx_data = kmalloc(sizeof(*tx_data), GFP_ATOMIC);
-	if (unlikely(!tx_data))
-		return -ENOMEM;
+	/* nothing queued ahead of it: try the h/w fifo directly */
+	if (!mq->tx_pending && !__kfifo_len(mq->fifo) &&
+	    !mbox_fifo_full(mbox) && !__mbox_msg_send(mbox, msg, arg))
+		goto out;
 
-	rq = blk_get_request(q, WRITE, GFP_ATOMIC);
-	if (unlikely(!rq)) {
-		kfree(tx_data);
-		return -ENOMEM;
+	if (__kfifo_put(mq->fifo, (unsigned char *)&tx_data,
+			sizeof(tx_data)) != sizeof(tx_data)) {
+		ret = -EBUSY;
+		goto out;
 	}
 
-	tx_data->msg = msg;
-	tx_data->arg = arg;
-	rq->end_io = omap_msg_tx_end_io;
-	blk_insert_request(q, rq, 0, tx_data);
+	tasklet_schedule(&mq->tasklet);
+out:
+	spin_unlock_irqrestore(&mq->lock, flags);
 
-	schedule_work(&mbox->txq->work);
-	return 0;
+	return ret;
 }
 EXPORT_SYMBOL(omap_mbox_msg_send);
 
-static void mbox_tx_work(struct work_struct *work)
+static void mbox_tx_tasklet(unsigned long data)
 {
-	int ret;
-	struct request *rq;
-	struct omap_mbox_queue *mq = container_of(work,
-				struct omap_mbox_queue, work);
-	struct omap_mbox *mbox = mq->queue->queuedata;
-	struct request_queue *q = mbox->txq->queue;
-
-	while (1) {
-		struct omap_msg_tx_data *tx_data;
-
-		spin_lock(q->queue_lock);
-		rq = blk_fetch_request(q);
-		spin_unlock(q->queue_lock);
+	struct omap_mbox *mbox = (struct omap_mbox *)data;
+	struct omap_mbox_queue *mq = mbox->txq;
+	struct omap_msg_tx_data *tx_data = &mq->tx_data;
+	unsigned long flags;
 
-		if (!rq)
-			break;
+	spin_lock_irqsave(&mq->lock, flags);
 
-		tx_data = rq->special;
+	while (mq->tx_pending ||
+	       __kfifo_get(mq->fifo, (unsigned char *)tx_data,
+			   sizeof(*tx_data)) == sizeof(*tx_data)) {
+		/* kept here until it is out, to preserve the order */
+		mq->tx_pending = 1;
 
-		ret = __mbox_msg_send(mbox, tx_data->msg, tx_data->arg);
-		if (ret) {
+		if (__mbox_msg_send(mbox, tx_data->msg, tx_data->arg)) {
 			enable_mbox_irq(mbox, IRQ_TX);
-			spin_lock(q->queue_lock);
-			blk_requeue_request(q, rq);
-			spin_unlock(q->queue_lock);
-			return;
+			break;
 		}
-
-		spin_lock(q->queue_lock);
-		__blk_end_request_all(rq, 0);
-		spin_unlock(q->queue_lock);
+		mq->tx_pending = 0;
 	}
+
+	spin_unlock_irqrestore(&mq->lock, flags);
 }
 
 /*
- * Message receiver(workqueue)
+ * Message receiver(tasklet)
  */
-static void mbox_rx_work(struct work_struct *work)
+
+/* the rx irq is held off while the queue is full, see below */
+static void mbox_rx_resume(struct omap_mbox *mbox)
 {
-	struct omap_mbox_queue *mq =
-			container_of(work, struct omap_mbox_queue, work);
-	struct omap_mbox *mbox = mq->queue->queuedata;
-	struct request_queue *q = mbox->rxq->queue;
-	struct request *rq;
+	struct omap_mbox_queue *mq = mbox->rxq;
+
+	if (!mq->rx_stalled)
+		return;
+
+	mq->rx_stalled = 0;
+	enable_mbox_irq(mbox, IRQ_RX);
+}
+
+static void mbox_rx_tasklet(unsigned long data)
+{
+	struct omap_mbox *mbox = (struct omap_mbox *)data;
+	struct omap_mbox_queue *mq = mbox->rxq;
 	mbox_msg_t msg;
-	unsigned long flags;
 
-	if (mbox->rxq->callback == NULL) {
-		sysfs_notify(&mbox->dev->kobj, NULL, "mbox");
+	/* messages are picked up through sysfs; that needs a process */
+	if (mq->callback == NULL) {
+		schedule_work(&mq->work);
 		return;
 	}
 
-	while (1) {
-		spin_lock_irqsave(q->queue_lock, flags);
-		rq = blk_fetch_request(q);
-		spin_unlock_irqrestore(q->queue_lock, flags);
-		if (!rq)
-			break;
+	while (__kfifo_get(mq->fifo, (unsigned char *)&msg,
+			   sizeof(msg)) == sizeof(msg))
+		mq->callback((void *)msg);
 
-		msg = (mbox_msg_t)rq->special;
-		blk_end_request_all(rq, 0);
-		mbox->rxq->callback((void *)msg);
-	}
+	mbox_rx_resume(mbox);
 }
 
-/*
- * Mailbox interrupt handler
- */
-static void mbox_txq_fn(struct request_queue * q)
+static void mbox_rx_work(struct work_struct *work)
 {
-}
+	struct omap_mbox_queue *mq =
+			container_of(work, struct omap_mbox_queue, work);
 
-static void mbox_rxq_fn(struct request_queue * q)
-{
+	sysfs_notify(&mq->mbox->dev->kobj, NULL, "mbox");
 }
 
+/*
+ * Mailbox interrupt handler
+ */
 static void __mbox_tx_interrupt(struct omap_mbox *mbox)
 {
 	disable_mbox_irq(mbox, IRQ_TX);
 	ack_mbox_irq(mbox, IRQ_TX);
-	schedule_work(&mbox->txq->work);
+	tasklet_schedule(&mbox->txq->tasklet);
 }
 
 static void __mbox_rx_interrupt(struct omap_mbox *mbox)
 {
-	struct request *rq;
+	struct omap_mbox_queue *mq = mbox->rxq;
 	mbox_msg_t msg;
-	struct request_queue *q = mbox->rxq->queue;
-
-	disable_mbox_irq(mbox, IRQ_RX);
 
 	while (!mbox_fifo_empty(mbox)) {
-		rq = blk_get_request(q, WRITE, GFP_ATOMIC);
-		if (unlikely(!rq))
-			goto nomem;
+		/*
+		 * No room: leave the rest in the h/w fifo, which makes the
+		 * remote side wait, until the receiver has caught up.
+		 */
+		if (unlikely(mq->fifo->size - __kfifo_len(mq->fifo) <
+			     sizeof(msg))) {
+			disable_mbox_irq(mbox, IRQ_RX);
+			mq->rx_stalled = 1;
+			goto stalled;
+		}
 
 		msg = mbox_fifo_read(mbox);
 
@@ -290,16 +295,15 @@ static void __mbox_rx_interrupt(struct omap_mbox *mbox)
 				mbox->err_notify();
 		}
 
-		blk_insert_request(q, rq, 0, (void *)msg);
+		__kfifo_put(mq->fifo, (unsigned char *)&msg, sizeof(msg));
 		if (mbox->ops->type == OMAP_MBOX_TYPE1)
 			break;
 	}
 
 	/* no more messages in the fifo. clear IRQ source. */
 	ack_mbox_irq(mbox, IRQ_RX);
-	enable_mbox_irq(mbox, IRQ_RX);
-nomem:
-	schedule_work(&mbox->rxq->work);
+stalled:
+	tasklet_schedule(&mq->tasklet);
 }
 
 static irqreturn_t mbox_interrupt(int irq, void *p)
@@ -336,27 +340,22 @@ omap_mbox_write(struct device *dev, struct device_attribute *attr,
 	return (size_t)((char *)p - buf);
 }
 
+/* only used when no receiver callback is installed */
 static ssize_t
 omap_mbox_read(struct device *dev, struct device_attribute *attr, char *buf)
 {
-	unsigned long flags;
-	struct request *rq;
 	mbox_msg_t *p = (mbox_msg_t *) buf;
 	struct omap_mbox *mbox = dev_get_drvdata(dev);
-	struct request_queue *q = mbox->rxq->queue;
+	struct omap_mbox_queue *mq = mbox->rxq;
 
-	while (1) {
-		spin_lock_irqsave(q->queue_lock, flags);
-		rq = blk_fetch_request(q);
-		spin_unlock_irqrestore(q->queue_lock, flags);
-
-		if (!rq)
-			break;
-
-		*p = (mbox_msg_t)rq->special;
+	if (mq->callback)
+		return 0;
 
-		blk_end_request_all(rq, 0);
+	spin_lock_bh(&mq->lock);
 
+	while ((char *)(p + 1) <= buf + PAGE_SIZE &&
+	       __kfifo_get(mq->fifo, (unsigned char *)p,
+			   sizeof(*p)) == sizeof(*p)) {
 		if (unlikely(mbox_seq_test(mbox, *p))) {
 			pr_info("mbox: Illegal seq bit!(%08x) ignored\n", *p);
 			continue;
@@ -364,6 +363,10 @@ omap_mbox_read(struct device *dev, struct device_attribute *attr, char *buf)
 		p++;
 	}
 
+	mbox_rx_resume(mbox);
+
+	spin_unlock_bh(&mq->lock);
+
 	pr_debug("%02x %02x %02x %02x\n", buf[0], buf[1], buf[2], buf[3]);
 
 	return (size_t) ((char *)p - buf);
@@ -383,10 +386,10 @@ static struct class omap_mbox_class = {
 };
 
 static struct omap_mbox_queue *mbox_queue_alloc(struct omap_mbox *mbox,
-					request_fn_proc * proc,
-					void (*work) (struct work_struct *))
+					size_t msg_size,
+					void (*tasklet)(unsigned long))
 {
-	struct request_queue *q;
+	struct kfifo *fifo;
 	struct omap_mbox_queue *mq;
 
 	mq = kzalloc(sizeof(struct omap_mbox_queue), GFP_KERNEL);
@@ -395,13 +398,14 @@ static struct omap_mbox_queue *mbox_queue_alloc(struct omap_mbox *mbox,
 
 	spin_lock_init(&mq->lock);
 
-	q = blk_init_queue(proc, &mq->lock);
-	if (!q)
+	fifo = kfifo_alloc(mbox_kfifo_size * msg_size, GFP_KERNEL, &mq->lock);
+	if (IS_ERR(fifo))
 		goto error;
-	q->queuedata = mbox;
-	mq->queue = q;
+	mq->fifo = fifo;
+	mq->mbox = mbox;
 
-	INIT_WORK(&mq->work, work);
+	tasklet_init(&mq->tasklet, tasklet, (unsigned long)mbox);
+	INIT_WORK(&mq->work, mbox_rx_work);
 
 	return mq;
 error:
@@ -411,7 +415,9 @@ error:
 
 static void mbox_queue_free(struct omap_mbox_queue *q)
 {
-	blk_cleanup_queue(q->queue);
+	tasklet_kill(&q->tasklet);
+	flush_work(&q->work);
+	kfifo_free(q->fifo);
 	kfree(q);
 }
 
@@ -426,35 +432,36 @@ static int omap_mbox_init(struct omap_mbox *mbox)
 			return ret;
 	}
 
-	ret = request_irq(mbox->irq, mbox_interrupt, IRQF_DISABLED,
-				mbox->name, mbox);
-	if (unlikely(ret)) {
-		printk(KERN_ERR
-			"failed to register mailbox interrupt:%d\n", ret);
-		goto fail_request_irq;
-	}
-
-	mq = mbox_queue_alloc(mbox, mbox_txq_fn, mbox_tx_work);
+	mq = mbox_queue_alloc(mbox, sizeof(struct omap_msg_tx_data),
+			      mbox_tx_tasklet);
 	if (!mq) {
 		ret = -ENOMEM;
 		goto fail_alloc_txq;
 	}
 	mbox->txq = mq;
 
-	mq = mbox_queue_alloc(mbox, mbox_rxq_fn, mbox_rx_work);
+	mq = mbox_queue_alloc(mbox, sizeof(mbox_msg_t), mbox_rx_tasklet);
 	if (!mq) {
 		ret = -ENOMEM;
 		goto fail_alloc_rxq;
 	}
 	mbox->rxq = mq;
 
+	ret = request_irq(mbox->irq, mbox_interrupt, IRQF_DISABLED,
+				mbox->name, mbox);
+	if (unlikely(ret)) {
+		printk(KERN_ERR
+			"failed to register mailbox interrupt:%d\n", ret);
+		goto fail_request_irq;
+	}
+
 	return 0;
 
+ fail_request_irq:
+	mbox_queue_free(mbox->rxq);
  fail_alloc_rxq:
 	mbox_queue_free(mbox->txq);
  fail_alloc_txq:
-	free_irq(mbox->irq, mbox);
- fail_request_irq:
 	if (unlikely(mbox->ops->shutdown))
 		mbox->ops->shutdown(mbox);
 
@@ -463,11 +470,11 @@ static int omap_mbox_init(struct omap_mbox *mbox)
 
 static void omap_mbox_fini(struct omap_mbox *mbox)
 {
+	free_irq(mbox->irq, mbox);
+
 	mbox_queue_free(mbox->txq);
 	mbox_queue_free(mbox->rxq);
 
-	free_irq(mbox->irq, mbox);
-
 	if (unlikely(mbox->ops->shutdown))
 		mbox->ops->shutdown(mbox);
 }
@@ -20,11 +20,13 @@
 #include <linux/init.h>
 #include <linux/cpufreq.h>
 #include <linux/device.h>
+#include <linux/platform_device.h>
 
 /* Interface documentation is in mach/omap-pm.h */
 #include <plat/omap-pm.h>
 
 #include <plat/powerdomain.h>
+#include <plat/omap_device.h>
 
 struct omap_opp *dsp_opps;
 struct omap_opp *mpu_opps;
@@ -255,6 +257,10 @@ unsigned long omap_pm_cpu_get_freq(void)
 
 int omap_pm_get_dev_context_loss_count(struct device *dev)
 {
+#if defined(CONFIG_ARCH_OMAP2) || defined(CONFIG_ARCH_OMAP3)
+	struct omap_device *od;
+#endif
+
 	if (!dev) {
 		WARN_ON(1);
 		return -EINVAL;
@@ -265,8 +271,16 @@ int omap_pm_get_dev_context_loss_count(struct device *dev)
 
 	/*
 	 * Map the device to the powerdomain.  Return the powerdomain
-	 * off counter.
+	 * off counter.  Only platform devices can be omap_devices.
 	 */
+#if defined(CONFIG_ARCH_OMAP2) || defined(CONFIG_ARCH_OMAP3)
+	if (dev->bus != &platform_bus_type)
+		return 0;
+
+	od = omap_device_of(to_platform_device(dev));
+	if (od)
+		return pwrdm_get_context_loss_count(omap_device_get_pwrdm(od));
+#endif
 
 	return 0;
 }
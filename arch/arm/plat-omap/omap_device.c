@@ -142,7 +142,7 @@ static int _omap_device_activate(struct omap_device *od, u8 ignore_lat)
 		getnstimeofday(&b);
 
 		c = timespec_sub(b, a);
-		act_lat = timespec_to_ns(&c) * NSEC_PER_USEC;
+		act_lat = div_s64(timespec_to_ns(&c), NSEC_PER_USEC);
 
 		pr_debug("omap_device: %s: pm_lat %d: activate: elapsed time "
 			 "%llu usec\n", od->pdev.name, od->pm_lat_level,
@@ -198,7 +198,7 @@ static int _omap_device_deactivate(struct omap_device *od, u8 ignore_lat)
 		getnstimeofday(&b);
 
 		c = timespec_sub(b, a);
-		deact_lat = timespec_to_ns(&c) * NSEC_PER_USEC;
+		deact_lat = div_s64(timespec_to_ns(&c), NSEC_PER_USEC);
 
 		pr_debug("omap_device: %s: pm_lat %d: deactivate: elapsed time "
 			 "%llu usec\n", od->pdev.name, od->pm_lat_level,
@@ -412,14 +412,18 @@ odbs_exit1:
  * omap_device_register - register an omap_device with one omap_hwmod
  * @od: struct omap_device * to register
  *
- * Register the omap_device structure.  This currently just calls
- * platform_device_register() on the underlying platform_device.
- * Returns the return value of platform_device_register().
+ * Register the omap_device structure.  This marks the underlying
+ * platform_device as an omap_device (see omap_device_of()) and calls
+ * platform_device_register() on it.  Returns the return value of
+ * platform_device_register().
  */
 int omap_device_register(struct omap_device *od)
 {
 	pr_debug("omap_device: %s: registering\n", od->pdev.name);
 
+	od->_dev_wakeup_lat_limit = INT_MAX;
+	od->pdev.archdata.od = od;
+
 	return platform_device_register(&od->pdev);
 }
 
@@ -459,7 +463,6 @@ int omap_device_enable(struct platform_device *pdev)
 	ret = _omap_device_activate(od, IGNORE_WAKEUP_LAT);
 
 	od->dev_wakeup_lat = 0;
-	od->_dev_wakeup_lat_limit = INT_MAX;
 	od->_state = OMAP_DEVICE_STATE_ENABLED;
 
 	return ret;
@@ -573,6 +576,30 @@ int omap_device_align_pm_lat(struct platform_device *pdev,
 	return ret;
 }
 
+/**
+ * omap_device_get_idle_delay - how long @od should be unused before idling
+ * @od: struct omap_device *
+ *
+ * Idling a device and waking it back up costs the sum of the
+ * deactivate and activate latencies of its pm_lats table.  Return the
+ * time, in milliseconds, for which @od should stay unused before it is
+ * worth paying that: OMAP_DEVICE_IDLE_BREAKEVEN times the round-trip
+ * cost, rounded up.  Devices without a pm_lats table, or whose
+ * transitions are free, can be idled right away and get 0.  Used by the
+ * runtime PM code to defer idling busy devices.
+ */
+unsigned int omap_device_get_idle_delay(struct omap_device *od)
+{
+	struct omap_device_pm_latency *odpl;
+	u32 lat = 0;
+	int i;
+
+	for (i = 0, odpl = od->pm_lats; i < od->pm_lats_cnt; i++, odpl++)
+		lat += odpl->deactivate_lat + odpl->activate_lat;
+
+	return DIV_ROUND_UP(lat * OMAP_DEVICE_IDLE_BREAKEVEN, USEC_PER_MSEC);
+}
+
 /**
  * omap_device_get_pwrdm - return the powerdomain * associated with @od
  * @od: struct omap_device *
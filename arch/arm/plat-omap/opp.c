@@ -0,0 +1,225 @@
+/*
+ * OMAP operating performance point (OPP) table handling
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * An OPP couples a clock rate to the minimum voltage its voltage domain
+ * needs to run at that rate.  The tables are owned by the chip/board
+ * code and handed to the PM layer through omap_pm_if_early_init(); this
+ * file only provides lookups on them.  Lookups skip OPPs that have been
+ * disabled at runtime, so e.g. a thermal or board constraint can take
+ * an OPP out of use without rebuilding the table.
+ *
+ * The tables are not locked: enabling and disabling an OPP is a single
+ * store, and users that have to act on a consistent view (cpufreq, the
+ * clock code) already serialize against each other.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/cpufreq.h>
+
+#include <plat/opp.h>
+
+#define for_each_opp(opp, oppl)	for (opp = oppl; opp->rate; opp++)
+
+/**
+ * opp_get_opp_count - number of enabled OPPs in a table
+ * @oppl: OPP table
+ */
+int opp_get_opp_count(const struct omap_opp *oppl)
+{
+	const struct omap_opp *opp;
+	int n = 0;
+
+	if (!oppl)
+		return -EINVAL;
+
+	for_each_opp(opp, oppl)
+		if (opp->enabled)
+			n++;
+
+	return n;
+}
+EXPORT_SYMBOL(opp_get_opp_count);
+
+/**
+ * opp_find_rate_exact - look up an OPP by its exact rate
+ * @oppl: OPP table
+ * @rate: rate to look for
+ * @enabled: state the OPP must be in
+ *
+ * Returns the OPP or NULL if there is no such OPP in the wanted state.
+ * Looking for a disabled OPP is how opp_enable() callers find it.
+ */
+struct omap_opp *opp_find_rate_exact(struct omap_opp *oppl,
+				     unsigned long rate, bool enabled)
+{
+	struct omap_opp *opp;
+
+	if (!oppl)
+		return NULL;
+
+	for_each_opp(opp, oppl)
+		if (opp->rate == rate && opp->enabled == enabled)
+			return opp;
+
+	return NULL;
+}
+EXPORT_SYMBOL(opp_find_rate_exact);
+
+/**
+ * opp_find_rate_floor - find the highest enabled OPP at or below a rate
+ * @oppl: OPP table
+ * @rate: in: rate to search from; out: rate of the OPP found
+ *
+ * Returns the OPP or NULL if every enabled OPP is faster than *rate.
+ */
+struct omap_opp *opp_find_rate_floor(struct omap_opp *oppl,
+				     unsigned long *rate)
+{
+	struct omap_opp *opp, *found = NULL;
+
+	if (!oppl || !rate)
+		return NULL;
+
+	for_each_opp(opp, oppl) {
+		if (!opp->enabled)
+			continue;
+		if (opp->rate > *rate)
+			break;
+		found = opp;
+	}
+
+	if (found)
+		*rate = found->rate;
+
+	return found;
+}
+EXPORT_SYMBOL(opp_find_rate_floor);
+
+/**
+ * opp_find_rate_ceil - find the lowest enabled OPP at or above a rate
+ * @oppl: OPP table
+ * @rate: in: rate to search from; out: rate of the OPP found
+ *
+ * Returns the OPP or NULL if every enabled OPP is slower than *rate.
+ */
+struct omap_opp *opp_find_rate_ceil(struct omap_opp *oppl,
+				    unsigned long *rate)
+{
+	struct omap_opp *opp;
+
+	if (!oppl || !rate)
+		return NULL;
+
+	for_each_opp(opp, oppl) {
+		if (opp->enabled && opp->rate >= *rate) {
+			*rate = opp->rate;
+			return opp;
+		}
+	}
+
+	return NULL;
+}
+EXPORT_SYMBOL(opp_find_rate_ceil);
+
+/**
+ * opp_find_id - look up an enabled OPP by its OPP ID
+ * @oppl: OPP table
+ * @opp_id: OPP ID
+ *
+ * Used to find the OPP of another clock on the same voltage domain,
+ * e.g. the DSP OPP matching an MPU OPP on VDD1.
+ */
+struct omap_opp *opp_find_id(struct omap_opp *oppl, u8 opp_id)
+{
+	struct omap_opp *opp;
+
+	if (!oppl)
+		return NULL;
+
+	for_each_opp(opp, oppl)
+		if (opp->enabled && opp->opp_id == opp_id)
+			return opp;
+
+	return NULL;
+}
+EXPORT_SYMBOL(opp_find_id);
+
+/**
+ * opp_enable - make an OPP available for selection
+ * @opp: OPP, as returned by one of the lookups
+ */
+int opp_enable(struct omap_opp *opp)
+{
+	if (!opp)
+		return -EINVAL;
+
+	opp->enabled = true;
+	return 0;
+}
+EXPORT_SYMBOL(opp_enable);
+
+/**
+ * opp_disable - take an OPP out of use
+ * @opp: OPP, as returned by one of the lookups
+ *
+ * An OPP the hardware is currently running at stays in effect until the
+ * next transition.
+ */
+int opp_disable(struct omap_opp *opp)
+{
+	if (!opp)
+		return -EINVAL;
+
+	opp->enabled = false;
+	return 0;
+}
+EXPORT_SYMBOL(opp_disable);
+
+#ifdef CONFIG_CPU_FREQ
+/**
+ * opp_init_cpufreq_table - build a cpufreq table from the enabled OPPs
+ * @oppl: OPP table
+ * @table: where to store the newly allocated table
+ *
+ * *table is left untouched if no table could be built.
+ */
+void opp_init_cpufreq_table(struct omap_opp *oppl,
+			    struct cpufreq_frequency_table **table)
+{
+	struct cpufreq_frequency_table *freq_table;
+	struct omap_opp *opp;
+	int i = 0, n;
+
+	n = opp_get_opp_count(oppl);
+	if (n <= 0) {
+		printk(KERN_WARNING "%s: no OPPs to build a frequency table "
+		       "from\n", __func__);
+		return;
+	}
+
+	freq_table = kzalloc(sizeof(*freq_table) * (n + 1), GFP_KERNEL);
+	if (!freq_table)
+		return;
+
+	for_each_opp(opp, oppl) {
+		if (!opp->enabled)
+			continue;
+		freq_table[i].index = i;
+		freq_table[i].frequency = opp->rate / 1000;
+		i++;
+	}
+
+	freq_table[i].index = i;
+	freq_table[i].frequency = CPUFREQ_TABLE_END;
+
+	*table = &freq_table[0];
+}
+#endif
@@ -14,6 +14,9 @@
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/init.h>
+#include <linux/smp.h>
+#include <linux/cpu.h>
+#include <linux/hardirq.h>
 
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
@@ -38,43 +41,113 @@ union vfp_state *last_VFP_context[NR_CPUS];
  */
 unsigned int VFP_arch;
 
-static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
+/*
+ * Is 'vfp' the state currently held in the VFP registers of 'cpu'?
+ * On SMP the state is tagged with the CPU it was last loaded on, as
+ * last_VFP_context[] of a CPU the thread has since left may be stale.
+ */
+static inline int vfp_state_in_hw(unsigned int cpu, union vfp_state *vfp)
 {
-	struct thread_info *thread = v;
-	union vfp_state *vfp;
-	__u32 cpu = thread->cpu;
+#ifdef CONFIG_SMP
+	if (vfp->hard.cpu != cpu)
+		return 0;
+#endif
+	return last_VFP_context[cpu] == vfp;
+}
 
-	if (likely(cmd == THREAD_NOTIFY_SWITCH)) {
-		u32 fpexc = fmrx(FPEXC);
+/*
+ * Write back the state held in the VFP registers of this CPU, if any,
+ * and forget about it.  Must be called with interrupts disabled.
+ */
+static void vfp_flush_hwstate(unsigned int cpu)
+{
+	union vfp_state *vfp = last_VFP_context[cpu];
+	u32 fpexc;
+
+	if (vfp && vfp_state_in_hw(cpu, vfp)) {
+		fpexc = fmrx(FPEXC);
+		fmxr(FPEXC, (fpexc & ~FPEXC_EX) | FPEXC_EN);
+		vfp_save_state(vfp, fpexc | FPEXC_EN);
+		fmxr(FPEXC, fpexc);
+	}
+
+	/* pairs with vfp_fetch_state(): the saved state is out first */
+	smp_mb();
+	last_VFP_context[cpu] = NULL;
+}
+
+static void vfp_ipi_flush(void *info)
+{
+	unsigned int cpu = smp_processor_id();
+
+	if (last_VFP_context[cpu] == info)
+		vfp_flush_hwstate(cpu);
+}
+
+static void vfp_ipi_drop(void *info)
+{
+	unsigned int cpu = smp_processor_id();
+
+	if (last_VFP_context[cpu] == info)
+		last_VFP_context[cpu] = NULL;
+}
+
+/*
+ * Make sure no CPU refers to the VFP state of a thread which is being
+ * reinitialised or freed, so that it is neither saved to nor reloaded.
+ */
+static void vfp_thread_forget(union vfp_state *vfp)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		if (last_VFP_context[cpu] == vfp)
+			smp_call_function_single(cpu, vfp_ipi_drop, vfp, 1);
+}
 
 #ifdef CONFIG_SMP
-		/*
-		 * On SMP, if VFP is enabled, save the old state in
-		 * case the thread migrates to a different CPU. The
-		 * restoring is done lazily.
-		 */
-		if ((fpexc & FPEXC_EN) && last_VFP_context[cpu]) {
-			vfp_save_state(last_VFP_context[cpu], fpexc);
-			last_VFP_context[cpu]->hard.cpu = cpu;
-		}
-		/*
-		 * Thread migration, just force the reloading of the
-		 * state on the new CPU in case the VFP registers
-		 * contain stale data.
-		 */
-		if (thread->vfpstate.hard.cpu != cpu)
-			last_VFP_context[cpu] = NULL;
+/*
+ * Called from vfp_support_entry, with interrupts enabled, before the
+ * state of the current thread is loaded: if it is still live in the
+ * registers of the CPU it last ran on, have that CPU write it back.
+ */
+void vfp_fetch_state(union vfp_state *vfp)
+{
+	unsigned int cpu = vfp->hard.cpu;
+
+	if (cpu < NR_CPUS && cpu != smp_processor_id() &&
+	    last_VFP_context[cpu] == vfp)
+		smp_call_function_single(cpu, vfp_ipi_flush, vfp, 1);
+
+	/*
+	 * The other CPU saves the state before it stops pointing at it
+	 * (vfp_flush_hwstate() and vfp_support_entry): don't let the
+	 * reload read the state before the pointer.
+	 */
+	smp_mb();
+}
 #endif
 
+static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
+{
+	struct thread_info *thread = v;
+	union vfp_state *vfp;
+
+	if (likely(cmd == THREAD_NOTIFY_SWITCH)) {
 		/*
 		 * Always disable VFP so we can lazily save/restore the
-		 * old state.
+		 * old state.  This holds on SMP as well: if the thread
+		 * migrates, the new CPU fetches its state from the old
+		 * one when it first uses the VFP there.
 		 */
-		fmxr(FPEXC, fpexc & ~FPEXC_EN);
+		fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
 		return NOTIFY_DONE;
 	}
 
+	/* flush and release case: Per-thread VFP cleanup. */
 	vfp = &thread->vfpstate;
+	vfp_thread_forget(vfp);
+
 	if (cmd == THREAD_NOTIFY_FLUSH) {
 		/*
 		 * Per-thread VFP initialisation.
@@ -83,6 +156,9 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 
 		vfp->hard.fpexc = FPEXC_EN;
 		vfp->hard.fpscr = FPSCR_ROUND_NEAREST;
+#ifdef CONFIG_SMP
+		vfp->hard.cpu = NR_CPUS;
+#endif
 
 		/*
 		 * Disable VFP to ensure we initialise it first.
@@ -90,10 +166,6 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 		fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
 	}
 
-	/* flush and release case: Per-thread VFP cleanup. */
-	if (last_VFP_context[cpu] == vfp)
-		last_VFP_context[cpu] = NULL;
-
 	return NOTIFY_DONE;
 }
 
@@ -331,17 +403,11 @@ static void vfp_enable(void *unused)
 
 static int vfp_pm_suspend(struct sys_device *dev, pm_message_t state)
 {
-	struct thread_info *ti = current_thread_info();
-	u32 fpexc = fmrx(FPEXC);
-
-	/* if vfp is on, then save state for resumption */
-	if (fpexc & FPEXC_EN) {
-		printk(KERN_DEBUG "%s: saving vfp state\n", __func__);
-		vfp_save_state(&ti->vfpstate, fpexc);
+	/* save whatever state is still live for resumption */
+	vfp_flush_hwstate(smp_processor_id());
 
-		/* disable, just in case */
-		fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
-	}
+	/* disable, just in case */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
 
 	/* clear any information we had about last context state */
 	memset(last_VFP_context, 0, sizeof(last_VFP_context));
@@ -385,52 +451,121 @@ static inline void vfp_pm_init(void) { }
  * Synchronise the hardware VFP state of a thread other than current with the
  * saved one. This function is used by the ptrace mechanism.
  */
-#ifdef CONFIG_SMP
 void vfp_sync_state(struct thread_info *thread)
 {
+	union vfp_state *vfp = &thread->vfpstate;
+#ifdef CONFIG_SMP
+	unsigned int cpu = vfp->hard.cpu;
+
 	/*
-	 * On SMP systems, the VFP state is automatically saved at every
-	 * context switch. We mark the thread VFP state as belonging to a
-	 * non-existent CPU so that the saved one will be reloaded when
-	 * needed.
+	 * The state of a stopped thread may still be live on the CPU it
+	 * last ran on.  Once written back, mark it as belonging to a
+	 * non-existent CPU so that the saved one, which the caller may
+	 * modify, will be reloaded when needed.
 	 */
-	thread->vfpstate.hard.cpu = NR_CPUS;
-}
+	if (cpu < NR_CPUS && last_VFP_context[cpu] == vfp)
+		smp_call_function_single(cpu, vfp_ipi_flush, vfp, 1);
+	vfp->hard.cpu = NR_CPUS;
 #else
-void vfp_sync_state(struct thread_info *thread)
-{
-	unsigned int cpu = get_cpu();
-	u32 fpexc = fmrx(FPEXC);
+	unsigned long flags;
 
 	/*
-	 * If VFP is enabled, the previous state was already saved and
-	 * last_VFP_context updated.
+	 * Save the last VFP state on this CPU if it is the thread's, the
+	 * context is cleared to force a reload the next time the thread
+	 * uses the VFP.
 	 */
-	if (fpexc & FPEXC_EN)
-		goto out;
+	local_irq_save(flags);
+	vfp_ipi_flush(vfp);
+	local_irq_restore(flags);
+#endif
+}
 
-	if (!last_VFP_context[cpu])
-		goto out;
+/*
+ * A CPU going down takes its VFP registers with it: write back any
+ * state still held there.  A CPU coming up needs access to the VFP.
+ */
+static int vfp_hotplug(struct notifier_block *b, unsigned long action,
+		       void *hcpu)
+{
+	if (action == CPU_DYING || action == CPU_DYING_FROZEN)
+		vfp_flush_hwstate((long)hcpu);
+	else if (action == CPU_STARTING || action == CPU_STARTING_FROZEN)
+		vfp_enable(NULL);
+
+	return NOTIFY_OK;
+}
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+/*
+ * Kernel-side NEON support functions
+ */
+static DEFINE_PER_CPU(int, kernel_neon_active);
+
+void kernel_neon_begin(void)
+{
+	unsigned int cpu;
+	unsigned long flags;
 
 	/*
-	 * Save the last VFP state on this CPU.
+	 * Kernel mode NEON is only allowed outside of interrupt context
+	 * with preemption disabled. This will make sure that the kernel
+	 * mode NEON register contents never need to be preserved.
 	 */
-	fmxr(FPEXC, fpexc | FPEXC_EN);
-	vfp_save_state(last_VFP_context[cpu], fpexc);
-	fmxr(FPEXC, fpexc);
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+	BUG_ON(per_cpu(kernel_neon_active, cpu));
+	per_cpu(kernel_neon_active, cpu) = 1;
 
 	/*
-	 * Set the context to NULL to force a reload the next time the thread
-	 * uses the VFP.
+	 * Save the user space NEON/VFP state, whichever thread it belongs
+	 * to.  Interrupts are disabled so that no other CPU can fetch it
+	 * in the middle.
 	 */
-	last_VFP_context[cpu] = NULL;
+	local_irq_save(flags);
+	vfp_flush_hwstate(cpu);
+	local_irq_restore(flags);
+
+	fmxr(FPEXC, FPEXC_EN);
+}
+EXPORT_SYMBOL(kernel_neon_begin);
 
-out:
+void kernel_neon_end(void)
+{
+	/* Disable the NEON/VFP unit. */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	__get_cpu_var(kernel_neon_active) = 0;
 	put_cpu();
 }
-#endif
+EXPORT_SYMBOL(kernel_neon_end);
 
-#include <linux/smp.h>
+/*
+ * Whether kernel_neon_begin() may be called right now.  Code which
+ * runs both inside and outside of NEON sections, such as memcpy(),
+ * uses this to fall back to the integer unit.  A CPU in a NEON
+ * section cannot migrate, so the raw per-cpu read is safe.
+ */
+int kernel_neon_usable(void)
+{
+	return !in_interrupt() && !__raw_get_cpu_var(kernel_neon_active);
+}
+EXPORT_SYMBOL(kernel_neon_usable);
+
+/*
+ * Whether the VFP registers of this CPU hold no live user state, so that
+ * kernel_neon_begin() has nothing to save and the owner of the state
+ * will not take a trap to reload it.  Only a hint if the caller may be
+ * preempted.
+ */
+int kernel_neon_free(void)
+{
+	unsigned int cpu = raw_smp_processor_id();
+	union vfp_state *vfp = last_VFP_context[cpu];
+
+	return !vfp || !vfp_state_in_hw(cpu, vfp);
+}
+EXPORT_SYMBOL(kernel_neon_free);
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
 
 /*
  * VFP support code initialisation.
@@ -473,6 +608,7 @@ static int __init vfp_init(void)
 		vfp_vector = vfp_support_entry;
 
 		thread_register_notifier(&vfp_notifier_block);
+		hotcpu_notifier(vfp_hotplug, 0);
 		vfp_pm_init();
 
 		/*
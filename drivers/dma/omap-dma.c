@@ -0,0 +1,785 @@
+/*
+ * OMAP system DMA (sDMA) dmaengine driver
+ *
+ * Exposes the sDMA logical channels through the generic dmaengine API so
+ * that slave drivers, async_tx and dmatest can use the controller without
+ * the bespoke omap_request_dma()/omap_set_dma_*() sequence.
+ *
+ * Every dmaengine channel owns a pair of logical channels. While one of
+ * them executes the current block (a scatterlist entry, a cyclic period or
+ * a memcpy chunk) the other one is already programmed with the following
+ * block and hardware linked behind it, so back-to-back blocks and
+ * descriptors are started by the controller without waiting for the CPU.
+ * All register values are computed when a descriptor is prepared; the
+ * interrupt path only writes addresses and counts.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/interrupt.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include <linux/platform_device.h>
+
+#include <plat/dma.h>
+
+#define OMAP_DMA_CHANNELS	8
+
+/* CEN is 24 bits wide, CFN 16 bits */
+#define OMAP_DMA_MAX_EN		0xffffff
+#define OMAP_DMA_MAX_FN		0xffff
+
+#define OMAP_DMA_ERR_MASK	(OMAP2_DMA_TRANS_ERR_IRQ | \
+				 OMAP2_DMA_SECURE_ERR_IRQ | \
+				 OMAP2_DMA_SUPERVISOR_ERR_IRQ | \
+				 OMAP2_DMA_MISALIGNED_ERR_IRQ)
+
+struct omap_dma_block {
+	dma_addr_t		src;
+	dma_addr_t		dst;
+	u32			en;		/* elements per frame */
+	u32			fn;		/* frames per block */
+};
+
+struct omap_desc {
+	struct dma_async_tx_descriptor	txd;
+	struct list_head		node;
+
+	/* static channel setup, src_start/dst_start are left at zero */
+	struct omap_dma_channel_params	params;
+	enum omap_dma_burst_mode	burst;
+
+	unsigned int			cyclic:1;
+	unsigned int			nblocks;
+	struct omap_dma_block		blocks[0];
+};
+
+struct omap_chan {
+	struct dma_chan		chan;
+	struct omap_dmadev	*od;
+	spinlock_t		lock;
+
+	/* logical channels, lch[1] is -1 if chaining is unavailable */
+	int			lch[2];
+	int			cur;
+	struct omap_dma_channel_params loaded[2];
+	bool			valid[2];
+	/* lch[i] finished before lch[cur], its interrupt came first */
+	bool			done[2];
+
+	struct omap_dma_slave	*slave;
+
+	struct list_head	pending;	/* submitted, not issued */
+	struct list_head	issued;		/* issued, head is running */
+	struct list_head	completed;	/* waiting for callback */
+
+	/* block currently executed by lch[cur] */
+	struct omap_desc	*desc;
+	unsigned int		idx;
+	/* block armed on lch[cur ^ 1], if any */
+	struct omap_desc	*next_desc;
+	unsigned int		next_idx;
+
+	unsigned int		periods;	/* elapsed cyclic periods */
+	dma_cookie_t		completed_cookie;
+	struct tasklet_struct	tasklet;
+};
+
+struct omap_dmadev {
+	struct dma_device	ddev;
+	struct omap_chan	chan[OMAP_DMA_CHANNELS];
+};
+
+static inline struct omap_chan *to_omap_chan(struct dma_chan *chan)
+{
+	return container_of(chan, struct omap_chan, chan);
+}
+
+static inline struct omap_desc *to_omap_desc(struct dma_async_tx_descriptor *t)
+{
+	return container_of(t, struct omap_desc, txd);
+}
+
+static struct device *chan2dev(struct dma_chan *chan)
+{
+	return &chan->dev->device;
+}
+
+/*
+ * Find the block following (*d, *idx): the next one of the same descriptor,
+ * the first one again for cyclic transfers, or the first one of the next
+ * issued descriptor.
+ */
+static bool omap_dma_next_block(struct omap_chan *c, struct omap_desc **d,
+				unsigned int *idx)
+{
+	if (*idx + 1 < (*d)->nblocks) {
+		(*idx)++;
+		return true;
+	}
+
+	if ((*d)->cyclic) {
+		*idx = 0;
+		return true;
+	}
+
+	if (list_is_last(&(*d)->node, &c->issued))
+		return false;
+
+	*d = list_entry((*d)->node.next, struct omap_desc, node);
+	*idx = 0;
+
+	return true;
+}
+
+/* Program lch[i] for block idx of d, skipping the static setup if unchanged */
+static void omap_dma_load(struct omap_chan *c, int i, struct omap_desc *d,
+			  unsigned int idx)
+{
+	struct omap_dma_block *b = &d->blocks[idx];
+	int lch = c->lch[i];
+
+	if (!c->valid[i] ||
+	    memcmp(&c->loaded[i], &d->params, sizeof(d->params))) {
+		omap_set_dma_params(lch, &d->params);
+		omap_set_dma_src_burst_mode(lch, d->burst);
+		omap_set_dma_dest_burst_mode(lch, d->burst);
+		omap_set_dma_src_data_pack(lch, 1);
+		omap_set_dma_dest_data_pack(lch, 1);
+		memcpy(&c->loaded[i], &d->params, sizeof(d->params));
+		c->valid[i] = true;
+	}
+
+	omap_set_dma_xfer(lch, b->src, b->dst, b->en, b->fn);
+}
+
+/* Queue the block following the running one on the idle logical channel */
+static void omap_dma_arm_next(struct omap_chan *c)
+{
+	struct omap_desc *d = c->desc;
+	unsigned int idx = c->idx;
+	int next = c->cur ^ 1;
+
+	if (!d || c->next_desc || c->lch[next] < 0)
+		return;
+
+	if (!omap_dma_next_block(c, &d, &idx))
+		return;
+
+	omap_dma_load(c, next, d, idx);
+	c->next_desc = d;
+	c->next_idx = idx;
+
+	/* the running block may have finished while we were programming */
+	if (omap_dma_hw_link_lch(c->lch[c->cur], c->lch[next]))
+		omap_start_dma(c->lch[next]);
+}
+
+static void omap_dma_start(struct omap_chan *c)
+{
+	if (c->desc || list_empty(&c->issued))
+		return;
+
+	c->desc = list_first_entry(&c->issued, struct omap_desc, node);
+	c->idx = 0;
+
+	omap_dma_load(c, c->cur, c->desc, 0);
+	omap_start_dma(c->lch[c->cur]);
+
+	omap_dma_arm_next(c);
+}
+
+/* lch[cur] finished its block, move on to the following one */
+static void omap_dma_block_done(struct omap_chan *c)
+{
+	struct omap_desc *d = c->desc, *nd;
+	unsigned int idx = c->idx, nidx;
+	int lch = c->lch[c->cur];
+
+	if (c->next_desc) {
+		/* the controller already moved on to the armed block */
+		omap_dma_hw_unlink_lch(lch);
+		c->cur ^= 1;
+		c->desc = c->next_desc;
+		c->idx = c->next_idx;
+		c->next_desc = NULL;
+	} else {
+		nd = d;
+		nidx = idx;
+		c->desc = NULL;
+		if (omap_dma_next_block(c, &nd, &nidx)) {
+			omap_dma_load(c, c->cur, nd, nidx);
+			omap_start_dma(lch);
+			c->desc = nd;
+			c->idx = nidx;
+		}
+	}
+
+	if (d->cyclic) {
+		c->periods++;
+		tasklet_schedule(&c->tasklet);
+	} else if (idx == d->nblocks - 1) {
+		c->completed_cookie = d->txd.cookie;
+		list_move_tail(&d->node, &c->completed);
+		tasklet_schedule(&c->tasklet);
+	}
+}
+
+static void omap_dma_callback(int lch, u16 ch_status, void *data)
+{
+	struct omap_chan *c = data;
+	unsigned long flags;
+	int i = lch == c->lch[1];
+
+	spin_lock_irqsave(&c->lock, flags);
+
+	/* stale interrupt of a terminated transfer */
+	if (!c->desc)
+		goto out;
+
+	if (unlikely(ch_status & OMAP_DMA_ERR_MASK))
+		dev_err(chan2dev(&c->chan), "lch %d error status 0x%04x\n",
+			lch, ch_status);
+
+	/*
+	 * The armed block only runs once lch[cur] is done, so both have
+	 * completed and the handler, which goes through the logical
+	 * channels in ascending order, calls us for lch[cur] next.
+	 */
+	if (i != c->cur) {
+		if (c->next_desc)
+			c->done[i] = true;
+		goto out;
+	}
+
+	for (;;) {
+		omap_dma_block_done(c);
+		if (!c->desc || !c->done[c->cur])
+			break;
+		c->done[c->cur] = false;
+	}
+
+	omap_dma_arm_next(c);
+out:
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+static void omap_dma_tasklet(unsigned long data)
+{
+	struct omap_chan *c = (struct omap_chan *)data;
+	dma_async_tx_callback callback;
+	void *param;
+	struct omap_desc *d;
+	LIST_HEAD(list);
+
+	spin_lock_irq(&c->lock);
+	list_splice_tail_init(&c->completed, &list);
+	spin_unlock_irq(&c->lock);
+
+	while (!list_empty(&list)) {
+		d = list_first_entry(&list, struct omap_desc, node);
+		list_del(&d->node);
+		if (d->txd.callback)
+			d->txd.callback(d->txd.callback_param);
+		dma_run_dependencies(&d->txd);
+		kfree(d);
+	}
+
+	for (;;) {
+		spin_lock_irq(&c->lock);
+		d = c->desc;
+		if (!c->periods || !d || !d->cyclic) {
+			c->periods = 0;
+			spin_unlock_irq(&c->lock);
+			break;
+		}
+		c->periods--;
+		callback = d->txd.callback;
+		param = d->txd.callback_param;
+		spin_unlock_irq(&c->lock);
+
+		if (callback)
+			callback(param);
+	}
+}
+
+static dma_cookie_t omap_dma_tx_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct omap_chan *c = to_omap_chan(tx->chan);
+	struct omap_desc *d = to_omap_desc(tx);
+	dma_cookie_t cookie;
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+
+	cookie = c->chan.cookie + 1;
+	if (cookie < 0)
+		cookie = 1;
+	c->chan.cookie = cookie;
+	tx->cookie = cookie;
+
+	list_add_tail(&d->node, &c->pending);
+
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	return cookie;
+}
+
+static struct omap_desc *omap_dma_alloc_desc(struct omap_chan *c,
+					     unsigned int nblocks,
+					     unsigned long flags)
+{
+	struct omap_desc *d;
+
+	d = kzalloc(sizeof(*d) + nblocks * sizeof(d->blocks[0]), GFP_ATOMIC);
+	if (!d)
+		return NULL;
+
+	dma_async_tx_descriptor_init(&d->txd, &c->chan);
+	d->txd.tx_submit = omap_dma_tx_submit;
+	d->txd.flags = flags;
+	INIT_LIST_HEAD(&d->node);
+
+	return d;
+}
+
+static void omap_dma_free_list(struct list_head *list)
+{
+	struct omap_desc *d, *tmp;
+
+	list_for_each_entry_safe(d, tmp, list, node) {
+		list_del(&d->node);
+		kfree(d);
+	}
+}
+
+/* Element size in bytes for an OMAP_DMA_DATA_TYPE_* value */
+static inline unsigned int omap_dma_es(int data_type)
+{
+	return 1 << data_type;
+}
+
+/*
+ * Number of blocks needed to move len bytes to or from the slave, or 0 if
+ * len does not match the slave's element/frame layout.
+ */
+static unsigned int omap_dma_slave_nblocks(struct omap_dma_slave *s,
+					   size_t len)
+{
+	unsigned int es = omap_dma_es(s->data_type);
+	size_t flen;
+
+	if (s->sync_mode == OMAP_DMA_SYNC_FRAME) {
+		flen = s->frame_len * es;
+		if (!flen || len % flen)
+			return 0;
+		return DIV_ROUND_UP(len / flen, OMAP_DMA_MAX_FN);
+	}
+
+	if (len % es)
+		return 0;
+
+	return DIV_ROUND_UP(len / es, OMAP_DMA_MAX_EN);
+}
+
+/*
+ * Split len bytes at mem into blocks for the slave starting at b. Returns
+ * the number of blocks filled in.
+ */
+static unsigned int omap_dma_slave_fill(struct omap_dma_slave *s,
+					enum dma_data_direction dir,
+					struct omap_dma_block *b,
+					dma_addr_t mem, size_t len)
+{
+	unsigned int es = omap_dma_es(s->data_type);
+	unsigned int n = 0;
+	size_t chunk;
+
+	while (len) {
+		if (s->sync_mode == OMAP_DMA_SYNC_FRAME) {
+			chunk = min_t(size_t, len,
+				      s->frame_len * es * OMAP_DMA_MAX_FN);
+			b->en = s->frame_len;
+			b->fn = chunk / (s->frame_len * es);
+		} else {
+			chunk = min_t(size_t, len, OMAP_DMA_MAX_EN * es);
+			b->en = chunk / es;
+			b->fn = 1;
+		}
+
+		if (dir == DMA_TO_DEVICE) {
+			b->src = mem;
+			b->dst = s->dev_addr;
+		} else {
+			b->src = s->dev_addr;
+			b->dst = mem;
+		}
+
+		mem += chunk;
+		len -= chunk;
+		b++;
+		n++;
+	}
+
+	return n;
+}
+
+static void omap_dma_slave_params(struct omap_dma_slave *s,
+				  enum dma_data_direction dir,
+				  struct omap_desc *d)
+{
+	struct omap_dma_channel_params *p = &d->params;
+
+	p->data_type = s->data_type;
+	p->trigger = s->dma_req;
+	p->sync_mode = s->sync_mode;
+	if (dir == DMA_TO_DEVICE) {
+		p->src_amode = OMAP_DMA_AMODE_POST_INC;
+		p->dst_amode = OMAP_DMA_AMODE_CONSTANT;
+		p->src_or_dst_synch = OMAP_DMA_DST_SYNC;
+	} else {
+		p->src_amode = OMAP_DMA_AMODE_CONSTANT;
+		p->dst_amode = OMAP_DMA_AMODE_POST_INC;
+		p->src_or_dst_synch = OMAP_DMA_SRC_SYNC;
+	}
+	d->burst = s->burst_mode;
+}
+
+static struct dma_async_tx_descriptor *omap_dma_prep_slave_sg(
+	struct dma_chan *chan, struct scatterlist *sgl, unsigned int sg_len,
+	enum dma_data_direction direction, unsigned long flags)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	struct omap_dma_slave *s = c->slave;
+	struct scatterlist *sg;
+	struct omap_desc *d;
+	unsigned int i, n, nblocks = 0;
+
+	if (!s || !sg_len || direction == DMA_BIDIRECTIONAL)
+		return NULL;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		n = omap_dma_slave_nblocks(s, sg_dma_len(sg));
+		if (!n) {
+			dev_err(chan2dev(chan), "bad sg length %u\n",
+				sg_dma_len(sg));
+			return NULL;
+		}
+		nblocks += n;
+	}
+
+	d = omap_dma_alloc_desc(c, nblocks, flags);
+	if (!d)
+		return NULL;
+
+	omap_dma_slave_params(s, direction, d);
+
+	for_each_sg(sgl, sg, sg_len, i)
+		d->nblocks += omap_dma_slave_fill(s, direction,
+						  &d->blocks[d->nblocks],
+						  sg_dma_address(sg),
+						  sg_dma_len(sg));
+
+	return &d->txd;
+}
+
+static struct dma_async_tx_descriptor *omap_dma_prep_dma_cyclic(
+	struct dma_chan *chan, dma_addr_t buf_addr, size_t buf_len,
+	size_t period_len, enum dma_data_direction direction)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	struct omap_dma_slave *s = c->slave;
+	struct omap_desc *d;
+	unsigned int i, periods;
+
+	if (!s || !period_len || buf_len % period_len ||
+	    direction == DMA_BIDIRECTIONAL)
+		return NULL;
+
+	/* every period has to be a single block to get one irq per period */
+	if (omap_dma_slave_nblocks(s, period_len) != 1)
+		return NULL;
+
+	periods = buf_len / period_len;
+	d = omap_dma_alloc_desc(c, periods, DMA_PREP_INTERRUPT);
+	if (!d)
+		return NULL;
+
+	omap_dma_slave_params(s, direction, d);
+	d->cyclic = 1;
+
+	for (i = 0; i < periods; i++)
+		omap_dma_slave_fill(s, direction, &d->blocks[i],
+				    buf_addr + i * period_len, period_len);
+	d->nblocks = periods;
+
+	return &d->txd;
+}
+
+static struct dma_async_tx_descriptor *omap_dma_prep_dma_memcpy(
+	struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
+	size_t len, unsigned long flags)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	struct omap_dma_channel_params *p;
+	struct omap_desc *d;
+	unsigned int i, es, nblocks;
+	int data_type;
+	size_t chunk;
+
+	if (!len)
+		return NULL;
+
+	if (!((dest | src | len) & 3))
+		data_type = OMAP_DMA_DATA_TYPE_S32;
+	else if (!((dest | src | len) & 1))
+		data_type = OMAP_DMA_DATA_TYPE_S16;
+	else
+		data_type = OMAP_DMA_DATA_TYPE_S8;
+	es = omap_dma_es(data_type);
+
+	nblocks = DIV_ROUND_UP(len / es, OMAP_DMA_MAX_EN);
+	d = omap_dma_alloc_desc(c, nblocks, flags);
+	if (!d)
+		return NULL;
+
+	p = &d->params;
+	p->data_type = data_type;
+	p->src_amode = OMAP_DMA_AMODE_POST_INC;
+	p->dst_amode = OMAP_DMA_AMODE_POST_INC;
+	p->sync_mode = OMAP_DMA_SYNC_ELEMENT;
+	d->burst = OMAP_DMA_DATA_BURST_16;
+
+	for (i = 0; i < nblocks; i++) {
+		chunk = min_t(size_t, len, OMAP_DMA_MAX_EN * es);
+		d->blocks[i].src = src;
+		d->blocks[i].dst = dest;
+		d->blocks[i].en = chunk / es;
+		d->blocks[i].fn = 1;
+		src += chunk;
+		dest += chunk;
+		len -= chunk;
+	}
+	d->nblocks = nblocks;
+
+	return &d->txd;
+}
+
+static void omap_dma_issue_pending(struct dma_chan *chan)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->lock, flags);
+	if (!list_empty(&c->pending)) {
+		list_splice_tail_init(&c->pending, &c->issued);
+		if (c->desc)
+			omap_dma_arm_next(c);
+		else
+			omap_dma_start(c);
+	}
+	spin_unlock_irqrestore(&c->lock, flags);
+}
+
+static void omap_dma_terminate_all(struct dma_chan *chan)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	unsigned long flags;
+	LIST_HEAD(list);
+	int i;
+
+	spin_lock_irqsave(&c->lock, flags);
+
+	for (i = 0; i < 2; i++) {
+		if (c->lch[i] < 0)
+			continue;
+		omap_dma_hw_unlink_lch(c->lch[i]);
+		omap_stop_dma(c->lch[i]);
+	}
+
+	c->desc = NULL;
+	c->next_desc = NULL;
+	c->done[0] = c->done[1] = false;
+	c->periods = 0;
+	list_splice_tail_init(&c->pending, &list);
+	list_splice_tail_init(&c->issued, &list);
+	/* no callbacks after termination */
+	list_splice_tail_init(&c->completed, &list);
+
+	spin_unlock_irqrestore(&c->lock, flags);
+
+	omap_dma_free_list(&list);
+}
+
+static enum dma_status omap_dma_is_tx_complete(struct dma_chan *chan,
+		dma_cookie_t cookie, dma_cookie_t *done, dma_cookie_t *used)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	dma_cookie_t last_used, last_complete;
+
+	last_used = chan->cookie;
+	last_complete = c->completed_cookie;
+
+	if (done)
+		*done = last_complete;
+	if (used)
+		*used = last_used;
+
+	return dma_async_is_complete(cookie, last_complete, last_used);
+}
+
+static int omap_dma_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	struct omap_dma_slave *s = chan->private;
+	int dma_req = s ? s->dma_req : OMAP_DMA_NO_DEVICE;
+	int ret;
+
+	ret = omap_request_dma(dma_req, dev_name(c->od->ddev.dev),
+			       omap_dma_callback, c, &c->lch[0]);
+	if (ret)
+		return ret;
+
+	/* without a second logical channel we just restart per block */
+	if (omap_request_dma(dma_req, dev_name(c->od->ddev.dev),
+			     omap_dma_callback, c, &c->lch[1]))
+		c->lch[1] = -1;
+
+	c->slave = s;
+	c->cur = 0;
+	c->valid[0] = c->valid[1] = false;
+	c->completed_cookie = chan->cookie = 1;
+
+	dev_dbg(chan2dev(chan), "allocated lch %d/%d for request %d\n",
+		c->lch[0], c->lch[1], dma_req);
+
+	return 0;
+}
+
+static void omap_dma_free_chan_resources(struct dma_chan *chan)
+{
+	struct omap_chan *c = to_omap_chan(chan);
+	int i;
+
+	omap_dma_terminate_all(chan);
+	tasklet_kill(&c->tasklet);
+	omap_dma_free_list(&c->completed);
+
+	for (i = 0; i < 2; i++) {
+		if (c->lch[i] >= 0)
+			omap_free_dma(c->lch[i]);
+		c->lch[i] = -1;
+	}
+	c->slave = NULL;
+}
+
+/**
+ * omap_dma_filter_fn - dma_request_channel() filter for slave channels
+ * @chan: candidate channel
+ * @param: struct omap_dma_slave describing the peripheral
+ */
+bool omap_dma_filter_fn(struct dma_chan *chan, void *param)
+{
+	if (chan->device->dev->driver->owner != THIS_MODULE)
+		return false;
+
+	chan->private = param;
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(omap_dma_filter_fn);
+
+static int __devinit omap_dma_probe(struct platform_device *pdev)
+{
+	struct omap_dmadev *od;
+	struct omap_chan *c;
+	int i, ret;
+
+	od = kzalloc(sizeof(*od), GFP_KERNEL);
+	if (!od)
+		return -ENOMEM;
+
+	dma_cap_set(DMA_SLAVE, od->ddev.cap_mask);
+	dma_cap_set(DMA_CYCLIC, od->ddev.cap_mask);
+	dma_cap_set(DMA_MEMCPY, od->ddev.cap_mask);
+	od->ddev.device_alloc_chan_resources = omap_dma_alloc_chan_resources;
+	od->ddev.device_free_chan_resources = omap_dma_free_chan_resources;
+	od->ddev.device_prep_slave_sg = omap_dma_prep_slave_sg;
+	od->ddev.device_prep_dma_cyclic = omap_dma_prep_dma_cyclic;
+	od->ddev.device_prep_dma_memcpy = omap_dma_prep_dma_memcpy;
+	od->ddev.device_terminate_all = omap_dma_terminate_all;
+	od->ddev.device_is_tx_complete = omap_dma_is_tx_complete;
+	od->ddev.device_issue_pending = omap_dma_issue_pending;
+	od->ddev.dev = &pdev->dev;
+	INIT_LIST_HEAD(&od->ddev.channels);
+
+	for (i = 0; i < OMAP_DMA_CHANNELS; i++) {
+		c = &od->chan[i];
+		c->od = od;
+		c->chan.device = &od->ddev;
+		c->lch[0] = c->lch[1] = -1;
+		spin_lock_init(&c->lock);
+		INIT_LIST_HEAD(&c->pending);
+		INIT_LIST_HEAD(&c->issued);
+		INIT_LIST_HEAD(&c->completed);
+		tasklet_init(&c->tasklet, omap_dma_tasklet, (unsigned long)c);
+		list_add_tail(&c->chan.device_node, &od->ddev.channels);
+	}
+	od->ddev.chancnt = OMAP_DMA_CHANNELS;
+
+	ret = dma_async_device_register(&od->ddev);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to register dma device: %d\n", ret);
+		kfree(od);
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, od);
+	dev_info(&pdev->dev, "OMAP DMA engine driver, %d channels\n",
+		 OMAP_DMA_CHANNELS);
+
+	return 0;
+}
+
+static int __devexit omap_dma_remove(struct platform_device *pdev)
+{
+	struct omap_dmadev *od = platform_get_drvdata(pdev);
+
+	dma_async_device_unregister(&od->ddev);
+	kfree(od);
+
+	return 0;
+}
+
+static struct platform_driver omap_dma_driver = {
+	.probe	= omap_dma_probe,
+	.remove	= __devexit_p(omap_dma_remove),
+	.driver = {
+		.name	= "omap-dma-engine",
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init omap_dma_init(void)
+{
+	return platform_driver_register(&omap_dma_driver);
+}
+subsys_initcall(omap_dma_init);
+
+static void __exit omap_dma_exit(void)
+{
+	platform_driver_unregister(&omap_dma_driver);
+}
+module_exit(omap_dma_exit);
+
+MODULE_DESCRIPTION("OMAP system DMA dmaengine driver");
+MODULE_LICENSE("GPL");
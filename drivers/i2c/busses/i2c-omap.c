@@ -37,6 +37,10 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/dma-mapping.h>
+#include <linux/workqueue.h>
+
+#include <plat/dma.h>
 
 /* I2C controller revisions */
 #define OMAP_I2C_REV_2			0x20
@@ -48,6 +52,20 @@
 /* timeout waiting for the controller to respond */
 #define OMAP_I2C_TIMEOUT (msecs_to_jiffies(1000))
 
+/* a STOP is out within a few bit times, poll that long before sleeping */
+#define OMAP_I2C_BB_SPIN_US		100
+
+/* keep the clocks on that long after a transfer, for the next one */
+#define OMAP_I2C_IDLE_DELAY		(msecs_to_jiffies(10))
+
+/*
+ * Messages at least that long go by DMA, if the bus has it.  Shorter
+ * ones take no more than a couple of fifo interrupts anyway.  DMA goes
+ * through a bounce buffer, as i2c clients commonly use stack buffers.
+ */
+#define OMAP_I2C_DMA_MIN_LEN		32
+#define OMAP_I2C_DMA_BUF_SIZE		PAGE_SIZE
+
 #define OMAP_I2C_REV_REG		0x00
 #define OMAP_I2C_IE_REG			0x04
 #define OMAP_I2C_STAT_REG		0x08
@@ -77,6 +95,13 @@
 #define OMAP_I2C_IE_NACK	(1 << 1)	/* No ack interrupt enable */
 #define OMAP_I2C_IE_AL		(1 << 0)	/* Arbitration lost int ena */
 
+#define OMAP_I2C_IE_DMA		(OMAP_I2C_IE_ARDY | OMAP_I2C_IE_NACK | \
+				OMAP_I2C_IE_AL)
+#define OMAP_I2C_IE_PIO		(OMAP_I2C_IE_DMA | OMAP_I2C_IE_XRDY | \
+				OMAP_I2C_IE_RRDY)
+#define OMAP_I2C_IE_FIFO	(OMAP_I2C_IE_PIO | OMAP_I2C_IE_RDR | \
+				OMAP_I2C_IE_XDR)
+
 /* I2C Status Register (OMAP_I2C_STAT): */
 #define OMAP_I2C_STAT_XDR	(1 << 14)	/* TX Buffer draining */
 #define OMAP_I2C_STAT_RDR	(1 << 13)	/* RX Buffer draining */
@@ -112,8 +137,10 @@
 /* I2C Buffer Configuration Register (OMAP_I2C_BUF): */
 #define OMAP_I2C_BUF_RDMA_EN	(1 << 15)	/* RX DMA channel enable */
 #define OMAP_I2C_BUF_RXFIF_CLR	(1 << 14)	/* RX FIFO Clear */
+#define OMAP_I2C_BUF_RTRSH_MASK	(0x3f << 8)	/* RX FIFO threshold */
 #define OMAP_I2C_BUF_XDMA_EN	(1 << 7)	/* TX DMA channel enable */
 #define OMAP_I2C_BUF_TXFIF_CLR	(1 << 6)	/* TX FIFO Clear */
+#define OMAP_I2C_BUF_XTRSH_MASK	(0x3f << 0)	/* TX FIFO threshold */
 
 /* I2C Configuration Register (OMAP_I2C_CON): */
 #define OMAP_I2C_CON_EN		(1 << 15)	/* I2C module enable */
@@ -172,12 +199,25 @@ struct omap_i2c_dev {
 	struct i2c_adapter	adapter;
 	u8			fifo_size;	/* use as flag and value
 						 * fifo_size==0 implies no fifo
-						 * if set, should be trsh+1
+						 * if set, largest trsh+1
 						 */
+	u8			threshold;	/* trsh+1 of current msg */
 	u8			rev;
 	unsigned		b_hw:1;		/* bad h/w fixes */
 	unsigned		idle:1;
+	unsigned		dma_active:1;	/* current msg goes by DMA */
 	u16			iestate;	/* Saved interrupt register */
+	struct delayed_work	idle_work;
+
+	/* DMA; a channel is -1 if not used */
+	u32			phys_base;
+	int			dma_rx_req;
+	int			dma_tx_req;
+	int			dma_rx_ch;
+	int			dma_tx_ch;
+	u8			*dma_buf;	/* bounce buffer */
+	dma_addr_t		dma_phys;
+	struct completion	dma_done;
 };
 
 static inline void omap_i2c_write_reg(struct omap_i2c_dev *i2c_dev,
@@ -256,6 +296,14 @@ static void omap_i2c_idle(struct omap_i2c_dev *dev)
 	clk_disable(dev->iclk);
 }
 
+static void omap_i2c_idle_work(struct work_struct *work)
+{
+	struct omap_i2c_dev *dev = container_of(work, struct omap_i2c_dev,
+						idle_work.work);
+
+	omap_i2c_idle(dev);
+}
+
 static int omap_i2c_init(struct omap_i2c_dev *dev)
 {
 	u16 psc = 0, scll = 0, sclh = 0;
@@ -394,23 +442,22 @@ static int omap_i2c_init(struct omap_i2c_dev *dev)
 	omap_i2c_write_reg(dev, OMAP_I2C_SCLL_REG, scll);
 	omap_i2c_write_reg(dev, OMAP_I2C_SCLH_REG, sclh);
 
-	if (dev->fifo_size)
+	if (dev->fifo_size) {
 		/* Note: setup required fifo size - 1 */
+		dev->threshold = dev->fifo_size;
 		omap_i2c_write_reg(dev, OMAP_I2C_BUF_REG,
 					(dev->fifo_size - 1) << 8 | /* RTRSH */
 					OMAP_I2C_BUF_RXFIF_CLR |
 					(dev->fifo_size - 1) | /* XTRSH */
 					OMAP_I2C_BUF_TXFIF_CLR);
+	}
 
 	/* Take the I2C module out of reset: */
 	omap_i2c_write_reg(dev, OMAP_I2C_CON_REG, OMAP_I2C_CON_EN);
 
 	/* Enable interrupts */
-	omap_i2c_write_reg(dev, OMAP_I2C_IE_REG,
-			(OMAP_I2C_IE_XRDY | OMAP_I2C_IE_RRDY |
-			OMAP_I2C_IE_ARDY | OMAP_I2C_IE_NACK |
-			OMAP_I2C_IE_AL)  | ((dev->fifo_size) ?
-				(OMAP_I2C_IE_RDR | OMAP_I2C_IE_XDR) : 0));
+	omap_i2c_write_reg(dev, OMAP_I2C_IE_REG, (dev->fifo_size) ?
+			   OMAP_I2C_IE_FIFO : OMAP_I2C_IE_PIO);
 	return 0;
 }
 
@@ -420,6 +467,7 @@ static int omap_i2c_init(struct omap_i2c_dev *dev)
 static int omap_i2c_wait_for_bb(struct omap_i2c_dev *dev)
 {
 	unsigned long timeout;
+	int spin = OMAP_I2C_BB_SPIN_US;
 
 	timeout = jiffies + OMAP_I2C_TIMEOUT;
 	while (omap_i2c_read_reg(dev, OMAP_I2C_STAT_REG) & OMAP_I2C_STAT_BB) {
@@ -427,12 +475,186 @@ static int omap_i2c_wait_for_bb(struct omap_i2c_dev *dev)
 			dev_warn(dev->dev, "timeout waiting for bus ready\n");
 			return -ETIMEDOUT;
 		}
-		msleep(1);
+		if (spin) {
+			spin--;
+			udelay(1);
+		} else
+			msleep(1);
 	}
 
 	return 0;
 }
 
+/*
+ * Set the fifo thresholds for a message.  A threshold of the message
+ * size moves it in a single interrupt; longer ones take one every
+ * fifo_size bytes and end with the draining interrupt.  DMA is fed one
+ * byte per request.
+ */
+static void omap_i2c_resize_fifo(struct omap_i2c_dev *dev, struct i2c_msg *msg)
+{
+	u16 w;
+
+	w = omap_i2c_read_reg(dev, OMAP_I2C_BUF_REG);
+	w |= OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR;
+
+	if (dev->fifo_size) {
+		if (dev->dma_active)
+			dev->threshold = 1;
+		else
+			dev->threshold = clamp_t(u16, msg->len, 1,
+						 dev->fifo_size);
+
+		w &= ~(OMAP_I2C_BUF_RTRSH_MASK | OMAP_I2C_BUF_XTRSH_MASK |
+		       OMAP_I2C_BUF_RDMA_EN | OMAP_I2C_BUF_XDMA_EN);
+		if (msg->flags & I2C_M_RD) {
+			w |= (dev->threshold - 1) << 8;
+			if (dev->dma_active)
+				w |= OMAP_I2C_BUF_RDMA_EN;
+		} else {
+			w |= dev->threshold - 1;
+			if (dev->dma_active)
+				w |= OMAP_I2C_BUF_XDMA_EN;
+		}
+	}
+
+	omap_i2c_write_reg(dev, OMAP_I2C_BUF_REG, w);
+}
+
+static void omap_i2c_dma_cb(int lch, u16 ch_status, void *data)
+{
+	struct omap_i2c_dev *dev = data;
+
+	complete(&dev->dma_done);
+}
+
+static int omap_i2c_use_dma(struct omap_i2c_dev *dev, struct i2c_msg *msg)
+{
+	if (!dev->dma_buf || msg->len < OMAP_I2C_DMA_MIN_LEN ||
+	    msg->len > OMAP_I2C_DMA_BUF_SIZE)
+		return 0;
+
+	if (msg->flags & I2C_M_RD)
+		return dev->dma_rx_ch >= 0;
+
+	return dev->dma_tx_ch >= 0;
+}
+
+static void omap_i2c_dma_start(struct omap_i2c_dev *dev, struct i2c_msg *msg)
+{
+	u32 data = dev->phys_base + OMAP_I2C_DATA_REG;
+	int ch;
+
+	init_completion(&dev->dma_done);
+
+	if (msg->flags & I2C_M_RD) {
+		ch = dev->dma_rx_ch;
+		omap_set_dma_transfer_params(ch, OMAP_DMA_DATA_TYPE_S8, 1,
+					     msg->len, OMAP_DMA_SYNC_ELEMENT,
+					     dev->dma_rx_req,
+					     OMAP_DMA_SRC_SYNC);
+		omap_set_dma_src_params(ch, 0, OMAP_DMA_AMODE_CONSTANT,
+					data, 0, 0);
+		omap_set_dma_dest_params(ch, 0, OMAP_DMA_AMODE_POST_INC,
+					 dev->dma_phys, 0, 0);
+	} else {
+		ch = dev->dma_tx_ch;
+		memcpy(dev->dma_buf, msg->buf, msg->len);
+		omap_set_dma_transfer_params(ch, OMAP_DMA_DATA_TYPE_S8, 1,
+					     msg->len, OMAP_DMA_SYNC_ELEMENT,
+					     dev->dma_tx_req,
+					     OMAP_DMA_DST_SYNC);
+		omap_set_dma_src_params(ch, 0, OMAP_DMA_AMODE_POST_INC,
+					dev->dma_phys, 0, 0);
+		omap_set_dma_dest_params(ch, 0, OMAP_DMA_AMODE_CONSTANT,
+					 data, 0, 0);
+	}
+
+	omap_start_dma(ch);
+}
+
+/*
+ * The message is over on the bus: for a read, the last bytes may still
+ * be on their way out of the fifo.
+ */
+static int omap_i2c_dma_finish(struct omap_i2c_dev *dev, struct i2c_msg *msg,
+			       int ok)
+{
+	int rx = msg->flags & I2C_M_RD;
+	int r = 0;
+	u16 w;
+
+	if (ok && rx && !wait_for_completion_timeout(&dev->dma_done,
+						     OMAP_I2C_TIMEOUT)) {
+		dev_err(dev->dev, "rx dma timed out\n");
+		r = -ETIMEDOUT;
+	}
+
+	omap_stop_dma(rx ? dev->dma_rx_ch : dev->dma_tx_ch);
+
+	w = omap_i2c_read_reg(dev, OMAP_I2C_BUF_REG);
+	w &= ~(OMAP_I2C_BUF_RDMA_EN | OMAP_I2C_BUF_XDMA_EN);
+	omap_i2c_write_reg(dev, OMAP_I2C_BUF_REG, w);
+
+	if (ok && rx && !r)
+		memcpy(msg->buf, dev->dma_buf, msg->len);
+
+	dev->dma_active = 0;
+	return r;
+}
+
+static void __init omap_i2c_dma_init(struct omap_i2c_dev *dev,
+				     struct platform_device *pdev)
+{
+	struct resource *rx, *tx;
+
+	dev->dma_rx_ch = -1;
+	dev->dma_tx_ch = -1;
+
+	rx = platform_get_resource(pdev, IORESOURCE_DMA, 0);
+	tx = platform_get_resource(pdev, IORESOURCE_DMA, 1);
+	if (!dev->fifo_size || !rx || !rx->start)
+		return;
+
+	dev->dma_buf = dma_alloc_coherent(dev->dev, OMAP_I2C_DMA_BUF_SIZE,
+					  &dev->dma_phys, GFP_KERNEL);
+	if (!dev->dma_buf)
+		return;
+
+	dev->dma_rx_req = rx->start;
+	if (omap_request_dma(dev->dma_rx_req, "I2C rx", omap_i2c_dma_cb, dev,
+			     &dev->dma_rx_ch))
+		dev->dma_rx_ch = -1;
+
+	/* OMAP3430 Errata 1.153 has the cpu pace tx, see the isr */
+	if (tx && tx->start && dev->rev > OMAP_I2C_REV_ON_3430) {
+		dev->dma_tx_req = tx->start;
+		if (omap_request_dma(dev->dma_tx_req, "I2C tx",
+				     omap_i2c_dma_cb, dev, &dev->dma_tx_ch))
+			dev->dma_tx_ch = -1;
+	}
+
+	if (dev->dma_rx_ch < 0 && dev->dma_tx_ch < 0) {
+		dma_free_coherent(dev->dev, OMAP_I2C_DMA_BUF_SIZE,
+				  dev->dma_buf, dev->dma_phys);
+		dev->dma_buf = NULL;
+	}
+}
+
+static void omap_i2c_dma_free(struct omap_i2c_dev *dev)
+{
+	if (!dev->dma_buf)
+		return;
+
+	if (dev->dma_rx_ch >= 0)
+		omap_free_dma(dev->dma_rx_ch);
+	if (dev->dma_tx_ch >= 0)
+		omap_free_dma(dev->dma_tx_ch);
+	dma_free_coherent(dev->dev, OMAP_I2C_DMA_BUF_SIZE, dev->dma_buf,
+			  dev->dma_phys);
+	dev->dma_buf = NULL;
+}
+
 /*
  * Low level master read/write transaction.
  */
@@ -457,14 +679,22 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 
 	omap_i2c_write_reg(dev, OMAP_I2C_CNT_REG, dev->buf_len);
 
-	/* Clear the FIFO Buffers */
-	w = omap_i2c_read_reg(dev, OMAP_I2C_BUF_REG);
-	w |= OMAP_I2C_BUF_RXFIF_CLR | OMAP_I2C_BUF_TXFIF_CLR;
-	omap_i2c_write_reg(dev, OMAP_I2C_BUF_REG, w);
-
 	init_completion(&dev->cmd_complete);
 	dev->cmd_err = 0;
 
+	/* With DMA only the end of the message and errors interrupt */
+	dev->dma_active = omap_i2c_use_dma(dev, msg);
+	if (dev->dma_active) {
+		dev->buf_len = 0;
+		omap_i2c_dma_start(dev, msg);
+		omap_i2c_write_reg(dev, OMAP_I2C_IE_REG, OMAP_I2C_IE_DMA);
+	} else if (dev->fifo_size) {
+		omap_i2c_write_reg(dev, OMAP_I2C_IE_REG, OMAP_I2C_IE_FIFO);
+	}
+
+	/* Clear the FIFO Buffers, set the thresholds */
+	omap_i2c_resize_fifo(dev, msg);
+
 	w = OMAP_I2C_CON_EN | OMAP_I2C_CON_MST | OMAP_I2C_CON_STT;
 
 	/* High speed configuration */
@@ -494,6 +724,8 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 			if (time_after(jiffies, delay)) {
 				dev_err(dev->dev, "controller timed out "
 				"waiting for start condition to finish\n");
+				if (dev->dma_active)
+					omap_i2c_dma_finish(dev, msg, 0);
 				return -ETIMEDOUT;
 			}
 			cpu_relax();
@@ -511,6 +743,14 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 	r = wait_for_completion_timeout(&dev->cmd_complete,
 					OMAP_I2C_TIMEOUT);
 	dev->buf_len = 0;
+	if (dev->dma_active) {
+		int err = omap_i2c_dma_finish(dev, msg, r > 0 && !dev->cmd_err);
+
+		if (err) {
+			omap_i2c_init(dev);
+			return err;
+		}
+	}
 	if (r < 0)
 		return r;
 	if (r == 0) {
@@ -546,6 +786,11 @@ static int omap_i2c_xfer_msg(struct i2c_adapter *adap,
 /*
  * Prepare controller for a transaction and call omap_i2c_xfer_msg
  * to do the work during IRQ processing.
+ *
+ * The messages go out back to back with repeated starts.  The
+ * controller is idled only once no transfer came for
+ * OMAP_I2C_IDLE_DELAY, so a client polling a device does not pay for
+ * clock and interrupt state changes every time.
  */
 static int
 omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
@@ -554,7 +799,9 @@ omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	int i;
 	int r;
 
-	omap_i2c_unidle(dev);
+	cancel_delayed_work_sync(&dev->idle_work);
+	if (dev->idle)
+		omap_i2c_unidle(dev);
 
 	r = omap_i2c_wait_for_bb(dev);
 	if (r < 0)
@@ -569,7 +816,7 @@ omap_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	if (r == 0)
 		r = num;
 out:
-	omap_i2c_idle(dev);
+	schedule_delayed_work(&dev->idle_work, OMAP_I2C_IDLE_DELAY);
 	return r;
 }
 
@@ -704,7 +951,7 @@ complete:
 			u8 num_bytes = 1;
 			if (dev->fifo_size) {
 				if (stat & OMAP_I2C_STAT_RRDY)
-					num_bytes = dev->fifo_size;
+					num_bytes = dev->threshold;
 				else    /* read RXSTAT on RDR interrupt */
 					num_bytes = (omap_i2c_read_reg(dev,
 							OMAP_I2C_BUFSTAT_REG)
@@ -744,7 +991,7 @@ complete:
 			u8 num_bytes = 1;
 			if (dev->fifo_size) {
 				if (stat & OMAP_I2C_STAT_XRDY)
-					num_bytes = dev->fifo_size;
+					num_bytes = dev->threshold;
 				else    /* read TXSTAT on XDR interrupt */
 					num_bytes = omap_i2c_read_reg(dev,
 							OMAP_I2C_BUFSTAT_REG)
@@ -864,6 +1111,8 @@ omap_i2c_probe(struct platform_device *pdev)
 	dev->idle = 1;
 	dev->dev = &pdev->dev;
 	dev->irq = irq->start;
+	dev->phys_base = mem->start;
+	INIT_DELAYED_WORK(&dev->idle_work, omap_i2c_idle_work);
 	dev->base = ioremap(mem->start, resource_size(mem));
 	if (!dev->base) {
 		r = -ENOMEM;
@@ -898,6 +1147,8 @@ omap_i2c_probe(struct platform_device *pdev)
 	/* reset ASAP, clearing any IRQs */
 	omap_i2c_init(dev);
 
+	omap_i2c_dma_init(dev, pdev);
+
 	isr = (dev->rev < OMAP_I2C_REV_2) ? omap_i2c_rev1_isr : omap_i2c_isr;
 	r = request_irq(dev->irq, isr, 0, pdev->name, dev);
 
@@ -906,8 +1157,9 @@ omap_i2c_probe(struct platform_device *pdev)
 		goto err_unuse_clocks;
 	}
 
-	dev_info(dev->dev, "bus %d rev%d.%d at %d kHz\n",
-		 pdev->id, dev->rev >> 4, dev->rev & 0xf, dev->speed);
+	dev_info(dev->dev, "bus %d rev%d.%d at %d kHz%s\n",
+		 pdev->id, dev->rev >> 4, dev->rev & 0xf, dev->speed,
+		 dev->dma_buf ? ", dma" : "");
 
 	omap_i2c_idle(dev);
 
@@ -932,6 +1184,7 @@ omap_i2c_probe(struct platform_device *pdev)
 err_free_irq:
 	free_irq(dev->irq, dev);
 err_unuse_clocks:
+	omap_i2c_dma_free(dev);
 	omap_i2c_write_reg(dev, OMAP_I2C_CON_REG, 0);
 	omap_i2c_idle(dev);
 	omap_i2c_put_clocks(dev);
@@ -956,7 +1209,11 @@ omap_i2c_remove(struct platform_device *pdev)
 
 	free_irq(dev->irq, dev);
 	i2c_del_adapter(&dev->adapter);
+	cancel_delayed_work_sync(&dev->idle_work);
+	omap_i2c_dma_free(dev);
 	omap_i2c_write_reg(dev, OMAP_I2C_CON_REG, 0);
+	if (!dev->idle)
+		omap_i2c_idle(dev);
 	omap_i2c_put_clocks(dev);
 	iounmap(dev->base);
 	kfree(dev);
@@ -965,9 +1222,31 @@ omap_i2c_remove(struct platform_device *pdev)
 	return 0;
 }
 
+#ifdef CONFIG_PM
+/*
+ * The controller is idled lazily after a transfer: don't leave the
+ * idle work pending, and the clocks on, across system suspend.
+ */
+static int omap_i2c_suspend(struct platform_device *pdev, pm_message_t state)
+{
+	struct omap_i2c_dev *dev = platform_get_drvdata(pdev);
+
+	mutex_lock(&dev->adapter.bus_lock);
+	cancel_delayed_work_sync(&dev->idle_work);
+	if (!dev->idle)
+		omap_i2c_idle(dev);
+	mutex_unlock(&dev->adapter.bus_lock);
+
+	return 0;
+}
+#else
+#define omap_i2c_suspend	NULL
+#endif
+
 static struct platform_driver omap_i2c_driver = {
 	.probe		= omap_i2c_probe,
 	.remove		= omap_i2c_remove,
+	.suspend	= omap_i2c_suspend,
 	.driver		= {
 		.name	= "i2c_omap",
 		.owner	= THIS_MODULE,
@@ -239,10 +239,15 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	struct mmc_blk_data *md = mq->data;
 	struct mmc_card *card = md->queue.card;
 	struct mmc_blk_request brq;
+	DECLARE_COMPLETION_ONSTACK(complete);
 	int ret = 1, disable_multi = 0;
 
 	mmc_claim_host(card->host);
 
+	/* prepared for a request which did not come next */
+	if (mq->prep_req && mq->prep_req != req)
+		mmc_queue_discard_prepared(mq);
+
 	do {
 		struct mmc_command cmd;
 		u32 readcmd, writecmd, status = 0;
@@ -302,8 +307,10 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 
 		mmc_set_data_timeout(&brq.data, card);
 
-		brq.data.sg = mq->sg;
-		brq.data.sg_len = mmc_queue_map_sg(mq);
+		if (!mmc_queue_take_prepared(mq, req, &brq.data)) {
+			brq.data.sg = mq->sg;
+			brq.data.sg_len = mmc_queue_map_sg(mq);
+		}
 
 		/*
 		 * Adjust the sg list so it is the same size as the
@@ -326,7 +333,11 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 
 		mmc_queue_bounce_pre(mq);
 
-		mmc_wait_for_req(card->host, &brq.mrq);
+		/* map the next request while this one is on the bus */
+		mmc_start_req(card->host, &brq.mrq, &complete);
+		mmc_queue_prep_next(mq);
+		wait_for_completion(&complete);
+		mmc_post_req(card->host, &brq.mrq, 0);
 
 		mmc_queue_bounce_post(mq);
 
@@ -60,6 +60,7 @@ static int mmc_queue_thread(void *d)
 		spin_unlock_irq(q->queue_lock);
 
 		if (!req) {
+			mmc_queue_discard_prepared(mq);
 			if (kthread_should_stop()) {
 				set_current_state(TASK_RUNNING);
 				break;
@@ -192,6 +193,18 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 			goto cleanup_queue;
 		}
 		sg_init_table(mq->sg, host->max_phys_segs);
+
+		/*
+		 * A second sg list lets the next request be mapped while
+		 * the current one is still in flight. This is an
+		 * optimisation only, so carry on without it.
+		 */
+		if (host->ops->pre_req) {
+			mq->sg_next = kmalloc(sizeof(struct scatterlist) *
+				host->max_phys_segs, GFP_KERNEL);
+			if (mq->sg_next)
+				sg_init_table(mq->sg_next, host->max_phys_segs);
+		}
 	}
 
 	init_MUTEX(&mq->thread_sem);
@@ -211,6 +224,8 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
  	if (mq->sg)
 		kfree(mq->sg);
 	mq->sg = NULL;
+	kfree(mq->sg_next);
+	mq->sg_next = NULL;
 	if (mq->bounce_buf)
 		kfree(mq->bounce_buf);
 	mq->bounce_buf = NULL;
@@ -241,6 +256,9 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	kfree(mq->sg);
 	mq->sg = NULL;
 
+	kfree(mq->sg_next);
+	mq->sg_next = NULL;
+
 	if (mq->bounce_buf)
 		kfree(mq->bounce_buf);
 	mq->bounce_buf = NULL;
@@ -363,3 +381,90 @@ void mmc_queue_bounce_post(struct mmc_queue *mq)
 	local_irq_restore(flags);
 }
 
+/*
+ * Peek at the request following the one in flight and let the host
+ * prepare it (map it for DMA), so that this overlaps the running transfer.
+ */
+void mmc_queue_prep_next(struct mmc_queue *mq)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_host *host = mq->card->host;
+	struct request *req = NULL;
+
+	if (!mq->sg_next || mq->prep_req)
+		return;
+
+	spin_lock_irq(q->queue_lock);
+	if (!blk_queue_plugged(q))
+		req = blk_peek_request(q);
+	spin_unlock_irq(q->queue_lock);
+
+	/* anything but a plain read or write goes the normal way */
+	if (!req || !blk_fs_request(req) ||
+	    blk_rq_sectors(req) > host->max_blk_count)
+		return;
+
+	memset(&mq->prep_mrq, 0, sizeof(struct mmc_request));
+	memset(&mq->prep_data, 0, sizeof(struct mmc_data));
+	mq->prep_data.blksz = 512;
+	mq->prep_data.blocks = blk_rq_sectors(req);
+	if (rq_data_dir(req) == READ)
+		mq->prep_data.flags = MMC_DATA_READ;
+	else
+		mq->prep_data.flags = MMC_DATA_WRITE;
+	mq->prep_data.sg = mq->sg_next;
+	mq->prep_data.sg_len = blk_rq_map_sg(q, req, mq->sg_next);
+	mq->prep_mrq.data = &mq->prep_data;
+
+	mmc_pre_req(host, &mq->prep_mrq);
+
+	mq->prep_req = req;
+	mq->prep_pos = blk_rq_pos(req);
+}
+
+/*
+ * If req is the request prepared by mmc_queue_prep_next() and data covers
+ * all of it, hand the prepared sg list over to data and return 1.  A
+ * preparation for another request, usually the one following a request
+ * split into several chunks, is kept; one for req which does not match
+ * data is dropped.  Return 0 in both cases.
+ */
+int mmc_queue_take_prepared(struct mmc_queue *mq, struct request *req,
+			    struct mmc_data *data)
+{
+	struct scatterlist *sg;
+
+	if (!mq->prep_req || mq->prep_req != req)
+		return 0;
+
+	if (mq->prep_pos != blk_rq_pos(req) ||
+	    mq->prep_data.blocks != data->blocks ||
+	    mq->prep_data.flags != data->flags) {
+		mmc_queue_discard_prepared(mq);
+		return 0;
+	}
+
+	sg = mq->sg;
+	mq->sg = mq->sg_next;
+	mq->sg_next = sg;
+
+	data->sg = mq->sg;
+	data->sg_len = mq->prep_data.sg_len;
+	data->host_cookie = mq->prep_data.host_cookie;
+	mq->prep_req = NULL;
+
+	return 1;
+}
+
+/*
+ * Undo the host side preparation of a request that is not going to be
+ * issued next.
+ */
+void mmc_queue_discard_prepared(struct mmc_queue *mq)
+{
+	if (!mq->prep_req)
+		return;
+
+	mmc_post_req(mq->card->host, &mq->prep_mrq, -EAGAIN);
+	mq->prep_req = NULL;
+}
@@ -1,6 +1,8 @@
 #ifndef MMC_QUEUE_H
 #define MMC_QUEUE_H
 
+#include <linux/mmc/core.h>
+
 struct request;
 struct task_struct;
 
@@ -17,6 +19,11 @@ struct mmc_queue {
 	char			*bounce_buf;
 	struct scatterlist	*bounce_sg;
 	unsigned int		bounce_sg_len;
+	struct scatterlist	*sg_next;	/* sg list of prepared request */
+	struct request		*prep_req;	/* request prepared ahead */
+	sector_t		prep_pos;
+	struct mmc_request	prep_mrq;
+	struct mmc_data		prep_data;
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *);
@@ -27,5 +34,9 @@ extern void mmc_queue_resume(struct mmc_queue *);
 extern unsigned int mmc_queue_map_sg(struct mmc_queue *);
 extern void mmc_queue_bounce_pre(struct mmc_queue *);
 extern void mmc_queue_bounce_post(struct mmc_queue *);
+extern void mmc_queue_prep_next(struct mmc_queue *);
+extern int mmc_queue_take_prepared(struct mmc_queue *, struct request *,
+				   struct mmc_data *);
+extern void mmc_queue_discard_prepared(struct mmc_queue *);
 
 #endif
@@ -181,6 +181,30 @@ static void mmc_wait_done(struct mmc_request *mrq)
 	complete(mrq->done_data);
 }
 
+/**
+ *	mmc_start_req - start a request without waiting for it
+ *	@host: MMC host to start command
+ *	@mrq: MMC request to start
+ *	@complete: completion signalled when the request is done
+ *
+ *	Start a new MMC custom command request for a host and return
+ *	immediately. The caller may prepare further work (see
+ *	mmc_pre_req()) before waiting on @complete, which it must have
+ *	initialised, e.g. with DECLARE_COMPLETION_ONSTACK(). It may be
+ *	reused for several requests.
+ */
+void mmc_start_req(struct mmc_host *host, struct mmc_request *mrq,
+	struct completion *complete)
+{
+	INIT_COMPLETION(*complete);
+	mrq->done_data = complete;
+	mrq->done = mmc_wait_done;
+
+	mmc_start_request(host, mrq);
+}
+
+EXPORT_SYMBOL(mmc_start_req);
+
 /**
  *	mmc_wait_for_req - start a request and wait for completion
  *	@host: MMC host to start command
@@ -194,16 +218,44 @@ void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 {
 	DECLARE_COMPLETION_ONSTACK(complete);
 
-	mrq->done_data = &complete;
-	mrq->done = mmc_wait_done;
-
-	mmc_start_request(host, mrq);
+	mmc_start_req(host, mrq, &complete);
 
 	wait_for_completion(&complete);
 }
 
 EXPORT_SYMBOL(mmc_wait_for_req);
 
+/**
+ *	mmc_pre_req - prepare a request ahead of time
+ *	@host: MMC host the request will be issued on
+ *	@mrq: MMC request to prepare
+ *
+ *	Let the host do the expensive parts of request setup, such as
+ *	mapping the scatterlist for DMA, while another request is still
+ *	being transferred.
+ */
+void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	if (host->ops->pre_req)
+		host->ops->pre_req(host, mrq);
+}
+
+EXPORT_SYMBOL(mmc_pre_req);
+
+/**
+ *	mmc_post_req - finish a request prepared by mmc_pre_req()
+ *	@host: MMC host the request was prepared for
+ *	@mrq: MMC request to finish
+ *	@err: non-zero if the prepared request was never issued
+ */
+void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq, int err)
+{
+	if (host->ops->post_req)
+		host->ops->post_req(host, mrq, err);
+}
+
+EXPORT_SYMBOL(mmc_post_req);
+
 /**
  *	mmc_wait_for_cmd - start a command and wait for completion
  *	@host: MMC host to start command
@@ -22,6 +22,7 @@
 #include <linux/interrupt.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/platform_device.h>
 #include <linux/workqueue.h>
 #include <linux/timer.h>
@@ -137,6 +138,11 @@
 #define OMAP_HSMMC_WRITE(base, reg, val) \
 	__raw_writel((val), (base) + OMAP_HSMMC_##reg)
 
+struct omap_hsmmc_next {
+	unsigned int	dma_len;
+	s32		cookie;
+};
+
 struct omap_hsmmc_host {
 	struct	device		*dev;
 	struct	mmc_host	*mmc;
@@ -154,15 +160,18 @@ struct omap_hsmmc_host {
 	unsigned long		flags;
 	unsigned int		id;
 	unsigned int		dma_len;
-	unsigned int		dma_sg_idx;
 	unsigned char		bus_mode;
 	unsigned char		power_mode;
 	u32			*buffer;
 	u32			bytesleft;
 	int			suspended;
 	int			irq;
-	int			use_dma, dma_ch;
+	int			use_dma;
 	int			dma_line_tx, dma_line_rx;
+	struct dma_chan		*tx_chan, *rx_chan;
+	struct dma_chan		*dma_chan;	/* transfer in flight */
+	struct omap_dma_slave	tx_slave, rx_slave;
+	struct omap_hsmmc_next	next_data;
 	int			slot_id;
 	int			got_dbclk;
 	int			response_busy;
@@ -512,7 +521,7 @@ omap_hsmmc_xfer_done(struct omap_hsmmc_host *host, struct mmc_data *data)
 
 	host->data = NULL;
 
-	if (host->use_dma && host->dma_ch != -1)
+	if (host->use_dma && host->dma_chan && !data->host_cookie)
 		dma_unmap_sg(mmc_dev(host->mmc), data->sg, host->dma_len,
 			omap_hsmmc_get_dma_dir(host, data));
 
@@ -562,11 +571,13 @@ static void omap_hsmmc_dma_cleanup(struct omap_hsmmc_host *host, int errno)
 {
 	host->data->error = errno;
 
-	if (host->use_dma && host->dma_ch != -1) {
-		dma_unmap_sg(mmc_dev(host->mmc), host->data->sg, host->dma_len,
-			omap_hsmmc_get_dma_dir(host, host->data));
-		omap_free_dma(host->dma_ch);
-		host->dma_ch = -1;
+	if (host->use_dma && host->dma_chan) {
+		host->dma_chan->device->device_terminate_all(host->dma_chan);
+		if (!host->data->host_cookie)
+			dma_unmap_sg(mmc_dev(host->mmc), host->data->sg,
+				host->dma_len,
+				omap_hsmmc_get_dma_dir(host, host->data));
+		host->dma_chan = NULL;
 		up(&host->sem);
 	}
 	host->data = NULL;
@@ -866,76 +877,68 @@ static irqreturn_t omap_hsmmc_cd_handler(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static int omap_hsmmc_get_dma_sync_dev(struct omap_hsmmc_host *host,
-				     struct mmc_data *data)
-{
-	int sync_dev;
-
-	if (data->flags & MMC_DATA_WRITE)
-		sync_dev = host->dma_line_tx;
-	else
-		sync_dev = host->dma_line_rx;
-	return sync_dev;
-}
-
-static void omap_hsmmc_config_dma_params(struct omap_hsmmc_host *host,
-				       struct mmc_data *data,
-				       struct scatterlist *sgl)
+/*
+ * DMA call back function, runs once the whole scatterlist has been moved
+ */
+static void omap_hsmmc_dma_cb(void *param)
 {
-	int blksz, nblk, dma_ch;
+	struct omap_hsmmc_host *host = param;
+	unsigned long flags;
 
-	dma_ch = host->dma_ch;
-	if (data->flags & MMC_DATA_WRITE) {
-		omap_set_dma_dest_params(dma_ch, 0, OMAP_DMA_AMODE_CONSTANT,
-			(host->mapbase + OMAP_HSMMC_DATA), 0, 0);
-		omap_set_dma_src_params(dma_ch, 0, OMAP_DMA_AMODE_POST_INC,
-			sg_dma_address(sgl), 0, 0);
-	} else {
-		omap_set_dma_src_params(dma_ch, 0, OMAP_DMA_AMODE_CONSTANT,
-			(host->mapbase + OMAP_HSMMC_DATA), 0, 0);
-		omap_set_dma_dest_params(dma_ch, 0, OMAP_DMA_AMODE_POST_INC,
-			sg_dma_address(sgl), 0, 0);
+	spin_lock_irqsave(&host->irq_lock, flags);
+	if (host->dma_chan == NULL) {
+		spin_unlock_irqrestore(&host->irq_lock, flags);
+		return;
 	}
+	host->dma_chan = NULL;
+	spin_unlock_irqrestore(&host->irq_lock, flags);
 
-	blksz = host->data->blksz;
-	nblk = sg_dma_len(sgl) / blksz;
-
-	omap_set_dma_transfer_params(dma_ch, OMAP_DMA_DATA_TYPE_S32,
-			blksz / 4, nblk, OMAP_DMA_SYNC_FRAME,
-			omap_hsmmc_get_dma_sync_dev(host, data),
-			!(data->flags & MMC_DATA_WRITE));
-
-	omap_start_dma(dma_ch);
+	up(&host->sem);
 }
 
 /*
- * DMA call back function
+ * Map the scatterlist of data for DMA, unless this was already done by
+ * omap_hsmmc_pre_req() while the previous request was running. With next
+ * set the mapping is stored for a later request instead.
  */
-static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *data)
+static int omap_hsmmc_pre_dma_transfer(struct omap_hsmmc_host *host,
+				       struct mmc_data *data,
+				       struct omap_hsmmc_next *next)
 {
-	struct omap_hsmmc_host *host = data;
+	int dma_len;
+
+	if (!next && data->host_cookie &&
+	    data->host_cookie != host->next_data.cookie) {
+		dev_warn(mmc_dev(host->mmc), "invalid cookie: data->host_cookie"
+			 " %d host->next_data.cookie %d\n",
+			 data->host_cookie, host->next_data.cookie);
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     omap_hsmmc_get_dma_dir(host, data));
+		data->host_cookie = 0;
+	}
 
-	if (ch_status & OMAP2_DMA_MISALIGNED_ERR_IRQ)
-		dev_dbg(mmc_dev(host->mmc), "MISALIGNED_ADRS_ERR\n");
+	if (next || !data->host_cookie) {
+		dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len,
+				     omap_hsmmc_get_dma_dir(host, data));
+	} else {
+		dma_len = host->next_data.dma_len;
+		host->next_data.dma_len = 0;
+	}
 
-	if (host->dma_ch < 0)
-		return;
+	if (dma_len == 0)
+		return -EINVAL;
 
-	host->dma_sg_idx++;
-	if (host->dma_sg_idx < host->dma_len) {
-		/* Fire up the next transfer. */
-		omap_hsmmc_config_dma_params(host, host->data,
-					   host->data->sg + host->dma_sg_idx);
-		return;
+	if (next) {
+		next->dma_len = dma_len;
+		if (++next->cookie < 0)
+			next->cookie = 1;
+		data->host_cookie = next->cookie;
+	} else {
+		host->dma_len = dma_len;
 	}
 
-	omap_free_dma(host->dma_ch);
-	host->dma_ch = -1;
-	/*
-	 * DMA Callback: run in interrupt context.
-	 * mutex_unlock will throw a kernel warning if used.
-	 */
-	up(&host->sem);
+	return 0;
 }
 
 /*
@@ -944,8 +947,11 @@ static void omap_hsmmc_dma_cb(int lch, u16 ch_status, void *data)
 static int omap_hsmmc_start_dma_transfer(struct omap_hsmmc_host *host,
 					struct mmc_request *req)
 {
-	int dma_ch = 0, ret = 0, err = 1, i;
+	struct dma_async_tx_descriptor *tx;
 	struct mmc_data *data = req->data;
+	struct omap_dma_slave *slave;
+	struct dma_chan *chan;
+	int ret = 0, err = 1, i;
 
 	/* Sanity check: all the SG entries must be aligned by block size. */
 	for (i = 0; i < data->sg_len; i++) {
@@ -963,14 +969,15 @@ static int omap_hsmmc_start_dma_transfer(struct omap_hsmmc_host *host,
 
 	/*
 	 * If for some reason the DMA transfer is still active,
-	 * we wait for timeout period and free the dma
+	 * we wait for timeout period and abort it
 	 */
-	if (host->dma_ch != -1) {
+	if (host->dma_chan != NULL) {
 		set_current_state(TASK_UNINTERRUPTIBLE);
 		schedule_timeout(100);
 		if (down_trylock(&host->sem)) {
-			omap_free_dma(host->dma_ch);
-			host->dma_ch = -1;
+			host->dma_chan->device->device_terminate_all(
+							host->dma_chan);
+			host->dma_chan = NULL;
 			up(&host->sem);
 			return err;
 		}
@@ -979,23 +986,47 @@ static int omap_hsmmc_start_dma_transfer(struct omap_hsmmc_host *host,
 			return err;
 	}
 
-	ret = omap_request_dma(omap_hsmmc_get_dma_sync_dev(host, data),
-			       "MMC/SD", omap_hsmmc_dma_cb, host, &dma_ch);
-	if (ret != 0) {
-		dev_err(mmc_dev(host->mmc),
-			"%s: omap_request_dma() failed with %d\n",
-			mmc_hostname(host->mmc), ret);
-		return ret;
+	if (data->flags & MMC_DATA_WRITE) {
+		chan = host->tx_chan;
+		slave = &host->tx_slave;
+	} else {
+		chan = host->rx_chan;
+		slave = &host->rx_slave;
+	}
+
+	ret = omap_hsmmc_pre_dma_transfer(host, data, NULL);
+	if (ret)
+		goto err_up;
+
+	/* one sDMA frame per MMC block, picked up at prep time */
+	slave->frame_len = data->blksz / 4;
+
+	tx = chan->device->device_prep_slave_sg(chan, data->sg, host->dma_len,
+			omap_hsmmc_get_dma_dir(host, data),
+			DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!tx) {
+		dev_err(mmc_dev(host->mmc), "%s: prep_slave_sg() failed\n",
+			mmc_hostname(host->mmc));
+		ret = -EIO;
+		goto err_unmap;
 	}
 
-	host->dma_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
-			data->sg_len, omap_hsmmc_get_dma_dir(host, data));
-	host->dma_ch = dma_ch;
-	host->dma_sg_idx = 0;
+	tx->callback = omap_hsmmc_dma_cb;
+	tx->callback_param = host;
+	tx->tx_submit(tx);
 
-	omap_hsmmc_config_dma_params(host, data, data->sg);
+	host->dma_chan = chan;
+	dma_async_issue_pending(chan);
 
 	return 0;
+
+err_unmap:
+	if (!data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			omap_hsmmc_get_dma_dir(host, data));
+err_up:
+	up(&host->sem);
+	return ret;
 }
 
 static void set_data_timeout(struct omap_hsmmc_host *host,
@@ -1512,10 +1543,39 @@ static int omap_hsmmc_disable_fclk(struct mmc_host *mmc, int lazy)
 	return 0;
 }
 
+static void omap_hsmmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+				int err)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (host->use_dma && data->host_cookie) {
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     omap_hsmmc_get_dma_dir(host, data));
+		data->host_cookie = 0;
+	}
+}
+
+static void omap_hsmmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct omap_hsmmc_host *host = mmc_priv(mmc);
+
+	if (mrq->data->host_cookie) {
+		mrq->data->host_cookie = 0;
+		return;
+	}
+
+	if (host->use_dma &&
+	    omap_hsmmc_pre_dma_transfer(host, mrq->data, &host->next_data))
+		mrq->data->host_cookie = 0;
+}
+
 static const struct mmc_host_ops omap_hsmmc_ops = {
 	.enable = omap_hsmmc_enable_fclk,
 	.disable = omap_hsmmc_disable_fclk,
 	.request = omap_hsmmc_request,
+	.pre_req = omap_hsmmc_pre_req,
+	.post_req = omap_hsmmc_post_req,
 	.set_ios = omap_hsmmc_set_ios,
 	.get_cd = omap_hsmmc_get_cd,
 	.get_ro = omap_hsmmc_get_ro,
@@ -1526,6 +1586,8 @@ static const struct mmc_host_ops omap_hsmmc_ps_ops = {
 	.enable = omap_hsmmc_enable,
 	.disable = omap_hsmmc_disable,
 	.request = omap_hsmmc_request,
+	.pre_req = omap_hsmmc_pre_req,
+	.post_req = omap_hsmmc_post_req,
 	.set_ios = omap_hsmmc_set_ios,
 	.get_cd = omap_hsmmc_get_cd,
 	.get_ro = omap_hsmmc_get_ro,
@@ -1617,6 +1679,7 @@ static int __init omap_hsmmc_probe(struct platform_device *pdev)
 	struct omap_hsmmc_host *host = NULL;
 	struct resource *res;
 	int ret = 0, irq;
+	dma_cap_mask_t mask;
 
 	if (pdata == NULL) {
 		dev_err(&pdev->dev, "Platform Data is missing\n");
@@ -1650,7 +1713,6 @@ static int __init omap_hsmmc_probe(struct platform_device *pdev)
 	host->dev	= &pdev->dev;
 	host->use_dma	= 1;
 	host->dev->dma_mask = &pdata->dma_mask;
-	host->dma_ch	= -1;
 	host->irq	= irq;
 	host->id	= pdev->id;
 	host->slot_id	= 0;
@@ -1773,12 +1835,36 @@ static int __init omap_hsmmc_probe(struct platform_device *pdev)
 		goto err_irq;
 	}
 
+	/*
+	 * The DMA channels are held for the lifetime of the host, so that
+	 * a request only has to queue a descriptor for its scatterlist.
+	 */
+	host->tx_slave.dev_addr = host->mapbase + OMAP_HSMMC_DATA;
+	host->tx_slave.dma_req = host->dma_line_tx;
+	host->tx_slave.data_type = OMAP_DMA_DATA_TYPE_S32;
+	host->tx_slave.sync_mode = OMAP_DMA_SYNC_FRAME;
+	host->tx_slave.frame_len = 512 / 4;
+	host->rx_slave = host->tx_slave;
+	host->rx_slave.dma_req = host->dma_line_rx;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SLAVE, mask);
+	host->tx_chan = dma_request_channel(mask, omap_dma_filter_fn,
+					    &host->tx_slave);
+	host->rx_chan = dma_request_channel(mask, omap_dma_filter_fn,
+					    &host->rx_slave);
+	if (!host->tx_chan || !host->rx_chan) {
+		dev_err(mmc_dev(host->mmc), "Unable to get DMA channels\n");
+		ret = -ENXIO;
+		goto err_dma;
+	}
+
 	/* Request IRQ for MMC operations */
 	ret = request_irq(host->irq, omap_hsmmc_irq, IRQF_DISABLED,
 			mmc_hostname(mmc), host);
 	if (ret) {
 		dev_dbg(mmc_dev(host->mmc), "Unable to grab HSMMC IRQ\n");
-		goto err_irq;
+		goto err_dma;
 	}
 
 	/* initialize power supplies, gpios, etc */
@@ -1838,6 +1924,11 @@ err_irq_cd:
 	free_irq(mmc_slot(host).card_detect_irq, host);
 err_irq_cd_init:
 	free_irq(host->irq, host);
+err_dma:
+	if (host->tx_chan)
+		dma_release_channel(host->tx_chan);
+	if (host->rx_chan)
+		dma_release_channel(host->rx_chan);
 err_irq:
 	mmc_host_disable(host->mmc);
 	clk_disable(host->iclk);
@@ -1873,6 +1964,9 @@ static int omap_hsmmc_remove(struct platform_device *pdev)
 			free_irq(mmc_slot(host).card_detect_irq, host);
 		flush_scheduled_work();
 
+		dma_release_channel(host->tx_chan);
+		dma_release_channel(host->rx_chan);
+
 		mmc_host_disable(host->mmc);
 		clk_disable(host->iclk);
 		clk_put(host->fclk);
@@ -21,6 +21,7 @@
 #include <plat/dma.h>
 #include <plat/gpmc.h>
 #include <plat/nand.h>
+#include <plat/elm.h>
 
 #define GPMC_IRQ_STATUS		0x18
 #define GPMC_ECC_CONFIG		0x1F4
@@ -40,6 +41,15 @@
 #define	GPMC_BUF_FULL	0x00000001
 #define	GPMC_BUF_EMPTY	0x00000000
 
+/* fifo threshold in irq mode: refill/drain while the engine carries on */
+#define PREFETCH_FIFOTHRESHOLD_IRQ	(GPMC_PREFETCH_FIFOTHRESHOLD_MAX / 2)
+#define PREFETCH_TIMEOUT_MS		100
+
+/* BCH ecc bytes per 512 byte sector; BCH4 has 4 bits of padding */
+#define BCH4_ECC_BYTES		7
+#define BCH8_ECC_BYTES		13
+#define BCH4_PAD_BITS		4
+
 #define NAND_Ecc_P1e		(1 << 0)
 #define NAND_Ecc_P2e		(1 << 1)
 #define NAND_Ecc_P4e		(1 << 2)
@@ -147,6 +157,16 @@ struct omap_nand_info {
 	void __iomem			*nand_pref_fifo_add;
 	struct completion		comp;
 	int				dma_ch;
+
+	/* prefetch engine driven by the GPMC interrupt */
+	int				pref_irq;
+	struct completion		pref_done;
+	u_char				*pref_buf;
+	int				pref_len;
+	int				pref_is_write;
+
+	int				bch_nerrors;	/* 0: no BCH */
+	struct nand_ecclayout		bch_layout;
 };
 
 /**
@@ -280,6 +300,122 @@ static void omap_write_buf16(struct mtd_info *mtd, const u_char * buf, int len)
 	}
 }
 
+/*
+ * omap_nand_pref_irq - feeds or drains the prefetch fifo
+ * @events: GPMC_IRQ_* events
+ * @data: omap_nand_info
+ *
+ * Called from the GPMC interrupt when the fifo crossed its threshold
+ * and when the engine has transferred all bytes.
+ */
+static void omap_nand_pref_irq(u32 events, void *data)
+{
+	struct omap_nand_info *info = data;
+	int cnt = GPMC_PREFETCH_STATUS_FIFO_CNT(gpmc_prefetch_status());
+
+	if (info->pref_is_write) {
+		/* free room in the fifo */
+		cnt = min(cnt, info->pref_len) & ~1;
+		iowrite16_rep(info->nand_pref_fifo_add, info->pref_buf,
+			      cnt >> 1);
+		info->pref_buf += cnt;
+		info->pref_len -= cnt;
+
+		if (!info->pref_len)
+			gpmc_prefetch_irq_disable(GPMC_IRQ_FIFOEVENT);
+
+		/* done once it is all out on the bus, not just in the fifo */
+		if (!(events & GPMC_IRQ_COUNT_EVENT))
+			return;
+	} else {
+		/* bytes in the fifo */
+		cnt = min(cnt, info->pref_len) & ~3;
+		ioread32_rep(info->nand_pref_fifo_add, info->pref_buf,
+			     cnt >> 2);
+		info->pref_buf += cnt;
+		info->pref_len -= cnt;
+
+		if (info->pref_len)
+			return;
+	}
+
+	gpmc_prefetch_irq_disable(GPMC_IRQ_FIFOEVENT | GPMC_IRQ_COUNT_EVENT);
+	complete(&info->pref_done);
+}
+
+/*
+ * omap_nand_pref_poll - finish a transfer the interrupt did not complete
+ * @info: NAND device
+ *
+ * Feeds/drains the fifo from the cpu with the interrupts masked, for
+ * when they stopped coming.  Returns -ETIMEDOUT if the engine does not
+ * move either.
+ */
+static int omap_nand_pref_poll(struct omap_nand_info *info)
+{
+	unsigned long timeout = jiffies + msecs_to_jiffies(PREFETCH_TIMEOUT_MS);
+	u32 events;
+
+	while (!try_wait_for_completion(&info->pref_done)) {
+		if (time_after(jiffies, timeout))
+			return -ETIMEDOUT;
+		events = GPMC_PREFETCH_STATUS_COUNT(gpmc_prefetch_status()) ?
+			0 : GPMC_IRQ_COUNT_EVENT;
+		omap_nand_pref_irq(events, info);
+		cpu_relax();
+	}
+
+	return 0;
+}
+
+/*
+ * omap_nand_pref_irq_xfer - transfer a buffer with the prefetch engine
+ * @info: NAND device
+ * @buf: buffer, @len bytes
+ * @is_write: prefetch read(0) or write post(1)
+ *
+ * The cpu sleeps while the fifo is fed/drained from the GPMC interrupt,
+ * and polls the engine if the interrupt times out.  Returns -EBUSY or
+ * -EINVAL if the engine could not be started, so the caller can fall
+ * back to plain cpu copies, and -ETIMEDOUT if the transfer did not
+ * complete.
+ */
+static int omap_nand_pref_irq_xfer(struct omap_nand_info *info, u_char *buf,
+				   int len, int is_write)
+{
+	int ret;
+
+	info->pref_buf = buf;
+	info->pref_len = len;
+	info->pref_is_write = is_write;
+	INIT_COMPLETION(info->pref_done);
+
+	ret = gpmc_prefetch_enable(info->gpmc_cs, PREFETCH_FIFOTHRESHOLD_IRQ,
+				   0x0, len, is_write);
+	if (ret)
+		return ret;
+
+	gpmc_prefetch_irq_enable(GPMC_IRQ_FIFOEVENT | GPMC_IRQ_COUNT_EVENT);
+
+	if (!wait_for_completion_timeout(&info->pref_done,
+				msecs_to_jiffies(PREFETCH_TIMEOUT_MS))) {
+		gpmc_prefetch_irq_disable(GPMC_IRQ_FIFOEVENT |
+					  GPMC_IRQ_COUNT_EVENT);
+		dev_warn(&info->pdev->dev, "prefetch interrupt timed out, "
+			 "polling\n");
+		ret = omap_nand_pref_poll(info);
+		if (ret)
+			dev_err(&info->pdev->dev, "prefetch %s timed out, "
+				"%d bytes left\n", is_write ? "write" : "read",
+				info->pref_len);
+	}
+
+	/* disable and stop the PFPW engine */
+	gpmc_prefetch_reset();
+
+	return ret;
+}
+
 /**
  * omap_read_buf_pref - read data from NAND controller into buffer
  * @mtd: MTD device structure
@@ -301,8 +437,16 @@ static void omap_read_buf_pref(struct mtd_info *mtd, u_char *buf, int len)
 	}
 	p = (u32 *) buf;
 
+	/* not worth an interrupt for the spare area */
+	if (info->pref_irq && len > mtd->oobsize) {
+		ret = omap_nand_pref_irq_xfer(info, buf, len, 0x0);
+		if (!ret || ret == -ETIMEDOUT)
+			return;
+	}
+
 	/* configure and start prefetch transfer */
-	ret = gpmc_prefetch_enable(info->gpmc_cs, 0x0, len, 0x0);
+	ret = gpmc_prefetch_enable(info->gpmc_cs,
+			GPMC_PREFETCH_FIFOTHRESHOLD_MAX, 0x0, len, 0x0);
 	if (ret) {
 		/* PFPW engine is busy, use cpu copy method */
 		if (info->nand.options & NAND_BUSWIDTH_16)
@@ -312,7 +456,7 @@ static void omap_read_buf_pref(struct mtd_info *mtd, u_char *buf, int len)
 	} else {
 		do {
 			pfpw_status = gpmc_prefetch_status();
-			r_count = ((pfpw_status >> 24) & 0x7F) >> 2;
+			r_count = GPMC_PREFETCH_STATUS_FIFO_CNT(pfpw_status) >> 2;
 			ioread32_rep(info->nand_pref_fifo_add, p, r_count);
 			p += r_count;
 			len -= r_count << 2;
@@ -345,8 +489,15 @@ static void omap_write_buf_pref(struct mtd_info *mtd,
 		len--;
 	}
 
+	if (info->pref_irq && len > mtd->oobsize) {
+		ret = omap_nand_pref_irq_xfer(info, (u_char *)p, len, 0x1);
+		if (!ret || ret == -ETIMEDOUT)
+			return;
+	}
+
 	/*  configure and start prefetch transfer */
-	ret = gpmc_prefetch_enable(info->gpmc_cs, 0x0, len, 0x1);
+	ret = gpmc_prefetch_enable(info->gpmc_cs,
+			GPMC_PREFETCH_FIFOTHRESHOLD_MAX, 0x0, len, 0x1);
 	if (ret) {
 		/* PFPW engine is busy, use cpu copy method */
 		if (info->nand.options & NAND_BUSWIDTH_16)
@@ -355,8 +506,8 @@ static void omap_write_buf_pref(struct mtd_info *mtd,
 			omap_write_buf8(mtd, buf, len);
 	} else {
 		pfpw_status = gpmc_prefetch_status();
-		while (pfpw_status & 0x3FFF) {
-			w_count = ((pfpw_status >> 24) & 0x7F) >> 1;
+		while (GPMC_PREFETCH_STATUS_COUNT(pfpw_status)) {
+			w_count = GPMC_PREFETCH_STATUS_FIFO_CNT(pfpw_status) >> 1;
 			for (i = 0; (i < w_count) && len; i++, len -= 2)
 				iowrite16(*p++, info->nand_pref_fifo_add);
 			pfpw_status = gpmc_prefetch_status();
@@ -391,7 +542,6 @@ static inline int omap_nand_dma_transfer(struct mtd_info *mtd, void *addr,
 {
 	struct omap_nand_info *info = container_of(mtd,
 					struct omap_nand_info, mtd);
-	uint32_t prefetch_status = 0;
 	enum dma_data_direction dir = is_write ? DMA_TO_DEVICE :
 							DMA_FROM_DEVICE;
 	dma_addr_t dma_addr;
@@ -439,25 +589,49 @@ static inline int omap_nand_dma_transfer(struct mtd_info *mtd, void *addr,
 					OMAP24XX_DMA_GPMC, OMAP_DMA_SRC_SYNC);
 	}
 	/*  configure and start prefetch transfer */
-	ret = gpmc_prefetch_enable(info->gpmc_cs, 0x1, len, is_write);
+	ret = gpmc_prefetch_enable(info->gpmc_cs,
+			GPMC_PREFETCH_FIFOTHRESHOLD_MAX, 0x1, len, is_write);
 	if (ret)
 		/* PFPW engine is busy, use cpu copy methode */
 		goto out_copy;
 
 	init_completion(&info->comp);
 
+	/*
+	 * Once the dma is done a read is complete, but posted writes may
+	 * still sit in the fifo: have the engine tell when it is empty.
+	 */
+	if (is_write && info->pref_irq) {
+		info->pref_len = 0;
+		info->pref_is_write = 1;
+		INIT_COMPLETION(info->pref_done);
+		gpmc_prefetch_irq_enable(GPMC_IRQ_COUNT_EVENT);
+	}
+
 	omap_start_dma(info->dma_ch);
 
 	/* setup and start DMA using dma_addr */
 	wait_for_completion(&info->comp);
 
-	while (0x3fff & (prefetch_status = gpmc_prefetch_status()))
-		;
+	if (is_write) {
+		if (!info->pref_irq)
+			while (GPMC_PREFETCH_STATUS_COUNT(gpmc_prefetch_status()))
+				cpu_relax();
+		else if (!wait_for_completion_timeout(&info->pref_done,
+				msecs_to_jiffies(PREFETCH_TIMEOUT_MS))) {
+			gpmc_prefetch_irq_disable(GPMC_IRQ_COUNT_EVENT);
+			ret = omap_nand_pref_poll(info);
+			if (ret)
+				dev_err(&info->pdev->dev,
+					"write posting timed out\n");
+		}
+	}
+
 	/* disable and stop the PFPW engine */
 	gpmc_prefetch_reset();
 
 	dma_unmap_single(&info->pdev->dev, dma_addr, len, dir);
-	return 0;
+	return ret;
 
 out_copy:
 	if (info->nand.options & NAND_BUSWIDTH_16)
@@ -809,6 +983,160 @@ static void omap_enable_hwecc(struct mtd_info *mtd, int mode)
 }
 #endif
 
+#ifdef CONFIG_MTD_NAND_OMAP_BCH
+/**
+ * omap_enable_hwecc_bch - start BCH ecc generation for a sector
+ * @mtd: MTD device structure
+ * @mode: Read/Write mode, the engine works the same way for both
+ */
+static void omap_enable_hwecc_bch(struct mtd_info *mtd, int mode)
+{
+	struct omap_nand_info *info = container_of(mtd, struct omap_nand_info,
+							mtd);
+	int dev_width = (info->nand.options & NAND_BUSWIDTH_16) ? 1 : 0;
+
+	gpmc_enable_hwecc_bch(info->gpmc_cs, dev_width, info->bch_nerrors);
+}
+
+/**
+ * omap_calculate_ecc_bch - read the BCH ecc of the sector just transferred
+ * @mtd: MTD device structure
+ * @dat: sector data, unused: the engine saw it go over the bus
+ * @ecc_code: ecc buffer
+ */
+static int omap_calculate_ecc_bch(struct mtd_info *mtd, const u_char *dat,
+				u_char *ecc_code)
+{
+	struct omap_nand_info *info = container_of(mtd, struct omap_nand_info,
+							mtd);
+
+	return gpmc_calculate_ecc_bch(info->bch_nerrors, ecc_code);
+}
+
+/**
+ * omap_correct_data_bch - locate and fix bit errors in a sector
+ * @mtd: MTD device structure
+ * @dat: sector data
+ * @read_ecc: ecc read from the spare area
+ * @calc_ecc: ecc calculated while reading @dat
+ *
+ * The xor of both ecc is the syndrome of the errors, in both data and
+ * ecc, which the ELM turns into bit positions from the end of the
+ * codeword.  Returns the number of bits corrected or -EBADMSG.
+ */
+static int omap_correct_data_bch(struct mtd_info *mtd, u_char *dat,
+				u_char *read_ecc, u_char *calc_ecc)
+{
+	struct omap_nand_info *info = container_of(mtd, struct omap_nand_info,
+							mtd);
+	int eccbytes = info->nand.ecc.bytes;
+	int eccsize = info->nand.ecc.size;
+	int i, nerr, pad = 0, nfrags;
+	u8 syn[BCH8_ECC_BYTES], any = 0;
+	u32 frag[OMAP_ELM_BCH8_FRAGS];
+	u16 loc[OMAP_ELM_MAX_ERRORS];
+
+	for (i = 0; i < eccbytes; i++)
+		syn[i] = read_ecc[i] ^ calc_ecc[i];
+
+	if (info->bch_nerrors == 4) {
+		syn[BCH4_ECC_BYTES - 1] &= 0xf0;
+		pad = BCH4_PAD_BITS;
+	}
+
+	for (i = 0; i < eccbytes; i++)
+		any |= syn[i];
+	if (!any)
+		return 0;
+
+	/* back to the layout of the GPMC_BCH_RESULT registers */
+	if (info->bch_nerrors == 4) {
+		frag[0] = (syn[2] & 0xf) << 28 | syn[3] << 20 | syn[4] << 12 |
+			syn[5] << 4 | syn[6] >> 4;
+		frag[1] = syn[0] << 12 | syn[1] << 4 | syn[2] >> 4;
+		nfrags = OMAP_ELM_BCH4_FRAGS;
+	} else {
+		frag[0] = syn[9] << 24 | syn[10] << 16 | syn[11] << 8 |
+			syn[12];
+		frag[1] = syn[5] << 24 | syn[6] << 16 | syn[7] << 8 | syn[8];
+		frag[2] = syn[1] << 24 | syn[2] << 16 | syn[3] << 8 | syn[4];
+		frag[3] = syn[0];
+		nfrags = OMAP_ELM_BCH8_FRAGS;
+	}
+
+	nerr = omap_elm_locate(frag, nfrags, loc);
+	if (nerr < 0) {
+		DEBUG(MTD_DEBUG_LEVEL0, "BCH: uncorrectable sector\n");
+		return nerr;
+	}
+
+	for (i = 0; i < nerr; i++) {
+		int bit = loc[i] + pad;
+		int byte = eccsize + eccbytes - 1 - bit / 8;
+
+		/* flips in the ecc bytes themselves need no fixing */
+		if (byte < eccsize)
+			dat[byte] ^= 1 << (bit % 8);
+	}
+
+	return nerr;
+}
+
+/**
+ * omap_nand_bch_init - switch the chip to BCH ecc
+ * @info: NAND device, identified already
+ * @ecc_opt: OMAP_ECC_BCH4_CODE_HW or OMAP_ECC_BCH8_CODE_HW
+ *
+ * The ecc goes at the end of the spare area, which is otherwise free
+ * but for the bad block marker.
+ */
+static int omap_nand_bch_init(struct omap_nand_info *info,
+				enum omap_ecc ecc_opt)
+{
+	struct nand_chip *chip = &info->nand;
+	struct nand_ecclayout *layout = &info->bch_layout;
+	int i, eccbytes, off, free;
+	int err;
+
+	info->bch_nerrors = (ecc_opt == OMAP_ECC_BCH8_CODE_HW) ? 8 : 4;
+
+	chip->ecc.mode		= NAND_ECC_HW;
+	chip->ecc.size		= 512;
+	chip->ecc.bytes		= (info->bch_nerrors == 8) ? BCH8_ECC_BYTES :
+							     BCH4_ECC_BYTES;
+	chip->ecc.hwctl		= omap_enable_hwecc_bch;
+	chip->ecc.calculate	= omap_calculate_ecc_bch;
+	chip->ecc.correct	= omap_correct_data_bch;
+
+	eccbytes = info->mtd.writesize / chip->ecc.size * chip->ecc.bytes;
+	free = (info->mtd.writesize > 512) ? 2 : 6;
+	if (eccbytes > ARRAY_SIZE(layout->eccpos) ||
+	    eccbytes + free > info->mtd.oobsize) {
+		dev_err(&info->pdev->dev, "no room for %d-bit BCH ecc in "
+			"%d bytes of spare area\n", info->bch_nerrors,
+			info->mtd.oobsize);
+		return -EINVAL;
+	}
+
+	off = info->mtd.oobsize - eccbytes;
+	layout->eccbytes = eccbytes;
+	for (i = 0; i < eccbytes; i++)
+		layout->eccpos[i] = off + i;
+	layout->oobfree[0].offset = free;
+	layout->oobfree[0].length = off - free;
+	chip->ecc.layout = layout;
+
+	err = omap_elm_request((info->bch_nerrors == 8) ? OMAP_ELM_BCH8 :
+							  OMAP_ELM_BCH4);
+	if (err) {
+		dev_err(&info->pdev->dev, "cannot get the ELM: %d\n", err);
+		return err;
+	}
+
+	return 0;
+}
+#endif
+
 /**
  * omap_wait - wait until the command is done
  * @mtd: MTD device structure
@@ -860,10 +1188,8 @@ static int omap_dev_ready(struct mtd_info *mtd)
 	unsigned int val = __raw_readl(info->gpmc_baseaddr + GPMC_IRQ_STATUS);
 
 	if ((val & 0x100) == 0x100) {
-		/* Clear IRQ Interrupt */
-		val |= 0x100;
-		val &= ~(0x0);
-		__raw_writel(val, info->gpmc_baseaddr + GPMC_IRQ_STATUS);
+		/* Clear IRQ Interrupt, leaving the prefetch events alone */
+		__raw_writel(0x100, info->gpmc_baseaddr + GPMC_IRQ_STATUS);
 	} else {
 		unsigned int cnt = 0;
 		while (cnt++ < 0x1FF) {
@@ -901,6 +1227,7 @@ static int __devinit omap_nand_probe(struct platform_device *pdev)
 	init_waitqueue_head(&info->controller.wq);
 
 	info->pdev = pdev;
+	info->dma_ch = -1;
 
 	info->gpmc_cs		= pdata->cs;
 	info->gpmc_baseaddr	= pdata->gpmc_baseaddr;
@@ -974,6 +1301,13 @@ static int __devinit omap_nand_probe(struct platform_device *pdev)
 
 		info->nand.read_buf   = omap_read_buf_pref;
 		info->nand.write_buf  = omap_write_buf_pref;
+
+		init_completion(&info->pref_done);
+		if (!gpmc_prefetch_irq_request(omap_nand_pref_irq, info))
+			info->pref_irq = 1;
+		else
+			dev_info(&pdev->dev, "polling the prefetch engine\n");
+
 		if (use_dma) {
 			err = omap_request_dma(OMAP24XX_DMA_GPMC, "NAND",
 				omap_nand_dma_cb, &info->comp, &info->dma_ch);
@@ -1019,12 +1353,34 @@ static int __devinit omap_nand_probe(struct platform_device *pdev)
 	/* DIP switches on some boards change between 8 and 16 bit
 	 * bus widths for flash.  Try the other width if the first try fails.
 	 */
-	if (nand_scan(&info->mtd, 1)) {
+	if (nand_scan_ident(&info->mtd, 1)) {
 		info->nand.options ^= NAND_BUSWIDTH_16;
-		if (nand_scan(&info->mtd, 1)) {
+		if (nand_scan_ident(&info->mtd, 1)) {
 			err = -ENXIO;
-			goto out_release_mem_region;
+			goto out_free_pref;
+		}
+	}
+
+	if (pdata->ecc_opt == OMAP_ECC_BCH4_CODE_HW ||
+	    pdata->ecc_opt == OMAP_ECC_BCH8_CODE_HW) {
+#ifdef CONFIG_MTD_NAND_OMAP_BCH
+		err = omap_nand_bch_init(info, pdata->ecc_opt);
+		if (err) {
+			info->bch_nerrors = 0;
+			goto out_free_pref;
 		}
+#else
+		/* any other ecc would not match what is on the flash */
+		dev_err(&pdev->dev, "BCH ecc requested, but "
+			"CONFIG_MTD_NAND_OMAP_BCH is not set\n");
+		err = -EINVAL;
+		goto out_free_pref;
+#endif
+	}
+
+	if (nand_scan_tail(&info->mtd)) {
+		err = -ENXIO;
+		goto out_free_elm;
 	}
 
 #ifdef CONFIG_MTD_PARTITIONS
@@ -1041,6 +1397,16 @@ static int __devinit omap_nand_probe(struct platform_device *pdev)
 
 	return 0;
 
+out_free_elm:
+#ifdef CONFIG_MTD_NAND_OMAP_BCH
+	if (info->bch_nerrors)
+		omap_elm_free();
+#endif
+out_free_pref:
+	if (info->dma_ch >= 0)
+		omap_free_dma(info->dma_ch);
+	if (info->pref_irq)
+		gpmc_prefetch_irq_free(info);
 out_release_mem_region:
 	release_mem_region(info->phys_base, NAND_IO_SIZE);
 out_free_cs:
@@ -1054,16 +1420,23 @@ out_free_info:
 static int omap_nand_remove(struct platform_device *pdev)
 {
 	struct mtd_info *mtd = platform_get_drvdata(pdev);
-	struct omap_nand_info *info = mtd->priv;
+	struct omap_nand_info *info = container_of(mtd, struct omap_nand_info,
+							mtd);
 
 	platform_set_drvdata(pdev, NULL);
-	if (use_dma)
+	if (info->dma_ch >= 0)
 		omap_free_dma(info->dma_ch);
+	if (info->pref_irq)
+		gpmc_prefetch_irq_free(info);
+#ifdef CONFIG_MTD_NAND_OMAP_BCH
+	if (info->bch_nerrors)
+		omap_elm_free();
+#endif
 
 	/* Release NAND device, its internal structures and partitions */
 	nand_release(&info->mtd);
 	iounmap(info->nand_pref_fifo_add);
-	kfree(&info->mtd);
+	kfree(info);
 	return 0;
 }
 
@@ -107,6 +107,14 @@ struct omap2_mcspi_dma {
 
 	struct completion dma_tx_completion;
 	struct completion dma_rx_completion;
+
+	/* What the channels are programmed for, -1 if unknown.  Back to
+	 * back transfers of the same shape only need a new buffer address.
+	 */
+	int dma_tx_data_type;
+	int dma_tx_elements;
+	int dma_rx_data_type;
+	int dma_rx_elements;
 };
 
 /* use PIO for small transfers, avoiding DMA setup/teardown overhead and
@@ -120,6 +128,10 @@ struct omap2_mcspi {
 	/* lock protects queue and registers */
 	spinlock_t		lock;
 	struct list_head	msg_queue;
+	/* a message is being run, by the work or by omap2_mcspi_transfer() */
+	unsigned		busy:1;
+	/* device whose chipselect is kept asserted for its next message */
+	struct spi_device	*cs_held;
 	struct spi_master	*master;
 	struct clk		*ick;
 	struct clk		*fck;
@@ -201,6 +213,10 @@ static inline void mcspi_write_chconf0(const struct spi_device *spi, u32 val)
 {
 	struct omap2_mcspi_cs *cs = spi->controller_state;
 
+	/* the shadow is written back to the register on every clock enable */
+	if (cs->chconf0 == val)
+		return;
+
 	cs->chconf0 = val;
 	mcspi_write_cs_reg(spi, OMAP2_MCSPI_CHCONF0, val);
 }
@@ -280,6 +296,19 @@ static void omap2_mcspi_disable_clocks(struct omap2_mcspi *mcspi)
 	clk_disable(mcspi->fck);
 }
 
+static void omap2_mcspi_forget_dma(struct omap2_mcspi *mcspi)
+{
+	int i;
+
+	if (!mcspi->dma_channels)
+		return;
+
+	for (i = 0; i < mcspi->master->num_chipselect; i++) {
+		mcspi->dma_channels[i].dma_tx_data_type = -1;
+		mcspi->dma_channels[i].dma_rx_data_type = -1;
+	}
+}
+
 static int omap2_mcspi_enable_clocks(struct omap2_mcspi *mcspi)
 {
 	if (clk_enable(mcspi->ick))
@@ -289,6 +318,9 @@ static int omap2_mcspi_enable_clocks(struct omap2_mcspi *mcspi)
 
 	omap2_mcspi_restore_ctx(mcspi);
 
+	/* the sDMA channels may have lost their context meanwhile */
+	omap2_mcspi_forget_dma(mcspi);
+
 	return 0;
 }
 
@@ -329,14 +361,20 @@ omap2_mcspi_txrx_dma(struct spi_device *spi, struct spi_transfer *xfer)
 	}
 
 	if (tx != NULL) {
-		omap_set_dma_transfer_params(mcspi_dma->dma_tx_channel,
-				data_type, element_count, 1,
-				OMAP_DMA_SYNC_ELEMENT,
-				mcspi_dma->dma_tx_sync_dev, 0);
-
-		omap_set_dma_dest_params(mcspi_dma->dma_tx_channel, 0,
-				OMAP_DMA_AMODE_CONSTANT,
-				tx_reg, 0, 0);
+		if (mcspi_dma->dma_tx_data_type != data_type ||
+		    mcspi_dma->dma_tx_elements != element_count) {
+			omap_set_dma_transfer_params(mcspi_dma->dma_tx_channel,
+					data_type, element_count, 1,
+					OMAP_DMA_SYNC_ELEMENT,
+					mcspi_dma->dma_tx_sync_dev, 0);
+
+			omap_set_dma_dest_params(mcspi_dma->dma_tx_channel, 0,
+					OMAP_DMA_AMODE_CONSTANT,
+					tx_reg, 0, 0);
+
+			mcspi_dma->dma_tx_data_type = data_type;
+			mcspi_dma->dma_tx_elements = element_count;
+		}
 
 		omap_set_dma_src_params(mcspi_dma->dma_tx_channel, 0,
 				OMAP_DMA_AMODE_POST_INC,
@@ -344,14 +382,20 @@ omap2_mcspi_txrx_dma(struct spi_device *spi, struct spi_transfer *xfer)
 	}
 
 	if (rx != NULL) {
-		omap_set_dma_transfer_params(mcspi_dma->dma_rx_channel,
-				data_type, element_count - 1, 1,
-				OMAP_DMA_SYNC_ELEMENT,
-				mcspi_dma->dma_rx_sync_dev, 1);
-
-		omap_set_dma_src_params(mcspi_dma->dma_rx_channel, 0,
-				OMAP_DMA_AMODE_CONSTANT,
-				rx_reg, 0, 0);
+		if (mcspi_dma->dma_rx_data_type != data_type ||
+		    mcspi_dma->dma_rx_elements != element_count) {
+			omap_set_dma_transfer_params(mcspi_dma->dma_rx_channel,
+					data_type, element_count - 1, 1,
+					OMAP_DMA_SYNC_ELEMENT,
+					mcspi_dma->dma_rx_sync_dev, 1);
+
+			omap_set_dma_src_params(mcspi_dma->dma_rx_channel, 0,
+					OMAP_DMA_AMODE_CONSTANT,
+					rx_reg, 0, 0);
+
+			mcspi_dma->dma_rx_data_type = data_type;
+			mcspi_dma->dma_rx_elements = element_count;
+		}
 
 		omap_set_dma_dest_params(mcspi_dma->dma_rx_channel, 0,
 				OMAP_DMA_AMODE_POST_INC,
@@ -693,6 +737,8 @@ static int omap2_mcspi_request_dma(struct spi_device *spi)
 
 	init_completion(&mcspi_dma->dma_rx_completion);
 	init_completion(&mcspi_dma->dma_tx_completion);
+	mcspi_dma->dma_rx_data_type = -1;
+	mcspi_dma->dma_tx_data_type = -1;
 
 	return 0;
 }
@@ -767,6 +813,122 @@ static void omap2_mcspi_cleanup(struct spi_device *spi)
 	}
 }
 
+/* deassert a chipselect left active by the previous message */
+static void omap2_mcspi_release_cs(struct omap2_mcspi *mcspi)
+{
+	struct spi_device *spi = mcspi->cs_held;
+
+	if (!spi)
+		return;
+
+	omap2_mcspi_force_cs(spi, 0);
+	omap2_mcspi_set_enable(spi, 0);
+	mcspi->cs_held = NULL;
+}
+
+/*
+ * Run one message; clocks must be on.  When its last transfer asks for
+ * cs_change, the chipselect and the channel are left active and recorded
+ * in mcspi->cs_held, for the caller to release unless the next message
+ * is for the same device.
+ */
+static void omap2_mcspi_run_message(struct omap2_mcspi *mcspi,
+		struct spi_message *m)
+{
+	struct spi_device		*spi = m->spi;
+	struct spi_transfer		*t = NULL;
+	int				cs_active = 0;
+	int				keep_cs = 0;
+	struct omap2_mcspi_cs		*cs = spi->controller_state;
+	int				par_override = 0;
+	int				status = 0;
+	u32				chconf;
+
+	if (mcspi->cs_held == spi) {
+		cs_active = 1;
+	} else {
+		omap2_mcspi_release_cs(mcspi);
+		omap2_mcspi_set_enable(spi, 1);
+	}
+	mcspi->cs_held = NULL;
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		if (t->tx_buf == NULL && t->rx_buf == NULL && t->len) {
+			status = -EINVAL;
+			break;
+		}
+		if (par_override || t->speed_hz || t->bits_per_word) {
+			par_override = 1;
+			status = omap2_mcspi_setup_transfer(spi, t);
+			if (status < 0)
+				break;
+			if (!t->speed_hz && !t->bits_per_word)
+				par_override = 0;
+		}
+
+		if (!cs_active) {
+			omap2_mcspi_force_cs(spi, 1);
+			cs_active = 1;
+		}
+
+		chconf = mcspi_cached_chconf0(spi);
+		chconf &= ~OMAP2_MCSPI_CHCONF_TRM_MASK;
+		if (t->tx_buf == NULL)
+			chconf |= OMAP2_MCSPI_CHCONF_TRM_RX_ONLY;
+		else if (t->rx_buf == NULL)
+			chconf |= OMAP2_MCSPI_CHCONF_TRM_TX_ONLY;
+		mcspi_write_chconf0(spi, chconf);
+
+		if (t->len) {
+			unsigned	count;
+
+			/* RX_ONLY mode needs dummy data in TX reg */
+			if (t->tx_buf == NULL)
+				__raw_writel(0, cs->base
+						+ OMAP2_MCSPI_TX0);
+
+			if (m->is_dma_mapped || t->len >= DMA_MIN_BYTES)
+				count = omap2_mcspi_txrx_dma(spi, t);
+			else
+				count = omap2_mcspi_txrx_pio(spi, t);
+			m->actual_length += count;
+
+			if (count != t->len) {
+				status = -EIO;
+				break;
+			}
+		}
+
+		if (t->delay_usecs)
+			udelay(t->delay_usecs);
+
+		/* on the last transfer this is the "leave it on" hint */
+		keep_cs = t->cs_change;
+		if (t->cs_change &&
+		    !list_is_last(&t->transfer_list, &m->transfers)) {
+			omap2_mcspi_force_cs(spi, 0);
+			cs_active = 0;
+		}
+	}
+
+	/* Restore defaults if they were overriden */
+	if (par_override) {
+		par_override = 0;
+		status = omap2_mcspi_setup_transfer(spi, NULL);
+	}
+
+	if (cs_active && keep_cs && status == 0) {
+		mcspi->cs_held = spi;
+	} else {
+		if (cs_active)
+			omap2_mcspi_force_cs(spi, 0);
+		omap2_mcspi_set_enable(spi, 0);
+	}
+
+	m->status = status;
+	m->complete(m->context);
+}
+
 static void omap2_mcspi_work(struct work_struct *work)
 {
 	struct omap2_mcspi	*mcspi;
@@ -774,9 +936,15 @@ static void omap2_mcspi_work(struct work_struct *work)
 	mcspi = container_of(work, struct omap2_mcspi, work);
 	spin_lock_irq(&mcspi->lock);
 
+	/* omap2_mcspi_transfer() is running a message and requeues us */
+	if (mcspi->busy)
+		goto out;
+
 	if (omap2_mcspi_enable_clocks(mcspi))
 		goto out;
 
+	mcspi->busy = 1;
+
 	/* We only enable one channel at a time -- the one whose message is
 	 * at the head of the queue -- although this controller would gladly
 	 * arbitrate among multiple channels.  This corresponds to "single
@@ -785,13 +953,6 @@ static void omap2_mcspi_work(struct work_struct *work)
 	 */
 	while (!list_empty(&mcspi->msg_queue)) {
 		struct spi_message		*m;
-		struct spi_device		*spi;
-		struct spi_transfer		*t = NULL;
-		int				cs_active = 0;
-		struct omap2_mcspi_cs		*cs;
-		int				par_override = 0;
-		int				status = 0;
-		u32				chconf;
 
 		m = container_of(mcspi->msg_queue.next, struct spi_message,
 				 queue);
@@ -799,88 +960,71 @@ static void omap2_mcspi_work(struct work_struct *work)
 		list_del_init(&m->queue);
 		spin_unlock_irq(&mcspi->lock);
 
-		spi = m->spi;
-		cs = spi->controller_state;
+		omap2_mcspi_run_message(mcspi, m);
 
-		omap2_mcspi_set_enable(spi, 1);
-		list_for_each_entry(t, &m->transfers, transfer_list) {
-			if (t->tx_buf == NULL && t->rx_buf == NULL && t->len) {
-				status = -EINVAL;
-				break;
-			}
-			if (par_override || t->speed_hz || t->bits_per_word) {
-				par_override = 1;
-				status = omap2_mcspi_setup_transfer(spi, t);
-				if (status < 0)
-					break;
-				if (!t->speed_hz && !t->bits_per_word)
-					par_override = 0;
-			}
+		spin_lock_irq(&mcspi->lock);
 
-			if (!cs_active) {
-				omap2_mcspi_force_cs(spi, 1);
-				cs_active = 1;
-			}
+		/* a held chipselect only carries over to the same device */
+		if (mcspi->cs_held) {
+			m = list_empty(&mcspi->msg_queue) ? NULL :
+				container_of(mcspi->msg_queue.next,
+					     struct spi_message, queue);
+			if (!m || m->spi != mcspi->cs_held)
+				omap2_mcspi_release_cs(mcspi);
+		}
+	}
 
-			chconf = mcspi_cached_chconf0(spi);
-			chconf &= ~OMAP2_MCSPI_CHCONF_TRM_MASK;
-			if (t->tx_buf == NULL)
-				chconf |= OMAP2_MCSPI_CHCONF_TRM_RX_ONLY;
-			else if (t->rx_buf == NULL)
-				chconf |= OMAP2_MCSPI_CHCONF_TRM_TX_ONLY;
-			mcspi_write_chconf0(spi, chconf);
-
-			if (t->len) {
-				unsigned	count;
-
-				/* RX_ONLY mode needs dummy data in TX reg */
-				if (t->tx_buf == NULL)
-					__raw_writel(0, cs->base
-							+ OMAP2_MCSPI_TX0);
-
-				if (m->is_dma_mapped || t->len >= DMA_MIN_BYTES)
-					count = omap2_mcspi_txrx_dma(spi, t);
-				else
-					count = omap2_mcspi_txrx_pio(spi, t);
-				m->actual_length += count;
-
-				if (count != t->len) {
-					status = -EIO;
-					break;
-				}
-			}
+	mcspi->busy = 0;
+	omap2_mcspi_disable_clocks(mcspi);
 
-			if (t->delay_usecs)
-				udelay(t->delay_usecs);
+out:
+	spin_unlock_irq(&mcspi->lock);
+}
 
-			/* ignore the "leave it on after last xfer" hint */
-			if (t->cs_change) {
-				omap2_mcspi_force_cs(spi, 0);
-				cs_active = 0;
-			}
-		}
+/*
+ * Short PIO-only messages are run in the caller's context when the
+ * controller is idle: scheduling the work would cost more than the
+ * transfer itself.  This is only done outside atomic context and with
+ * interrupts on, so it must be decided before mcspi->lock is taken;
+ * whether the controller is idle is checked under it afterwards.  The
+ * message is then complete, and m->complete() has been called, by the
+ * time spi_async() returns: a caller holding a lock it also takes in
+ * its completion callback must not use spi_async() from process
+ * context.
+ */
+static int omap2_mcspi_can_run_now(struct spi_message *m)
+{
+	struct spi_transfer *t;
 
-		/* Restore defaults if they were overriden */
-		if (par_override) {
-			par_override = 0;
-			status = omap2_mcspi_setup_transfer(spi, NULL);
-		}
+	if (m->is_dma_mapped || in_atomic() || irqs_disabled())
+		return 0;
 
-		if (cs_active)
-			omap2_mcspi_force_cs(spi, 0);
+	list_for_each_entry(t, &m->transfers, transfer_list)
+		if (t->len >= DMA_MIN_BYTES)
+			return 0;
 
-		omap2_mcspi_set_enable(spi, 0);
+	return 1;
+}
 
-		m->status = status;
-		m->complete(m->context);
+static void omap2_mcspi_run_now(struct omap2_mcspi *mcspi,
+		struct spi_message *m)
+{
+	unsigned long flags;
 
-		spin_lock_irq(&mcspi->lock);
+	if (omap2_mcspi_enable_clocks(mcspi)) {
+		m->status = -ENODEV;
+		m->complete(m->context);
+	} else {
+		omap2_mcspi_run_message(mcspi, m);
+		omap2_mcspi_release_cs(mcspi);
+		omap2_mcspi_disable_clocks(mcspi);
 	}
 
-	omap2_mcspi_disable_clocks(mcspi);
-
-out:
-	spin_unlock_irq(&mcspi->lock);
+	spin_lock_irqsave(&mcspi->lock, flags);
+	mcspi->busy = 0;
+	if (!list_empty(&mcspi->msg_queue))
+		queue_work(omap2_mcspi_wq, &mcspi->work);
+	spin_unlock_irqrestore(&mcspi->lock, flags);
 }
 
 static int omap2_mcspi_transfer(struct spi_device *spi, struct spi_message *m)
@@ -888,6 +1032,7 @@ static int omap2_mcspi_transfer(struct spi_device *spi, struct spi_message *m)
 	struct omap2_mcspi	*mcspi;
 	unsigned long		flags;
 	struct spi_transfer	*t;
+	int			run_now;
 
 	m->actual_length = 0;
 	m->status = 0;
@@ -953,7 +1098,15 @@ static int omap2_mcspi_transfer(struct spi_device *spi, struct spi_message *m)
 
 	mcspi = spi_master_get_devdata(spi->master);
 
+	run_now = omap2_mcspi_can_run_now(m);
+
 	spin_lock_irqsave(&mcspi->lock, flags);
+	if (run_now && !mcspi->busy && list_empty(&mcspi->msg_queue)) {
+		mcspi->busy = 1;
+		spin_unlock_irqrestore(&mcspi->lock, flags);
+		omap2_mcspi_run_now(mcspi, m);
+		return 0;
+	}
 	list_add_tail(&m->queue, &mcspi->msg_queue);
 	queue_work(omap2_mcspi_wq, &mcspi->work);
 	spin_unlock_irqrestore(&mcspi->lock, flags);
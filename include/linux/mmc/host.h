@@ -82,6 +82,17 @@ struct mmc_host_ops {
 	int (*enable)(struct mmc_host *host);
 	int (*disable)(struct mmc_host *host, int lazy);
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
+	/*
+	 * It is optional for the host to implement pre_req and post_req in
+	 * order to support double buffering of requests (prepare one
+	 * request while another request is active). pre_req may be called
+	 * for a request that is never issued, post_req is then called with
+	 * a non-zero error to undo the preparation. Neither touches the
+	 * controller, so both may run without the host being claimed.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *req,
+			    int err);
 	/*
 	 * Avoid calling these three functions too often or in a "fast path",
 	 * since underlaying controller might implement them in an expensive
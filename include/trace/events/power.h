@@ -75,6 +75,57 @@ TRACE_EVENT(power_frequency,
 	TP_printk("type=%lu state=%lu", (unsigned long)__entry->type, (unsigned long) __entry->state)
 );
 
+/*
+ * Power domains (OMAP powerdomains): a domain that was in @prev state
+ * since the last event is now in @state.  @prev differs from the state
+ * of the previous event when the domain went through it while idle.
+ */
+TRACE_EVENT(power_domain_state,
+
+	TP_PROTO(const char *name, unsigned int prev, unsigned int state),
+
+	TP_ARGS(name, prev, state),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	u32,		prev		)
+		__field(	u32,		state		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->prev = prev;
+		__entry->state = state;
+	),
+
+	TP_printk("name=%s prev=%u state=%u", __get_str(name), __entry->prev, __entry->state)
+);
+
+/*
+ * Software latency of taking a domain to @state from idle, or of
+ * bringing it back up (@state is then the on state).
+ */
+TRACE_EVENT(power_domain_latency,
+
+	TP_PROTO(const char *name, unsigned int state, u64 latency_ns),
+
+	TP_ARGS(name, state, latency_ns),
+
+	TP_STRUCT__entry(
+		__string(	name,		name		)
+		__field(	u32,		state		)
+		__field(	u64,		latency_ns	)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->state = state;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("name=%s state=%u latency_ns=%llu", __get_str(name), __entry->state, (unsigned long long)__entry->latency_ns)
+);
+
 #endif /* _TRACE_POWER_H */
 
 /* This part must be outside protection */
@@ -17,4 +17,6 @@
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_start);
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_end);
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_frequency);
+EXPORT_TRACEPOINT_SYMBOL_GPL(power_domain_state);
+EXPORT_TRACEPOINT_SYMBOL_GPL(power_domain_latency);
 
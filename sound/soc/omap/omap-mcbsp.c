@@ -139,6 +139,30 @@ static const unsigned long omap34xx_mcbsp_port[][2] = {
 static const unsigned long omap34xx_mcbsp_port[][2] = {};
 #endif
 
+/*
+ * In threshold mode the McBSP raises a DMA request each time a packet of
+ * words fits in (or can be taken from) its FIFO.  Use the largest packet
+ * that divides the period and fits in the FIFO: periods then start on a
+ * packet boundary, and the FIFO is serviced as rarely as possible, which
+ * lets the rest of the system stay idle longer.
+ */
+static int omap_mcbsp_packet_size(unsigned int bus_id, int stream,
+				  int period_words)
+{
+	int pkt;
+
+	if (stream == SNDRV_PCM_STREAM_PLAYBACK)
+		pkt = omap_mcbsp_get_max_tx_threshold(bus_id) + 1;
+	else
+		pkt = omap_mcbsp_get_max_rx_threshold(bus_id) + 1;
+
+	for (pkt = min(pkt, period_words); pkt > 1; pkt--)
+		if (period_words % pkt == 0)
+			break;
+
+	return pkt;
+}
+
 static void omap_mcbsp_set_threshold(struct snd_pcm_substream *substream)
 {
 	struct snd_soc_pcm_runtime *rtd = substream->private_data;
@@ -149,7 +173,8 @@ static void omap_mcbsp_set_threshold(struct snd_pcm_substream *substream)
 
 	/* TODO: Currently, MODE_ELEMENT == MODE_FRAME */
 	if (dma_op_mode == MCBSP_DMA_MODE_THRESHOLD)
-		samples = snd_pcm_lib_period_bytes(substream) >> 1;
+		samples = omap_mcbsp_dai_dma_params[cpu_dai->id]
+				[substream->stream].packet_size;
 	else
 		samples = 1;
 
@@ -174,7 +199,6 @@ static int omap_mcbsp_dai_startup(struct snd_pcm_substream *substream,
 
 	if (cpu_is_omap343x()) {
 		int dma_op_mode = omap_mcbsp_get_dma_op_mode(bus_id);
-		int max_period;
 
 		/*
 		 * McBSP2 in OMAP3 has 1024 * 32-bit internal audio buffer.
@@ -187,18 +211,15 @@ static int omap_mcbsp_dai_startup(struct snd_pcm_substream *substream,
 					SNDRV_PCM_HW_PARAM_BUFFER_BYTES,
 					4096, UINT_MAX);
 
-		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-			max_period = omap_mcbsp_get_max_tx_threshold(bus_id);
-		else
-			max_period = omap_mcbsp_get_max_rx_threshold(bus_id);
-
-		max_period++;
-		max_period <<= 1;
-
+		/*
+		 * Periods larger than the FIFO are moved in several packets,
+		 * see omap_mcbsp_packet_size().  Keep them a multiple of 16
+		 * words so that a packet is never shorter than that.
+		 */
 		if (dma_op_mode == MCBSP_DMA_MODE_THRESHOLD)
-			snd_pcm_hw_constraint_minmax(substream->runtime,
+			snd_pcm_hw_constraint_step(substream->runtime, 0,
 						SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
-						32, max_period);
+						32);
 	}
 
 	return err;
@@ -256,6 +277,7 @@ static int omap_mcbsp_dai_hw_params(struct snd_pcm_substream *substream,
 	struct omap_mcbsp_reg_cfg *regs = &mcbsp_data->regs;
 	int dma, bus_id = mcbsp_data->bus_id, id = cpu_dai->id;
 	int wlen, channels, wpf, sync_mode = OMAP_DMA_SYNC_ELEMENT;
+	int pkt_size = 0;
 	unsigned long port;
 	unsigned int format;
 
@@ -275,8 +297,12 @@ static int omap_mcbsp_dai_hw_params(struct snd_pcm_substream *substream,
 						omap_mcbsp_set_threshold;
 		/* TODO: Currently, MODE_ELEMENT == MODE_FRAME */
 		if (omap_mcbsp_get_dma_op_mode(bus_id) ==
-						MCBSP_DMA_MODE_THRESHOLD)
+						MCBSP_DMA_MODE_THRESHOLD) {
 			sync_mode = OMAP_DMA_SYNC_FRAME;
+			pkt_size = omap_mcbsp_packet_size(bus_id,
+					substream->stream,
+					params_period_bytes(params) >> 1);
+		}
 	} else {
 		return -ENODEV;
 	}
@@ -285,6 +311,7 @@ static int omap_mcbsp_dai_hw_params(struct snd_pcm_substream *substream,
 	omap_mcbsp_dai_dma_params[id][substream->stream].dma_req = dma;
 	omap_mcbsp_dai_dma_params[id][substream->stream].port_addr = port;
 	omap_mcbsp_dai_dma_params[id][substream->stream].sync_mode = sync_mode;
+	omap_mcbsp_dai_dma_params[id][substream->stream].packet_size = pkt_size;
 	cpu_dai->dma_data = &omap_mcbsp_dai_dma_params[id][substream->stream];
 
 	if (mcbsp_data->configured) {
@@ -50,6 +50,9 @@ struct omap_runtime_data {
 	struct omap_pcm_dma_data	*dma_data;
 	int				dma_ch;
 	int				period_index;
+	/* DMA frames per ALSA period and how far into it we are */
+	int				frames_per_period;
+	int				frame_index;
 };
 
 static void omap_pcm_dma_irq(int ch, u16 stat, void *data)
@@ -89,6 +92,13 @@ static void omap_pcm_dma_irq(int ch, u16 stat, void *data)
 		spin_unlock_irqrestore(&prtd->lock, flags);
 	}
 
+	/* the DMA frame can be shorter than a period, see prepare */
+	if (prtd->frames_per_period > 1) {
+		if (++prtd->frame_index < prtd->frames_per_period)
+			return;
+		prtd->frame_index = 0;
+	}
+
 	snd_pcm_period_elapsed(substream);
 }
 
@@ -182,10 +192,23 @@ static int omap_pcm_prepare(struct snd_pcm_substream *substream)
 	 * Set DMA transfer frame size equal to ALSA period size and frame
 	 * count as no. of ALSA periods. Then with DMA frame interrupt enabled,
 	 * we can transfer the whole ALSA buffer with single DMA transfer but
-	 * still can get an interrupt at each period bounary
+	 * still can get an interrupt at each period bounary.
+	 *
+	 * A DAI moving data in fixed size packets (McBSP threshold mode) picks
+	 * a packet size that divides the period; the DMA frame is then one
+	 * packet and every frames_per_period-th frame interrupt ends a period.
 	 */
-	dma_params.elem_count	= snd_pcm_lib_period_bytes(substream) / 2;
-	dma_params.frame_count	= runtime->periods;
+	if (dma_data->packet_size) {
+		dma_params.elem_count	= dma_data->packet_size;
+		dma_params.frame_count	= snd_pcm_lib_buffer_bytes(substream) /
+					  (2 * dma_data->packet_size);
+		prtd->frames_per_period	= snd_pcm_lib_period_bytes(substream) /
+					  (2 * dma_data->packet_size);
+	} else {
+		dma_params.elem_count	= snd_pcm_lib_period_bytes(substream) / 2;
+		dma_params.frame_count	= runtime->periods;
+		prtd->frames_per_period	= 1;
+	}
 	omap_set_dma_params(prtd->dma_ch, &dma_params);
 
 	if ((cpu_is_omap1510()) &&
@@ -215,6 +238,7 @@ static int omap_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		prtd->period_index = 0;
+		prtd->frame_index = 0;
 		/* Configure McBSP internal buffer usage */
 		if (dma_data->set_threshold)
 			dma_data->set_threshold(substream);
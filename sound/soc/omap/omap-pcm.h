@@ -30,6 +30,7 @@ struct omap_pcm_dma_data {
 	int		dma_req;	/* DMA request line */
 	unsigned long	port_addr;	/* transmit/receive register */
 	int		sync_mode;	/* DMA sync mode */
+	int		packet_size;	/* words per DMA frame, 0 for a period */
 	void (*set_threshold)(struct snd_pcm_substream *substream);
 };
 